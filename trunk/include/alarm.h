@@ -3,7 +3,7 @@
 #ifndef __alarm_h
 #define __alarm_h
 
-#include <utility/queue.h>
+#include <utility/wheel.h>
 #include <utility/handler.h>
 #include <tsc.h>
 #include <rtc.h>
@@ -23,10 +23,14 @@ class Alarm
     friend class Scheduling_Criteria::EDF;
 
 private:
+    static const bool smp = Traits<Thread>::smp;
+    static const bool tickless = Alarm_Timer::tickless;
+
     typedef TSC::Hertz Hertz;
     typedef Timer::Tick Tick;
 
-    typedef Relative_Queue<Alarm, Tick> Queue;
+    typedef Timing_Wheel<Alarm, Tick> Queue;
+    typedef Spin_Lock<Traits<Alarm>::SPIN> Spin;
 
 public:
     typedef RTC::Microsecond Microsecond;
@@ -56,8 +60,33 @@ private:
         return (time + timer_period() / 2) / timer_period();
     }
 
-    static void lock() { Thread::lock(); }
-    static void unlock() { Thread::unlock(); }
+    // Ticks since the system started (in tickless mode, the timer keeps track of them)
+    static Tick elapsed() {
+        if(!tickless)
+            return _elapsed;
+
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        Tick e = Alarm_Timer::elapsed();
+        if(!disabled)
+            CPU::int_enable();
+        return e;
+    }
+
+    // The alarm queue has its own lock, which is never held while handlers run (see Thread::lock())
+    static void lock() {
+        CPU::int_disable();
+        if(smp)
+            _lock.acquire();
+    }
+
+    static void unlock() {
+        if(smp)
+            _lock.release();
+        CPU::int_enable();
+    }
+
+    static void reprogram();
 
     static void handler(const IC::Interrupt_Id & i);
 
@@ -71,6 +100,7 @@ private:
     static Alarm_Timer * _timer;
     static volatile Tick _elapsed;
     static Queue _request;
+    static Spin _lock;
 };
 
 
@@ -89,13 +119,13 @@ private:
 
 // The following Scheduling Criteria depend on Alarm, which is not yet available at scheduler.h
 namespace Scheduling_Criteria {
-    inline FCFS::FCFS(int p): Priority((p == IDLE) ? IDLE : Alarm::_elapsed) {}
+    inline FCFS::FCFS(int p): Priority((p == IDLE) ? IDLE : Alarm::elapsed()) {}
 
     inline EDF::EDF(const Microsecond & d, const Microsecond & p, const Microsecond & c, int): RT_Common(Alarm::ticks(d), Alarm::ticks(d), p, c) {}
 
     inline void EDF::update() {
         if((_priority > PERIODIC) && (_priority < APERIODIC))
-            _priority = Alarm::_elapsed + _deadline;
+            _priority = Alarm::elapsed() + _deadline;
     }
 };
 
@@ -35,6 +35,7 @@ public:
         Chunk() {}
         Chunk(unsigned int bytes, Flags flags): _phy_addr(alloc(bytes)), _bytes(bytes), _flags(flags) {}
         Chunk(Phy_Addr phy_addr, unsigned int bytes, Flags flags): _phy_addr(phy_addr), _bytes(bytes), _flags(flags) {}
+        Chunk(const Chunk & chunk): _phy_addr(alloc(chunk._bytes)), _bytes(chunk._bytes), _flags(chunk._flags) { memcpy(_phy_addr, chunk._phy_addr, _bytes); }
 
         ~Chunk() { free(_phy_addr, _bytes); }
 
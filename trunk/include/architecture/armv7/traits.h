@@ -34,6 +34,11 @@ template<> struct Traits<TSC>: public Traits<void>
 //TODO: http://stackoverflow.com/questions/16236460/arm-cortex-a9-event-counters-return-0
 };
 
+template<> struct Traits<FPU>: public Traits<void>
+{
+    static const bool enabled = false;
+};
+
 template<> struct Traits<PMU>: public Traits<void>
 {
     static const bool enabled = (Traits<Build>::MODEL == Traits<Build>::Zynq);
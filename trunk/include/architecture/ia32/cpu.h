@@ -90,7 +90,17 @@ public:
 
     // CR4 Flags
     enum {
-        CR4_PSE     = 1 << 8    // CR4 Performance Counter Enable
+        CR4_PSE         = 1 << 4,   // Page Size Extensions (4 MB pages)
+        CR4_PGE         = 1 << 7,   // Page Global Enable
+        CR4_PCE         = 1 << 8,   // Performance Counter Enable
+        CR4_OSFXSR      = 1 << 9,   // FXSAVE/FXRSTOR handle the SSE state
+        CR4_OSXMMEXCPT  = 1 << 10   // Unmasked SIMD floating-point exceptions raise #XM
+    };
+
+    // CPUID(1).EDX Feature Flags
+    enum {
+        CPUID_PSE       = 1 << 3,   // Page Size Extensions
+        CPUID_PGE       = 1 << 13   // Page Global Enable
     };
 
     // Segment Flags
@@ -370,6 +380,45 @@ public:
     static Reg32 ntohl(Reg32 v) { return htonl(v); }
     static Reg16 ntohs(Reg16 v) { return htons(v); }
 
+    // Internet checksum: adds 32 bytes per iteration with a single carry chain (IA32 handles unaligned accesses,
+    // so no alignment prologue is needed) and leaves the remainder to the portable code
+    static Reg32 csum(const void * data, unsigned int size, Reg32 partial = 0) {
+        const unsigned char * ptr = reinterpret_cast<const unsigned char *>(data);
+        Reg32 sum = 0;
+        for(; size >= 32; size -= 32, ptr += 32)
+            ASM("   addl     0(%1), %0  \n"
+                "   adcl     4(%1), %0  \n"
+                "   adcl     8(%1), %0  \n"
+                "   adcl    12(%1), %0  \n"
+                "   adcl    16(%1), %0  \n"
+                "   adcl    20(%1), %0  \n"
+                "   adcl    24(%1), %0  \n"
+                "   adcl    28(%1), %0  \n"
+                "   adcl    $0, %0      \n" : "+r"(sum) : "r"(ptr) : "cc", "memory");
+        return CPU_Common::csum(ptr, size, csum_fold(Reg64(sum) + partial));
+    }
+
+    static Reg32 csum_copy(void * to, const void * from, unsigned int size, Reg32 partial = 0) {
+        unsigned char * dst = reinterpret_cast<unsigned char *>(to);
+        const unsigned char * src = reinterpret_cast<const unsigned char *>(from);
+        Reg32 sum = 0;
+        for(; size >= 16; size -= 16, dst += 16, src += 16)
+            ASM("   movl     0(%2), %%eax   \n"
+                "   movl    %%eax,  0(%1)   \n"
+                "   addl    %%eax, %0       \n"
+                "   movl     4(%2), %%eax   \n"
+                "   movl    %%eax,  4(%1)   \n"
+                "   adcl    %%eax, %0       \n"
+                "   movl     8(%2), %%eax   \n"
+                "   movl    %%eax,  8(%1)   \n"
+                "   adcl    %%eax, %0       \n"
+                "   movl    12(%2), %%eax   \n"
+                "   movl    %%eax, 12(%1)   \n"
+                "   adcl    %%eax, %0       \n"
+                "   adcl    $0, %0          \n" : "+r"(sum) : "r"(dst), "r"(src) : "eax", "cc", "memory");
+        return CPU_Common::csum_copy(dst, src, size, csum_fold(Reg64(sum) + partial));
+    }
+
     template<typename ... Tn>
     static Context * init_stack(const Log_Addr & usp, Log_Addr sp, void (* exit)(), int (* entry)(Tn ...), Tn ... an) {
         // IA32 first decrements the stack pointer and then writes into the stack
@@ -0,0 +1,94 @@
+// EPOS IA32 FPU Mediator Declarations
+
+#ifndef __ia32_fpu_h
+#define __ia32_fpu_h
+
+#include <cpu.h>
+#include <fpu.h>
+#include <ic.h>
+
+__BEGIN_SYS
+
+// Lazy x87/MMX/SSE context switching: dispatching a thread sets CR0.TS, so the first FPU instruction it
+// executes raises #NM (EXC_NODEV), whose handler saves the state of the previous owner of this CPU's FPU
+// and restores that of the running thread. Threads that never touch the FPU are never saved nor restored.
+class FPU: public FPU_Common
+{
+    friend class Thread;
+
+private:
+    static const bool smp = Traits<System>::multicore;
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+
+    typedef CPU::Reg8 Reg8;
+    typedef CPU::Reg16 Reg16;
+    typedef CPU::Reg32 Reg32;
+
+public:
+    // CPUID(1).EDX feature flags
+    enum {
+        CPUID_FXSR      = 1 << 24,      // FXSAVE/FXRSTOR
+        CPUID_SSE       = 1 << 25
+    };
+
+    // Initial control words (all exceptions masked, round to nearest, extended precision)
+    enum {
+        FCW_DEFAULT     = 0x037f,
+        MXCSR_DEFAULT   = 0x1f80
+    };
+
+    // FPU Context (the FXSAVE area, which must be 16-byte aligned)
+    class Context
+    {
+        friend class FPU;
+
+    private:
+        static const unsigned int SIZE = 512;
+        static const unsigned int ALIGNMENT = 16;
+
+    public:
+        Context(): _cpu(CPUS) {
+            Reg8 * fx = area();
+            for(unsigned int i = 0; i < SIZE; i++)
+                fx[i] = 0;
+            *reinterpret_cast<Reg16 *>(&fx[0]) = FCW_DEFAULT;
+            *reinterpret_cast<Reg32 *>(&fx[24]) = MXCSR_DEFAULT;
+        }
+
+    private:
+        Reg8 * area() { return reinterpret_cast<Reg8 *>((reinterpret_cast<Reg32>(&_area[0]) + ALIGNMENT - 1) & ~(ALIGNMENT - 1)); }
+
+    private:
+        volatile unsigned int _cpu; // CPU whose registers were last loaded with this context (SMP only)
+        Reg8 _area[SIZE + ALIGNMENT - 1];
+    };
+
+public:
+    FPU() {}
+
+    static void switch_context(Context * next);
+    static void discard(Context * ctx);
+
+private:
+    static void save(Context * ctx) { ASM("fxsave (%0)" : : "r"(ctx->area()) : "memory"); }
+    static void load(Context * ctx) { ASM("fxrstor (%0)" : : "r"(ctx->area()) : "memory"); }
+
+    static void clts() { ASM("clts"); }
+    static void stts() {
+        Reg32 cr0 = CPU::cr0();
+        if(!(cr0 & CPU::CR0_TS))
+            CPU::cr0(cr0 | CPU::CR0_TS);
+    }
+
+    static void nodev(const IC::Interrupt_Id & i);
+
+    static void init();
+
+private:
+    static Context * volatile _owner[CPUS];   // context loaded in each CPU's FPU registers
+    static Context * volatile _current[CPUS]; // context of the thread running on each CPU
+};
+
+__END_SYS
+
+#endif
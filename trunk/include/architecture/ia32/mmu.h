@@ -5,8 +5,9 @@
 
 #include <system/memory_map.h>
 #include <utility/string.h>
-#include <utility/list.h>
+#include <utility/buddy.h>
 #include <utility/debug.h>
+#include <utility/spin.h>
 #include <cpu.h>
 #include <mmu.h>
 
@@ -17,13 +18,31 @@ class MMU: public MMU_Common<10, 10, 12>
     friend class CPU;
 
 private:
-    typedef Grouping_List<Frame> List;
-
     static const bool colorful = Traits<MMU>::colorful;
     static const unsigned int COLORS = Traits<MMU>::COLORS;
+    static const unsigned int LARGE_CHUNK = Traits<MMU>::LARGE_CHUNK;
     static const unsigned int PHY_MEM = Memory_Map::PHY_MEM;
+    static const unsigned int MEM_BASE = Memory_Map::MEM_BASE;
+    static const unsigned int FRAMES = (Memory_Map::MEM_TOP - Memory_Map::MEM_BASE) >> PAGE_SHIFT;
+
+    // Free frames are kept in buddy systems: WHITE covers all frames, while each other color covers only its own
+    // frames, which lie COLORS frames apart (see phy2color()) and therefore can only be allocated one at a time
+    typedef Buddy<FRAMES> White_Frames;
+    typedef Buddy<colorful ? FRAMES / COLORS : 1> Colored_Frames;
+
+    // Frames can be shared copy-on-write by at most MAX_SHARES + 1 mappings (see Chunk(const Chunk &))
+    static const unsigned int MAX_SHARES = 255;
+
+    // Page fault error code
+    enum {
+        PF_PRESENT = 1 << 0,    // the page was present (i.e. it was a protection violation)
+        PF_WRITE   = 1 << 1     // the access was a write
+    };
 
 public:
+    // A page directory entry with the PS flag maps a whole 4 MB large page instead of pointing to a page table
+    static const unsigned int LARGE_PAGE_SIZE = sizeof(Page) * PT_ENTRIES;
+
     // Page Flags
     class IA32_Flags
     {
@@ -38,7 +57,7 @@ public:
             DRT  = 0x040, // Dirty (only for PTEs, 0=clean, 1=dirty)
             PS   = 0x080, // Page Size (for PDEs, 0=4KBytes, 1=4MBytes)
             GLB  = 0X100, // Global Page (0=local, 1=global)
-            EX   = 0x200, // User Def. (0=non-executable, 1=executable)
+            COW  = 0x200, // User Def. (0=private, 1=copy-on-write)
             CT   = 0x400, // User Def. (0=non-contiguous, 1=contiguous)
             IO   = 0x800, // User Def. (0=memory, 1=I/O)
             APP  = (PRE | RW  | ACC | USR),
@@ -92,6 +111,14 @@ public:
             remap(alloc(to - from, color), from, to, flags);
         }
 
+        // Demand-zero: the entries keep their flags (but not PRE), so page_fault() can map the frames once touched
+        void reserve(int from, int to, const IA32_Flags & flags) {
+            for( ; from < to; from++) {
+                Log_Addr * tmp = phy2log(&_entry[from]);
+                *tmp = flags & ~IA32_Flags::PRE;
+            }
+        }
+
         void remap(Phy_Addr addr, int from, int to, const IA32_Flags & flags) {
             addr = align_page(addr);
             for( ; from < to; from++) {
@@ -127,25 +154,66 @@ public:
     };
 
     // Chunk (for Segment)
+    // Chunks of at least LARGE_CHUNK bytes are backed by 4 MB large pages whenever 4 MB-aligned frames can be found
+    // for them. Such chunks have no page tables: _pt holds the address of their first frame and _flags includes PS,
+    // so each of their _pts directory entries maps a whole large page.
     class Chunk
     {
     public:
         Chunk() {}
 
         Chunk(unsigned int bytes, const Flags & flags, const Color & color = WHITE)
-        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _pt(calloc(_pts, WHITE)) {
+        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _pt((large(bytes, color) && !(flags & Flags::DZ)) ? alloc_large(_pts) : Phy_Addr(false)) {
+            if(_pt) {
+                _flags = _flags | IA32_Flags::PS;
+                return;
+            }
+
+            _pt = calloc(_pts, WHITE);
             if(flags & IA32_Flags::CT)
                 _pt->map_contiguous(_from, _to, _flags, color);
+            else if((flags & Flags::DZ) && (color == WHITE)) // page_fault() only allocates WHITE frames
+                _pt->reserve(_from, _to, _flags);
             else
                 _pt->map(_from, _to, _flags, color);
         }
 
+        // Copies a chunk. The frames of the original are shared copy-on-write, so the copy costs only its page tables
+        // until either side writes into them. Contiguous and large chunks must stay so and are copied right away.
+        // IO chunks (e.g. an application loaded by SETUP) are shared too, but the copy owns the frames it maps.
+        Chunk(const Chunk & chunk)
+        : _from(chunk._from), _to(chunk._to), _pts(chunk._pts), _flags(chunk._flags & ~IA32_Flags::IO), _pt(Phy_Addr(false)) {
+            if(!(_flags & (IA32_Flags::CT | IA32_Flags::PS))) {
+                _pt = calloc(_pts, WHITE);
+                share(chunk);
+                return;
+            }
+
+            if(_flags & IA32_Flags::PS)
+                _pt = alloc_large(_pts);
+            if(!_pt) {
+                _flags = _flags & ~IA32_Flags::PS;
+                _pt = calloc(_pts, WHITE);
+                if(_flags & IA32_Flags::CT)
+                    _pt->map_contiguous(_from, _to, _flags, WHITE);
+                else
+                    _pt->map(_from, _to, _flags, WHITE);
+            }
+            for(unsigned int i = _from; i < _to; i++)
+                memcpy(phy2log(frame(i)), phy2log(chunk.frame(i)), sizeof(Page));
+        }
+
         Chunk(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & flags)
         : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _pt(calloc(_pts, WHITE)) {
             _pt->remap(phy_addr, _from, _to, flags);
         }
 
         ~Chunk() {
+            if(_flags & IA32_Flags::PS) {
+                free(_pt, _pts * PT_ENTRIES);
+                return;
+            }
+
             if(!(_flags & IA32_Flags::IO)) {
                 if(_flags & IA32_Flags::CT)
                     free((*static_cast<Page_Table *>(phy2log(_pt)))[_from], _to - _from);
@@ -162,11 +230,13 @@ public:
         unsigned int size() const { return (_to - _from) * sizeof(Page); }
 
         Phy_Addr phy_address() const {
+            if(_flags & IA32_Flags::PS)
+                return Phy_Addr(_pt);
             return (_flags & IA32_Flags::CT) ? Phy_Addr(indexes((*_pt)[_from])) : Phy_Addr(false);
         }
 
         int resize(unsigned int amount) {
-            if(_flags & IA32_Flags::CT)
+            if(_flags & (IA32_Flags::CT | IA32_Flags::PS))
                 return 0;
 
             unsigned int pgs = pages(amount);
@@ -189,6 +259,60 @@ public:
             return pgs * sizeof(Page);
         }
 
+    private:
+        // Frame mapped to the i-th page of the chunk
+        Phy_Addr frame(unsigned int i) const {
+            if(_flags & IA32_Flags::PS)
+                return Phy_Addr(_pt) + i * sizeof(Page);
+            return indexes((*static_cast<Page_Table *>(phy2log(_pt)))[i]);
+        }
+
+        // Maps the frames of chunk copy-on-write (write-protecting them in chunk as well), except for those that cannot
+        // be shared anymore or are global, which are copied right away
+        void share(const Chunk & chunk) {
+            Page_Table & src = *static_cast<Page_Table *>(phy2log(chunk._pt));
+            Page_Table & dst = *static_cast<Page_Table *>(phy2log(_pt));
+
+            Spin_Guard<> guard(_lock); // page_fault() might be resolving a write to chunk on another CPU
+            for(unsigned int i = _from; i < _to; i++) {
+                PT_Entry pte = src[i];
+                if(!(pte & IA32_Flags::PRE)) { // unmapped or not yet touched (demand-zero)
+                    dst[i] = pte;
+                    continue;
+                }
+
+                bool writable = pte & (IA32_Flags::RW | IA32_Flags::COW);
+                if((pte & IA32_Flags::GLB) || !MMU::share(pte)) {
+                    Phy_Addr copy = alloc(1, WHITE);
+                    memcpy(phy2log(copy), phy2log(indexes(pte)), sizeof(Page));
+                    dst[i] = copy | (offset(pte) & ~IA32_Flags::COW & ~IA32_Flags::GLB) | (writable ? IA32_Flags::RW : 0);
+                    continue;
+                }
+
+                if(writable)
+                    pte = (pte & ~IA32_Flags::RW) | IA32_Flags::COW;
+                src[i] = pte;
+                dst[i] = pte;
+            }
+
+            // The original might be attached to the current address space, whose TLB still allows writing to it
+            flush_tlb();
+        }
+
+        static bool large(unsigned int bytes, const Color & color) {
+            return _large && (bytes >= LARGE_CHUNK) && (!colorful || (color == WHITE));
+        }
+
+        // Allocates n large pages, giving the frames back if they happen not to be 4 MB-aligned
+        static Phy_Addr alloc_large(unsigned int n) {
+            Phy_Addr phy = alloc(n * PT_ENTRIES, WHITE);
+            if(phy && (phy & (LARGE_PAGE_SIZE - 1))) {
+                free(phy, n * PT_ENTRIES);
+                return Phy_Addr(false);
+            }
+            return phy;
+        }
+
     private:
         unsigned int _from;
         unsigned int _to;
@@ -215,7 +339,11 @@ public:
 
         Phy_Addr pd() const { return _pd; }
 
-        void activate() const { CPU::pdp(reinterpret_cast<CPU::Reg32>(_pd)); }
+        // Reloading CR3 flushes all non-global TLB entries, so it is skipped if this directory is already active
+        void activate() const {
+            if(CPU::pdp() != reinterpret_cast<CPU::Reg32>(_pd))
+                CPU::pdp(reinterpret_cast<CPU::Reg32>(_pd));
+        }
 
         Log_Addr attach(const Chunk & chunk, unsigned int from = 0) {
             for(unsigned int i = from; i < PD_ENTRIES; i++)
@@ -249,24 +377,56 @@ public:
             detach(from, chunk.pt(), chunk.pts());
         }
 
-        Phy_Addr physical(const Log_Addr & addr) {
-            Page_Table * pt = reinterpret_cast<Page_Table *>((void *)(*_pd)[directory(addr)]);
-            return (*pt)[page(addr)] | offset(addr);
-        }
+        Phy_Addr physical(const Log_Addr & addr) { return translate(_pd, addr); }
 
     private:
         bool attach(unsigned int from, const Page_Table * pt, unsigned int n, IA32_Flags flags) {
             for(unsigned int i = from; i < from + n; i++)
                 if((*static_cast<Page_Directory *>(phy2log(_pd)))[i])
                     return false;
-            for(unsigned int i = from; i < from + n; i++, pt++)
-                (*static_cast<Page_Directory *>(phy2log(_pd)))[i] = Phy_Addr(pt) | flags;
+
+            // Kernel mappings in the master directory end up in every address space, so they can be global. The flag
+            // goes in the PTEs of small pages and, since PDEs pointing to page tables ignore it, marks those for detach(),
+            // which takes it off the PTEs again (the chunk might be attached to another address space afterwards).
+            // detach() can only invalidate them on this CPU, so chunks attached on multicore builds are never global
+            // (the mappings SETUP makes for the kernel still are, since they are never detached).
+            if(_global && !Traits<System>::multicore && (_pd == _master) && (from >= directory(PHY_MEM)) && !(flags & IA32_Flags::USR)) {
+                flags = flags | IA32_Flags::GLB;
+                if(!(flags & IA32_Flags::PS)) {
+                    Page_Table * tables = phy2log(Phy_Addr(pt));
+                    for(unsigned int i = 0; i < n * PT_ENTRIES; i++)
+                        if(tables[i / PT_ENTRIES][i % PT_ENTRIES])
+                            tables[i / PT_ENTRIES][i % PT_ENTRIES] = tables[i / PT_ENTRIES][i % PT_ENTRIES] | IA32_Flags::GLB;
+                }
+            }
+
+            // Large chunks map consecutive 4 MB pages rather than consecutive page tables
+            unsigned int step = (flags & IA32_Flags::PS) ? LARGE_PAGE_SIZE : sizeof(Page_Table);
+            Phy_Addr phy(pt);
+            for(unsigned int i = from; i < from + n; i++, phy += step)
+                (*static_cast<Page_Directory *>(phy2log(_pd)))[i] = phy | flags;
             return true;
         }
 
         void detach(unsigned int from, const Page_Table * pt, unsigned int n) {
+            unsigned int flags = (*static_cast<Page_Directory *>(phy2log(_pd)))[from] & (IA32_Flags::PS | IA32_Flags::GLB);
+
             for(unsigned int i = from; i < from + n; i++)
                 (*static_cast<Page_Directory *>(phy2log(_pd)))[i] = 0;
+
+            // Drop the stale translations. Global ones survive CR3 reloads, so they are invalidated page by page.
+            if(flags & IA32_Flags::GLB) {
+                if(!(flags & IA32_Flags::PS)) {
+                    Page_Table * tables = phy2log(Phy_Addr(pt));
+                    for(unsigned int i = 0; i < n * PT_ENTRIES; i++)
+                        tables[i / PT_ENTRIES][i % PT_ENTRIES] = tables[i / PT_ENTRIES][i % PT_ENTRIES] & ~IA32_Flags::GLB;
+                }
+
+                unsigned int step = (flags & IA32_Flags::PS) ? LARGE_PAGE_SIZE : sizeof(Page);
+                for(unsigned int i = 0; i < n * (LARGE_PAGE_SIZE / step); i++)
+                    flush_tlb((from << DIRECTORY_SHIFT) + i * step);
+            } else if(CPU::pdp() == reinterpret_cast<CPU::Reg32>(_pd))
+                flush_tlb();
         }
 
     private:
@@ -308,13 +468,20 @@ public:
 public:
     MMU() {}
 
+    // The frame allocators are also used by page_fault(), which might interrupt a thread that is using them, so they are
+    // only touched with interrupts disabled (and the lock held)
     static Phy_Addr alloc(unsigned int frames = 1, const Color & color = WHITE) {
         Phy_Addr phy(false);
 
         if(frames) {
-            List::Element * e = _free[color].search_decrementing(frames);
-            if(e) {
-                phy = e->object() + e->size();
+            Spin_Guard<> guard(_lock);
+            int f;
+            if(!colorful || (color == WHITE))
+                f = _white.alloc(frames);
+            else
+                f = (frames == 1) ? color2frame(_colored[color].alloc(1), color) : -1;
+            if(f >= 0) {
+                phy = frame2phy(f);
                 db<MMU>(TRC) << "MMU::alloc(frames=" << frames << ",color=" << color << ") => " << phy << endl;
             } else
                 if(colorful)
@@ -337,14 +504,23 @@ public:
     static void free(Phy_Addr frame, int n = 1) {
         // Clean up MMU flags in frame address
         frame = indexes(frame);
-        Color color = colorful ? phy2color(frame) : WHITE;
+
+        // Contiguous frames can only have been allocated from WHITE, so that is where they return to
+        Color color = (colorful && (n == 1)) ? phy2color(frame) : WHITE;
 
         db<MMU>(TRC) << "MMU::free(frame=" << frame << ",color=" << color << ",n=" << n << ")" << endl;
 
         if(frame && n) {
-            List::Element * e = new (phy2log(frame)) List::Element(frame, n);
-            List::Element * m1, * m2;
-            _free[color].insert_merging(e, &m1, &m2);
+            Spin_Guard<> guard(_lock);
+
+            // Frames shared copy-on-write only lose a reference
+            if((n == 1) && unshare(frame))
+                return;
+
+            if(color == WHITE)
+                _white.free(phy2frame(frame), n);
+            else
+                _colored[color].free(phy2frame(frame) / COLORS, 1);
         }
     }
 
@@ -355,30 +531,33 @@ public:
         db<MMU>(TRC) << "MMU::free(frame=" << frame << ",color=" << WHITE << ",n=" << n << ")" << endl;
 
         if(frame && n) {
-            List::Element * e = new (phy2log(frame)) List::Element(frame, n);
-            List::Element * m1, * m2;
-            _free[WHITE].insert_merging(e, &m1, &m2);
+            Spin_Guard<> guard(_lock);
+            _white.free(phy2frame(frame), n);
         }
     }
 
-    static unsigned int allocable(const Color & color = WHITE) { return _free[color].head() ? _free[color].head()->size() : 0; }
+    static unsigned int allocable(const Color & color = WHITE) {
+        Spin_Guard<> guard(_lock);
+        if(!colorful || (color == WHITE))
+            return _white.allocable();
+        else
+            return _colored[color].available() ? 1 : 0;
+    }
 
     static Page_Directory * volatile current() {
         return reinterpret_cast<Page_Directory * volatile>(CPU::pdp());
     }
 
-    static Phy_Addr physical(const Log_Addr & addr) {
-        Page_Directory * pd = current();
-        Page_Table * pt = (*pd)[directory(addr)];
-        return (*pt)[page(addr)] | offset(addr);
-    }
+    static Phy_Addr physical(const Log_Addr & addr) { return translate(current(), addr); }
+
+    static bool page_fault(const Log_Addr & addr, CPU::Reg32 error);
 
     static void flush_tlb() {
         ASM("movl %cr3,%eax");
         ASM("movl %eax,%cr3");
     }
     static void flush_tlb(const Log_Addr & addr) {
-        ASM("invlpg %0" : : "m"(addr));
+        ASM("invlpg (%0)" : : "r"(CPU::Reg32(addr)) : "memory");
     }
 
 private:
@@ -386,21 +565,59 @@ private:
 
     static Log_Addr phy2log(const Phy_Addr & phy) { return phy | PHY_MEM; }
 
+    static unsigned int phy2frame(const Phy_Addr & phy) { return (phy - MEM_BASE) >> PAGE_SHIFT; }
+    static Phy_Addr frame2phy(unsigned int frame) { return MEM_BASE + (frame << PAGE_SHIFT); }
+
+    // Adds a reference to a frame shared copy-on-write, unless it has already too many (or is not in memory)
+    static bool share(const Phy_Addr & phy) {
+        unsigned int f = phy2frame(indexes(phy));
+        Spin_Guard<> guard(_lock);
+        if((f >= FRAMES) || (_shares[f] >= MAX_SHARES))
+            return false;
+        _shares[f]++;
+        return true;
+    }
+
+    // Drops a reference to a frame, returning whether it was still shared (and therefore must not be released)
+    static bool unshare(const Phy_Addr & phy) {
+        unsigned int f = phy2frame(indexes(phy));
+        Spin_Guard<> guard(_lock);
+        if((f >= FRAMES) || !_shares[f])
+            return false;
+        _shares[f]--;
+        return true;
+    }
+
+    // Frame index of the i-th frame of a color (or -1, if i is)
+    static int color2frame(int i, const Color & color) { return (i < 0) ? i : i * COLORS + color; }
+
     static Color phy2color(const Phy_Addr & phy) { return static_cast<Color>(colorful ? ((phy >> PAGE_SHIFT) & 0x7f) % COLORS : WHITE); } // TODO: what is 0x7f
 
     static Color log2color(const Log_Addr & log) {
         if(colorful) {
-            Page_Directory * pd = current();
-            Page_Table * pt = (*pd)[directory(log)];
-            Phy_Addr phy = (*pt)[page(log)] | offset(log);
+            Phy_Addr phy = translate(current(), log);
             return static_cast<Color>(((phy >> PAGE_SHIFT) & 0x7f) % COLORS);
         } else
             return WHITE;
     }
 
+    // Walks a page directory, which might map addr either through a page table or with a large page
+    static Phy_Addr translate(Page_Directory * pd, const Log_Addr & addr) {
+        PD_Entry pde = (*pd)[directory(addr)];
+        if(pde & IA32_Flags::PS)
+            return (pde & ~(LARGE_PAGE_SIZE - 1)) | (addr & (LARGE_PAGE_SIZE - 1));
+        Page_Table * pt = Phy_Addr(indexes(pde));
+        return indexes((*pt)[page(addr)]) | offset(addr);
+    }
+
 private:
-    static List _free[colorful * COLORS + 1]; // +1 for WHITE
+    static White_Frames _white;
+    static Colored_Frames _colored[colorful ? COLORS : 1]; // [WHITE] is unused
     static Page_Directory * _master;
+    static bool _large;
+    static bool _global;
+    static unsigned char _shares[FRAMES]; // references to each frame besides its first one
+    static Spin _lock; // frame allocators, _shares and the entries page_fault() resolves
 };
 
 __END_SYS
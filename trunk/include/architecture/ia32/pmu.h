@@ -86,6 +86,12 @@ public:
         BRANCH_MISSES_RETIRED           = 0xC5 | (0x00 << 8)
     };
 
+    // Non-architectural events with the same encoding across Core, Nehalem and Sandy Bridge (and later)
+    enum {
+        // Event                         Select  UMask
+        DTLB_LOAD_MISSES                = 0x08 | (0x01 << 8)  // loads that miss the DTLB (and cause a page walk, since Nehalem)
+    };
+
 public:
     Intel_PMU_V1() {}
 
@@ -24,6 +24,9 @@ template<> struct Traits<MMU>: public Traits<void>
 {
     static const bool colorful = false;
     static const unsigned int COLORS = 1;
+    static const bool large_pages = true;   // use 4 MB pages for the physical memory map and large Segments (if the CPU has PSE)
+    static const unsigned int LARGE_CHUNK = 16 * 1024 * 1024; // smallest Segment mapped with 4 MB pages
+    static const bool global_pages = true;  // keep the kernel's mappings in the TLB across address space switches (if the CPU has PGE)
 };
 
 template<> struct Traits<FPU>: public Traits<void>
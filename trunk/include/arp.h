@@ -7,7 +7,9 @@
 #include <utility/spin.h>
 #include <system.h>
 #include <alarm.h>
+#include <condition.h>
 #include <semaphore.h>
+#include <thread.h>
 
 __BEGIN_SYS
 
@@ -19,11 +21,31 @@ public:
     typedef typename Network::Address PA;
     typedef typename NIC::Address HA;
 
+    typedef typename NIC::Buffer Buffer;
+
 private:
-    static const unsigned int ENTRIES = Traits<Build>::NODES;
+    // Mappings are hashed by protocol address (IPv4 addresses fit in the key) into a prime number of buckets, each with
+    // its own synonym list, so hundreds of neighbors can be cached without long searches
+    static const unsigned int BUCKETS = 251;
+
+    // A sweep runs every TIMEOUT seconds (re)sending requests for mappings that are incomplete or older than
+    // LIFETIME seconds. Mappings that go unanswered for RETRIES sweeps are dropped, along with the Buffers parked on them.
+    // Sweeps send and free memory, so the alarm only wakes up a thread that runs them.
+    static const unsigned int TIMEOUT = Traits<Network>::TIMEOUT;
+    static const unsigned int RETRIES = Traits<Network>::RETRIES;
+    static const unsigned int LIFETIME = 30 * TIMEOUT;
+
+    // Outgoing Buffers parked waiting for a resolution, per neighbor and overall (they hold the NIC's transmit buffers)
+    static const unsigned int PENDING = 3;
+    static const unsigned int PARKED = 16;
+
+    // Requests (re)sent by each sweep, at most (the others wait for the next one)
+    static const unsigned int REQUESTS = 32;
+
+    typedef unsigned long Key;
 
     class Mapping;
-    typedef Simple_Hash<Mapping, ENTRIES, PA> Table;
+    typedef Hash<Mapping, BUCKETS, Key> Table;
     typedef typename Table::Element Element;
 
 public:
@@ -84,38 +106,37 @@ public:
 private:
     class Mapping
     {
+        friend class ARP;
+
     public:
-        Mapping(const PA & pa, const HA & ha): _ha(ha), _sem(0), _link(this, pa) {}
-        Mapping(const PA & pa, Semaphore * sem): _ha(HA::NULL), _sem(sem), _link(this, pa) {}
+        Mapping(const PA & pa, const HA & ha, bool permanent = false): _pa(pa), _ha(ha), _permanent(permanent), _age(0), _tries(0), _link(this, key(pa)) {}
 
+        const PA & pa() const { return _pa; }
         const HA & ha() const { return _ha; }
-        Semaphore * semaphore() { return _sem; }
         Element * link() { return &_link; }
 
-        void update(const HA & ha) {
-            _ha = ha;
-            if(_sem) {
-                _sem->v();
-                _sem = 0;
-            }
-        }
-
         friend Debug & operator<<(Debug & db, const Mapping & m) {
-            db  << "{pa=" << m._link.key() << ",ha=" << m._ha << ",sem=" << m._sem << "}";
+            db  << "{pa=" << m._pa << ",ha=" << m._ha << ",age=" << m._age << ",tries=" << m._tries << ",pending=" << m._pending.size() << "}";
             return db;
         }
 
     private:
-        HA _ha;
-        Semaphore * _sem;
-        Element _link; // PA is the key
+        PA _pa;
+        HA _ha; // NULL while incomplete
+        bool _permanent;
+        unsigned int _age; // sweeps since last confirmed
+        unsigned int _tries; // requests sent since then
+        typename Buffer::List _pending; // parked pools, linked by their heads' lext()
+        Element _link;
     };
 
 
 public:
-    ARP(NIC * nic, Network * net): _nic(nic), _net(net) {
+    ARP(NIC * nic, Network * net): _parked(0), _nic(nic), _net(net), _tick(0), _handler(&_tick), _sweeper(TIMEOUT * 1000000, &_handler, Alarm::INFINITE) {
         db<ARP>(TRC) << "ARP::ARP(nic=" << nic << ",net=" << net << ") => " << this << endl;
 
+        _sweeper_thread = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::HIGH), &sweeper, this);
+
         _nic->attach(this, NIC::ARP);
     }
 
@@ -124,87 +145,131 @@ public:
 
         _nic->detach(this, NIC::ARP);
 
-        lock();
-        for(typename Table::Iterator it = _table.begin(); it != _table.end(); it++) {
-            if(it) {
-                db<ARP>(INF) << "ARP::~ARP: removing and deleting " << *it->object() << endl;
+        delete _sweeper_thread;
 
-                _table.remove(it);
-                delete it->object();
+        Spin_Guard<> guard(_lock);
+        for(unsigned int i = 0; i < BUCKETS; i++)
+            while(!_table[i]->empty()) {
+                Mapping * map = _table[i]->remove()->object();
+                db<ARP>(INF) << "ARP::~ARP: removing and deleting " << *map << endl;
+                drop(map);
+                delete map;
             }
-        }
-        unlock();
     }
 
+    // Permanent mappings never age out
     void insert(const PA & pa, const HA & ha) {
         db<ARP>(TRC) << "ARP::insert(pa=" << pa << ",ha=" << ha << ")" << endl;
 
-        Mapping * map = new (SYSTEM) Mapping(pa, ha);
+        Mapping * map = new (SYSTEM) Mapping(pa, ha, true);
 
-        lock();
+        Spin_Guard<> guard(_lock);
         _table.insert(map->link());
-        unlock();
     }
 
     void remove(const PA & pa) {
         db<ARP>(TRC) << "ARP::remove(pa=" << pa << ")" << endl;
 
-        Element * el = _table.remove_key(pa);
+        Spin_Guard<> guard(_lock);
+        Element * el = _table.remove_key(key(pa));
+        if(el)
+            drop(el->object());
+        guard.release();
+
         if(el) {
             db<ARP>(INF) << "ARP::remove: removing and deleting " << *el->object() << endl;
             delete el->object();
         }
     }
 
-    HA resolve(const PA & pa) {
-        db<ARP>(TRC) << "ARP::resolve(pa=" << pa << ") => ";
-
-        volatile HA ha = HA(HA::NULL);
-
-        lock();
-        Element * el = _table.search_key(pa);
-        unlock();
+    // Cached mapping for "pa", if any. It never blocks, but starts resolving "pa" in the background if it is unknown.
+    HA lookup(const PA & pa) {
+        HA ha = HA(HA::NULL);
 
+        Spin_Guard<> guard(_lock);
+        Element * el = _table.search_key(key(pa));
         if(el)
             ha = el->object()->ha();
-        else {
-            db<ARP>(TRC) << "sending requests" << endl;
+        guard.release();
 
-            Semaphore sem(0);
-            Mapping * map = new (SYSTEM) Mapping(pa, &sem);
-            lock();
-            _table.insert(map->link());
-            unlock();
+        if(!el)
+            start(pa);
 
-            for(unsigned int i = 0; (i < Traits<Network>::RETRIES) && !ha; i++) {
-                Packet request(REQUEST, _nic->address(), _net->address(), HA::BROADCAST, pa);
-                db<ARP>(INF) << "ARP::resolve:request=" << request << endl;
-                _nic->send(HA::BROADCAST, NIC::ARP, &request, sizeof(Packet));
-
-                Semaphore_Handler handler(&sem);
-                Alarm alarm(Traits<Network>::TIMEOUT * 1000000, &handler, 1);
-                sem.p();
-
-                ha = map->ha();
-            }
-
-            lock();
-            if(!ha) {
-                _table.remove(map->link());
-                delete map;
-            }
-            unlock();
+        return ha;
+    }
 
-            db<ARP>(TRC) << "ARP::resolve(pa=" << pa << ") => ";
+    // Blocking resolution, for clients that cannot proceed without the mapping (e.g. DHCP)
+    HA resolve(const PA & pa) {
+        db<ARP>(TRC) << "ARP::resolve(pa=" << pa << ")" << endl;
+
+        HA ha = lookup(pa);
+        for(unsigned int i = 0; (i < RETRIES) && !ha; i++) {
+            Condition_Handler handler(&_resolved);
+            Alarm alarm(TIMEOUT * 1000000, &handler, 1);
+            _resolved.wait(); // woken by any reply, so just look again
+            ha = lookup(pa);
         }
 
-        // Even being declared volatile, "ha" gets messed up and a PF occurs without the memcpy
-        HA ha2;
-        memcpy(&ha2, const_cast<HA *>(&ha), sizeof(HA));
+        db<ARP>(TRC) << "ARP::resolve(pa=" << pa << ") => " << ha << endl;
 
-        db<ARP>(TRC) << ha2 << endl;
+        return ha;
+    }
 
-        return ha2;
+    // Sends a pool allocated for "pa" (its frames may still lack the destination address). If "pa" is not resolved yet,
+    // the pool is parked and sent as soon as the reply arrives; if too many pools are parked already, it is dropped.
+    int send(const PA & pa, Buffer * pool) {
+        db<ARP>(TRC) << "ARP::send(pa=" << pa << ",buf=" << pool << ")" << endl;
+
+        HA ha = HA(HA::NULL);
+        bool parked = false;
+        bool created = false;
+
+        Mapping * map = 0;
+        Spin_Guard<> guard(_lock);
+        Element * el = _table.search_key(key(pa));
+        if(!el) {
+            guard.release();
+            map = new (SYSTEM) Mapping(pa, HA(HA::NULL));
+            guard.acquire();
+            el = _table.search_key(key(pa));
+            if(!el) {
+                _table.insert(map->link());
+                el = map->link();
+                map = 0;
+                created = true;
+            }
+        }
+        Mapping * found = el->object();
+        if(found->ha())
+            ha = found->ha();
+        else if((found->_pending.size() < PENDING) && (_parked < PARKED)) {
+            found->_pending.insert(pool->lext());
+            _parked++;
+            parked = true;
+        }
+        guard.release();
+
+        if(map) // some other context created the same mapping meanwhile
+            delete map;
+
+        if(created)
+            request(pa, HA(HA::BROADCAST));
+
+        unsigned int size = 0;
+        for(typename Buffer::Element * e = pool->link(); e; e = e->next())
+            size += e->object()->size();
+
+        if(ha) {
+            stamp(pool, ha);
+            return _nic->send(pool); // implicitly releases the pool
+        } else if(parked) {
+            db<ARP>(INF) << "ARP::send: parked until " << pa << " is resolved" << endl;
+            return size;
+        } else {
+            db<ARP>(WRN) << "ARP::send: too many buffers waiting for resolutions, dropping this one!" << endl;
+            release(pool);
+            return 0;
+        }
     }
 
 //    PA resolve(const HA & ha) {
@@ -235,58 +300,183 @@ public:
         Packet * packet = buf->frame()->template data<Packet>();
         db<ARP>(INF) << "ARP::update:pkt=" << packet << " => " << *packet << endl;
 
-        if((packet->op() == REQUEST) && (packet->tpa() == _net->address())) {
+        bool for_me = (packet->tpa() == _net->address());
+
+        // As in RFC 826, the sender's mapping is refreshed if known and learned if the packet was meant for us
+        Mapping * learned = 0;
+        typename Buffer::List flushed;
+
+        Spin_Guard<> guard(_lock);
+        Element * el = _table.search_key(key(packet->spa()));
+        if(!el && for_me) {
+            guard.release();
+            learned = new (SYSTEM) Mapping(packet->spa(), packet->sha());
+            guard.acquire();
+            el = _table.search_key(key(packet->spa()));
+            if(!el) {
+                _table.insert(learned->link());
+                learned = 0;
+            }
+        }
+        if(el) {
+            Mapping * map = el->object();
+            if(!map->_permanent) {
+                db<ARP>(TRC) << "ARP::update: " << packet->spa() << " is at " << packet->sha() << endl;
+                map->_ha = packet->sha();
+                map->_age = 0;
+                map->_tries = 0;
+                while(!map->_pending.empty()) {
+                    flushed.insert(map->_pending.remove());
+                    _parked--;
+                }
+            }
+        }
+        guard.release();
+
+        if(learned) // some other context learned it meanwhile
+            delete learned;
 
+        if(for_me && (packet->op() == REQUEST)) {
             Packet reply(REPLY, _nic->address(), _net->address(), packet->sha(), packet->spa());
             db<ARP>(TRC) << "ARP::update: replying query for " << packet->tpa() << " with " << reply << endl;
             _nic->send(packet->sha(), NIC::ARP, &reply, sizeof(Packet));
-
-        } else if((packet->op() == REPLY) && (packet->tha() == _nic->address())) {
-
-            lock();
-            Element * el = _table.search_key(packet->spa());
-            if(el) {
-                db<ARP>(TRC) << "ARP::update: got reply for query on " << packet->spa() << ": " << packet->sha() << endl;
-                el->object()->update(packet->sha());
-            } else
-                db<ARP>(WRN) << "ARP::update: got reply for query on " << packet->spa() << ", which is not in table!" << endl;
-            unlock();
-
         }
 
+        HA ha = packet->sha();
         _nic->free(buf);
+
+        if(el) {
+            while(!flushed.empty()) {
+                Buffer * pool = flushed.remove()->object();
+                stamp(pool, ha);
+                _nic->send(pool); // implicitly releases the pool
+            }
+            _resolved.broadcast();
+        }
     }
 
     void dump() {
         db<ARP>(INF) << "ARP::Table => {" << endl;
-        for(typename Table::Iterator it = _table.begin(); it != _table.end(); it++) {
-            if(it)
-                db<ARP>(INF) << hex << it << " => {" << it->key() << "," << it->object()->ha() << "}" << endl;
-            else
-                db<ARP>(INF) << hex << it << " => EMPTY" << endl;
-        }
+        for(unsigned int i = 0; i < BUCKETS; i++)
+            for(Element * el = _table[i]->head(); el; el = el->next())
+                db<ARP>(INF) << i << " => " << *el->object() << endl;
         db<ARP>(INF) << "}" << endl;
-
     }
 
 private:
-    void lock() {
-        CPU::int_disable();
-        if(Traits<System>::multicore)
-            _lock.acquire();
+    // Creates an incomplete mapping for "pa" and broadcasts the first request
+    void start(const PA & pa) {
+        Mapping * map = new (SYSTEM) Mapping(pa, HA(HA::NULL));
+
+        Spin_Guard<> guard(_lock);
+        bool fresh = !_table.search_key(key(pa));
+        if(fresh)
+            _table.insert(map->link());
+        guard.release();
+
+        if(fresh)
+            request(pa, HA(HA::BROADCAST));
+        else
+            delete map;
+    }
+
+    void request(const PA & pa, const HA & to) {
+        Packet request(REQUEST, _nic->address(), _net->address(), to, pa);
+        db<ARP>(INF) << "ARP::request:request=" << request << endl;
+        _nic->send(to, NIC::ARP, &request, sizeof(Packet));
+    }
+
+    static int sweeper(ARP * arp) {
+        while(true) {
+            arp->_tick.p();
+            arp->sweep();
+        }
+
+        return 0;
+    }
+
+    // Runs every TIMEOUT seconds (in the sweeper thread)
+    void sweep() {
+        static const unsigned int STALE = LIFETIME / TIMEOUT; // in sweeps
+
+        typename Table::List expired;
+        PA pa[REQUESTS];
+        HA ha[REQUESTS];
+        unsigned int requests = 0;
+
+        Spin_Guard<> guard(_lock);
+        for(unsigned int i = 0; i < BUCKETS; i++) {
+            for(Element * el = _table[i]->head(), * next; el; el = next) {
+                next = el->next();
+                Mapping * map = el->object();
+                if(map->_permanent)
+                    continue;
+
+                if(map->_ha && (++map->_age < STALE))
+                    continue;
+
+                if(map->_tries >= RETRIES) { // incomplete or stale, and unanswered
+                    _table.remove(el);
+                    drop(map);
+                    expired.insert(el);
+                } else if(requests < REQUESTS) {
+                    map->_tries++;
+                    pa[requests] = map->_pa;
+                    ha[requests] = map->_ha ? map->_ha : HA(HA::BROADCAST); // stale mappings are confirmed directly
+                    requests++;
+                }
+            }
+        }
+        guard.release();
+
+        for(unsigned int i = 0; i < requests; i++)
+            request(pa[i], ha[i]);
+
+        while(!expired.empty()) {
+            Mapping * map = expired.remove()->object();
+            db<ARP>(INF) << "ARP::sweep: " << *map << " expired" << endl;
+            delete map;
+        }
+    }
+
+    // Releases the pools parked on a mapping that is going away (must be called with the lock held)
+    void drop(Mapping * map) {
+        while(!map->_pending.empty()) {
+            release(map->_pending.remove()->object());
+            _parked--;
+        }
+    }
+
+    // Frames are allocated before their destination is known, so it is filled in right before sending
+    static void stamp(Buffer * pool, const HA & ha) {
+        for(typename Buffer::Element * el = pool->link(); el; el = el->next())
+            el->object()->frame()->dst(ha);
+    }
+
+    // Gives the transmit buffers of a pool that will never be sent back to the NIC
+    static void release(Buffer * pool) {
+        for(typename Buffer::Element * el = pool->link(); el; el = el->next())
+            el->object()->unlock();
     }
 
-    void unlock() {
-        if(Traits<System>::multicore)
-            _lock.release();
-        CPU::int_enable();
+    static Key key(const PA & pa) {
+        Key k = 0;
+        for(unsigned int i = 0; i < sizeof(PA); i++)
+            k = (k << 8) | pa[i];
+        return k;
     }
 
 private:
     Table _table;
+    unsigned int _parked;
     Spin _lock;
+    Condition _resolved;
     NIC * _nic;
     Network * _net;
+    Semaphore _tick;
+    Semaphore_Handler _handler;
+    Alarm _sweeper;
+    Thread * _sweeper_thread;
 };
 
 __END_SYS
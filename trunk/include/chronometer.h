@@ -60,8 +60,8 @@ public:
     Hertz frequency() { return Alarm::frequency(); }
 
     void reset() { _start = 0; _stop = 0; }
-    void start() { if(_start == 0) _start = Alarm::_elapsed; }
-    void lap() { if(_start != 0) _stop = Alarm::_elapsed; }
+    void start() { if(_start == 0) _start = Alarm::elapsed(); }
+    void lap() { if(_start != 0) _stop = Alarm::elapsed(); }
     void stop() { lap(); }
 
     // The cast provides resolution for intermediate calculations
@@ -72,7 +72,7 @@ private:
         if(_start == 0)
             return 0;
         if(_stop == 0)
-            return Alarm::_elapsed - _start;
+            return Alarm::elapsed() - _start;
         return _stop - _start;
     }
 
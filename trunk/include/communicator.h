@@ -48,6 +48,14 @@ public:
         return Channel::send(from, to, data, size);
     }
 
+    // Zero-copy sending (see UDP::alloc())
+    Buffer * alloc(const Address & to, unsigned int size) {
+        return Channel::alloc(_local, to, size);
+    }
+    int send(Buffer * pool) {
+        return Channel::send(pool);
+    }
+
     template<typename Message>
     int receive(const Message & message) {
         Buffer * buf = updated();
@@ -122,6 +130,8 @@ public:
         Channel::detach(this, _connection);
     }
 
+    typename Channel::Connection * connection() const { return _connection; }
+
     int send(const void * data, unsigned int size) {
         return _connection->send(data, size);
     }
@@ -173,6 +183,7 @@ private:
 
 public:
     // Channel imports
+    typedef typename Channel::Buffer Buffer;
     typedef typename Channel::Address Address;
     typedef typename Channel::Address::Local Local_Address;
 
@@ -187,6 +198,9 @@ public:
     int read(void * data, unsigned int size) { return receive_all(data, size); }
     int write(const void * data, unsigned int size) { return send(data, size); }
 
+    Buffer * alloc(unsigned int size) { return Base::alloc(_peer, size); }
+    int send(Buffer * pool) { return Base::send(pool); }
+
     const Address & peer() const { return _peer;}
 
 private:
@@ -232,6 +246,7 @@ private:
 
 public:
     // Channel imports
+    typedef typename Channel::Buffer Buffer;
     typedef typename Channel::Address Address;
     typedef typename Channel::Address::Local Local_Address;
 
@@ -243,6 +258,9 @@ public:
     int send(const Message & message) { return Base::send(message); }
     int send(const Address & to, const void * data, unsigned int size) { return Base::send(to, data, size); }
 
+    Buffer * alloc(const Address & to, unsigned int size) { return Base::alloc(to, size); }
+    int send(Buffer * pool) { return Base::send(pool); }
+
     template<typename Message>
     int receive(const Message & message) { return Base::receive(message); }
     int receive(Address * from, void * data, unsigned int size) { return Base::receive(from, data, size); }
@@ -108,7 +108,104 @@ public:
     static Reg32 ntohl(Reg32 v) { return htonl(v); }
     static Reg16 ntohs(Reg16 v) { return htons(v); }
 
+    // Internet checksum (RFC 1071) support
+    // csum() adds the 16-bit words of data (in memory order) to a partial sum using one's complement arithmetic,
+    // returning a new partial sum folded to 16 bits. Sums are kept in the CPU's byte order, so partial sums of
+    // consecutive pieces of a datagram (each but the last one with an even size) can simply be added and the
+    // complement of the final sum can be stored in a packet as is. csum_copy() does the same while copying data.
+    static Reg32 csum(const void * data, unsigned int size, Reg32 partial = 0) {
+        const unsigned char * ptr = reinterpret_cast<const unsigned char *>(data);
+        Reg64 sum = 0;
+
+        // At an odd address, sum the byte-swapped stream starting at the next byte and swap the result back
+        bool odd = Reg32(ptr) & 1;
+        if(odd && size) {
+            sum = BIG_ENDIAN ? *ptr : *ptr << 8;
+            ptr++;
+            size--;
+        }
+        if((Reg32(ptr) & 2) && (size >= 2)) {
+            sum += *reinterpret_cast<const Aliased_Reg16 *>(ptr);
+            ptr += 2;
+            size -= 2;
+        }
+
+        const Aliased_Reg32 * word = reinterpret_cast<const Aliased_Reg32 *>(ptr);
+        for(; size >= 16; size -= 16, word += 4)
+            sum += Reg64(word[0]) + word[1] + word[2] + word[3];
+        for(; size >= 4; size -= 4, word++)
+            sum += *word;
+
+        ptr = reinterpret_cast<const unsigned char *>(word);
+        if(size >= 2) {
+            sum += *reinterpret_cast<const Aliased_Reg16 *>(ptr);
+            ptr += 2;
+            size -= 2;
+        }
+        if(size)
+            sum += BIG_ENDIAN ? *ptr << 8 : *ptr;
+
+        Reg32 result = csum_fold(sum);
+        if(odd)
+            result = swap16(result);
+
+        return csum_fold(Reg64(result) + partial);
+    }
+
+    static Reg32 csum_copy(void * to, const void * from, unsigned int size, Reg32 partial = 0) {
+        unsigned char * dst = reinterpret_cast<unsigned char *>(to);
+        const unsigned char * src = reinterpret_cast<const unsigned char *>(from);
+
+        // Word-wide copies need both buffers equally aligned
+        if(((Reg32(dst) ^ Reg32(src)) & 3) || (Reg32(src) & 1)) {
+            for(unsigned int i = 0; i < size; i++)
+                dst[i] = src[i];
+            return csum(dst, size, partial);
+        }
+
+        Reg64 sum = 0;
+        if((Reg32(src) & 2) && (size >= 2)) {
+            sum += *reinterpret_cast<Aliased_Reg16 *>(dst) = *reinterpret_cast<const Aliased_Reg16 *>(src);
+            dst += 2;
+            src += 2;
+            size -= 2;
+        }
+
+        Aliased_Reg32 * d = reinterpret_cast<Aliased_Reg32 *>(dst);
+        const Aliased_Reg32 * s = reinterpret_cast<const Aliased_Reg32 *>(src);
+        for(; size >= 16; size -= 16, d += 4, s += 4) {
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = s[3];
+            sum += Reg64(d[0]) + d[1] + d[2] + d[3];
+        }
+        for(; size >= 4; size -= 4, d++, s++)
+            sum += *d = *s;
+
+        dst = reinterpret_cast<unsigned char *>(d);
+        src = reinterpret_cast<const unsigned char *>(s);
+        for(unsigned int i = 0; i < size; i++)
+            dst[i] = src[i];
+
+        return csum(dst, size, csum_fold(sum + partial));
+    }
+
+    // Folds a sum of 16-bit words into 16 bits with end-around carries
+    static Reg32 csum_fold(Reg64 sum) {
+        Reg32 tmp = Reg32(sum) + Reg32(sum >> 32);
+        if(tmp < Reg32(sum))
+            tmp++;
+        tmp = (tmp & 0xffff) + (tmp >> 16);
+        tmp = (tmp & 0xffff) + (tmp >> 16);
+        return tmp;
+    }
+
 protected:
+    // Word types for memory that is also accessed as other types (e.g. packets, in checksums)
+    typedef Reg16 __attribute__((may_alias)) Aliased_Reg16;
+    typedef Reg32 __attribute__((may_alias)) Aliased_Reg32;
+
     static Reg32 swap32(Reg32 v) { return (v & 0xff000000) >> 24 | (v & 0x00ff0000) >> 8 | (v & 0x0000ff00) << 8 | (v & 0x000000ff) << 24; }
     static Reg16 swap16(Reg16 v) { return (v & 0xff00) >> 8 | (v & 0x00ff) << 8; }
 };
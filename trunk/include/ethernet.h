@@ -44,6 +44,7 @@ public:
 
         const Address & src() const { return _src; }
         const Address & dst() const { return _dst; }
+        void dst(const Address & a) { _dst = a; }
 
         Protocol prot() const { return ntohs(_prot); }
 
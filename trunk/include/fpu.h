@@ -0,0 +1,39 @@
+// EPOS FPU Mediator Common Package
+
+#ifndef __fpu_h
+#define __fpu_h
+
+#include <system/config.h>
+
+__BEGIN_SYS
+
+class FPU_Common
+{
+protected:
+    FPU_Common() {}
+
+public:
+    // Architectures without FPU context switching keep no per-thread FPU state
+    class Context {};
+
+    static void switch_context(Context * next) {}
+    static void discard(Context * ctx) {}
+
+protected:
+    static void init() {}
+};
+
+__END_SYS
+
+#ifdef __FPU_H
+#include __FPU_H
+#else
+__BEGIN_SYS
+class FPU: public FPU_Common
+{
+    friend class Thread;
+};
+__END_SYS
+#endif
+
+#endif
@@ -135,6 +135,12 @@ void Agent::handle_task()
         in(cs, ds, entry);
         id(Id(TASK_ID, reinterpret_cast<Id::Unit_Id>(new Adapter<Task>(cs, ds, entry))));
     } break;
+    case CREATE_COPY: {
+        Task * original;
+        int (*entry)();
+        in(original, entry);
+        id(Id(TASK_ID, reinterpret_cast<Id::Unit_Id>(new Adapter<Task>(*original, entry))));
+    } break;
     case DESTROY:
         delete task;
         break;
@@ -252,6 +258,11 @@ void Agent::handle_segment()
     in(phy_addr, bytes, flags);
     id(Id(SEGMENT_ID, reinterpret_cast<Id::Unit_Id>(new Adapter<Segment>(phy_addr, bytes, flags))));
     } break;
+    case CREATE_COPY: {
+        Segment * original;
+        in(original);
+        id(Id(SEGMENT_ID, reinterpret_cast<Id::Unit_Id>(new Adapter<Segment>(*original))));
+    } break;
     case DESTROY:
         delete seg;
         break;
@@ -346,7 +357,39 @@ void Agent::handle_alarm()
 
 void Agent::handle_chronometer()
 {
-    result(UNDEFINED);
+    Adapter<Chronometer> * chrono = reinterpret_cast<Adapter<Chronometer> *>(id().unit());
+    Result res = 0;
+
+    switch(method()) {
+    case CREATE:
+        id(Id(CHRONOMETER_ID, reinterpret_cast<Id::Unit_Id>(new Adapter<Chronometer>())));
+        break;
+    case DESTROY:
+        delete chrono;
+        break;
+    case CHRONOMETER_FREQUENCY:
+        res = chrono->frequency();
+        break;
+    case CHRONOMETER_RESET:
+        chrono->reset();
+        break;
+    case CHRONOMETER_START:
+        chrono->start();
+        break;
+    case CHRONOMETER_LAP:
+        chrono->lap();
+        break;
+    case CHRONOMETER_STOP:
+        chrono->stop();
+        break;
+    case CHRONOMETER_READ:
+        res = chrono->read();
+        break;
+    default:
+        res = UNDEFINED;
+    }
+
+    result(res);
 };
 
 
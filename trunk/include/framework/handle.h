@@ -64,6 +64,10 @@ public:
     template<typename ... Tn>
     Handle(Handle<Segment> * cs, Handle<Segment> * ds, const Tn & ... an) { _stub = new _Stub(*cs->_stub, *ds->_stub, an ...); }
 
+    // Copying handles copies the components, as for Segment(const Segment &) and Task(const Task &, entry)
+    Handle(const Handle<Component> & h) { _stub = new _Stub(*h._stub); }
+    Handle(const Handle<Component> & h, int (* entry)()) { _stub = new _Stub(*h._stub, entry); }
+
     ~Handle() { if(_stub) delete _stub; }
 
     static Handle<Component> * self() { return new (_Stub::self()) Handled<Component>; }
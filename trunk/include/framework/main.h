@@ -31,6 +31,7 @@ __END_SYS
 #include <thread.h>
 #include <task.h>
 #include <alarm.h>
+#include <chronometer.h>
 #include <address_space.h>
 #include <segment.h>
 #include <mutex.h>
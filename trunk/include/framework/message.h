@@ -30,6 +30,7 @@ public:
         CREATE9,
         DESTROY,
         SELF,
+        CREATE_COPY, // creates a copy of the unit given as first parameter (e.g. Segment(const Segment &))
 
         COMPONENT = 0x10,
 
@@ -77,6 +78,13 @@ public:
         ALARM_SET_PERIOD,
         ALARM_FREQUENCY,
 
+        CHRONOMETER_FREQUENCY = COMPONENT,
+        CHRONOMETER_RESET,
+        CHRONOMETER_START,
+        CHRONOMETER_LAP,
+        CHRONOMETER_STOP,
+        CHRONOMETER_READ,
+
         COMMUNICATOR_SEND = COMPONENT,
         COMMUNICATOR_REPLY,
         COMMUNICATOR_RECEIVE,
@@ -54,6 +54,8 @@ private:
 public:
     template<typename ... Tn>
     Proxy(const Tn & ... an): Message(Id(Type<Component>::ID, 0)) { invoke(CREATE + sizeof ... (Tn), an ...); }
+    Proxy(const Proxy<Component> & p): Message(Id(Type<Component>::ID, 0)) { invoke(CREATE_COPY, p.id().unit()); }
+    Proxy(const Proxy<Component> & p, int (* entry)()): Message(Id(Type<Component>::ID, 0)) { invoke(CREATE_COPY, p.id().unit(), entry); }
     ~Proxy() { invoke(DESTROY); }
 
     static Proxy<Component> * self() { return new (reinterpret_cast<void *>(static_invoke(SELF))) Proxied<Component>; }
@@ -104,6 +106,14 @@ public:
     template<typename T>
     static void delay(T t) { static_invoke(ALARM_DELAY, t); }
 
+    void reset() { invoke(CHRONOMETER_RESET); }
+    void start() { invoke(CHRONOMETER_START); }
+    void lap() { invoke(CHRONOMETER_LAP); }
+    void stop() { invoke(CHRONOMETER_STOP); }
+
+    int frequency() { return invoke(CHRONOMETER_FREQUENCY); }
+    int read() { return invoke(CHRONOMETER_READ); }
+
     // Communication
     template<typename ... Tn>
     int send(Tn ... an) { return invoke(COMMUNICATOR_SEND, an ...); }
@@ -17,6 +17,10 @@ class Stub: public Adapter<Component>
 public:
     template<typename ... Tn>
     Stub(const Tn & ... an): Adapter<Component>(an ...) {}
+
+    // Copying stubs for Segment(const Segment &) (constructs the Adapter, and so leaves its scenario, as any other)
+    Stub(const Stub<Component, false> & s): Adapter<Component>(static_cast<const Component &>(s)) {}
+
     ~Stub() {}
 };
 
@@ -31,6 +35,10 @@ public:
     template<typename ... Tn>
     Stub(const Stub<Segment, true> & cs, const Stub<Segment, true> & ds, const Tn & ... an): Proxy<Component>(cs.id().unit(), ds.id().unit(), an ...) {}
 
+    // Copying stubs for Segment(const Segment &) and Task(const Task &, entry)
+    Stub(const Stub<Component, true> & s): Proxy<Component>(static_cast<const Proxy<Component> &>(s)) {}
+    Stub(const Stub<Component, true> & s, int (* entry)()): Proxy<Component>(static_cast<const Proxy<Component> &>(s), entry) {}
+
     ~Stub() {}
 };
 
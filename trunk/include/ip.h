@@ -3,7 +3,7 @@
 #ifndef __ip_h
 #define __ip_h
 
-#include <utility/bitmap.h>
+#include <utility/spin.h>
 #include <nic.h>
 #include <system.h>
 #include <arp.h>
@@ -17,6 +17,7 @@ class IP: private NIC::Observer
 
 public:
     static const unsigned int TIMEOUT = Traits<IP>::TIMEOUT * 1000000;
+    static const bool forwarding = Traits<IP>::forwarding;
 
     // IP Protocol Id
     static const unsigned int PROTOCOL = NIC::IP;
@@ -92,6 +93,18 @@ public:
         void sum() { _checksum = 0; _checksum = htons(IP::checksum(reinterpret_cast<unsigned char *>(this), _ihl * 4)); }
         bool check() { return (IP::checksum(reinterpret_cast<unsigned char *>(this), _ihl * 4) != 0xffff); }
 
+        // Decrements the TTL of a datagram being forwarded, updating the checksum incrementally (RFC 1624)
+        void hop() {
+            unsigned short o = word(4); // TTL and protocol
+            _ttl--;
+            _checksum = IP::checksum(_checksum, o, word(4));
+        }
+
+        // Updates the checksum of a copy of a (summed) header whose length, flags and offset were then changed
+        void resum(const Header & h) {
+            _checksum = IP::checksum(IP::checksum(h._checksum, h.word(1), word(1)), h.word(3), word(3));
+        }
+
         const Address & from() const { return _from; }
         void from(const Address & from){ _from = from; }
 
@@ -115,6 +128,14 @@ public:
             return db;
         }
 
+    private:
+        // i-th 16-bit word of the header, as found in the packet (copied, since the header is packed and might be unaligned)
+        unsigned short word(unsigned int i) const {
+            unsigned short w;
+            memcpy(&w, reinterpret_cast<const unsigned char *>(this) + i * sizeof(w), sizeof(w));
+            return w;
+        }
+
     private:
         unsigned char   _ihl:4;         // IP Header Length (in 32-bit words)
         unsigned char   _version:4;     // IP Version
@@ -179,9 +200,10 @@ private:
     // Fragment key = f(from, id) = (from & ~_netmask) << 16 | id (fragmentation can only happen on localnet)
     typedef unsigned long Key;
 
-    // List to hold received Buffers containing datagram fragments
+    // Datagrams being reassembled, hashed by key and queued by age (oldest first) for the timeout sweep
     class Fragmented;
     typedef Simple_Hash<Fragmented, Traits<Build>::NODES, Key> Reassembling;
+    typedef List<Fragmented> Aging;
 
     class Fragmented
     {
@@ -192,41 +214,53 @@ private:
         typedef Reassembling::Element Element;
 
     public:
-        Fragmented(const Key & key): _frags(MAX_FRAGMENTS), _handler(&timeout, this), _alarm(TIMEOUT, &_handler), _link(this, key) {}
+        Fragmented(const Key & key): _frags(0), _count(0), _born(_sweeps), _link(this, key), _age(this) {
+            for(unsigned int i = 0; i < MAX_FRAGMENTS; i++)
+                _fragments[i] = 0;
+        }
 
-        void insert(Buffer * buf) {
+        // Fragments are indexed by offset, so duplicates (and offsets past the last fragment) are refused in O(1)
+        bool insert(Buffer * buf) {
             Packet * packet = buf->frame()->data<Packet>();
+            unsigned int i = packet->offset() / MFS;
+
+            db<IP>(TRC) << "IP::Fragmented::insert(frags=" << _frags << ",count=" << _count << ",buf=" << buf << ") => " << *packet << endl;
 
-            if(_bitmap.set(packet->offset() / MFS)) // if not a dup, then insert
-                _list.insert(buf->link());
+            if((i >= MAX_FRAGMENTS) || _fragments[i] || (_frags && (i >= _frags)))
+                return false;
 
+            _fragments[i] = buf;
+            _count++;
             if(!(packet->flags() & Header::MF))
-                _frags = (packet->offset() + MFS) / MFS;
+                _frags = i + 1;
 
-            db<IP>(TRC) << "IP::Fragmented::insert(frags=" << _frags << ",buf=" << buf << ") => " << *packet << endl;
+            return true;
         }
 
-        bool reassembled() const { return _bitmap.full(_frags); }
-
-        void reorder();
-
-        Buffer * pool() { return _list.head()->object(); }
+        bool reassembled() const { return _frags && (_count == _frags); }
+        bool expired() const { return _sweeps - _born > 2; } // sweeps run every TIMEOUT / 2
+
+        // Links the fragments received so far in offset order and returns the first one, which heads the pool
+        Buffer * pool() {
+            for(unsigned int i = 0; i < MAX_FRAGMENTS; i++)
+                if(_fragments[i]) {
+                    _list.insert(_fragments[i]->link());
+                    _fragments[i] = 0;
+                }
+            return _list.head()->object();
+        }
 
         Element * link() { return &_link; }
+        Aging::Element * age() { return &_age; }
 
     private:
-        static void timeout(Fragmented * frag) {
-            frag->pool()->nic()->free(frag->pool());
-            delete frag;
-        }
-
-    private:
-        unsigned int _frags;
-        Bitmap<MAX_FRAGMENTS> _bitmap;
+        unsigned int _frags; // known once the last fragment arrives
+        unsigned int _count;
+        unsigned int _born; // sweep count when the first fragment arrived
+        Buffer * _fragments[MAX_FRAGMENTS];
         Buffer::List _list;
-        Functor_Handler<Fragmented> _handler;
-        Alarm _alarm;
         Element _link;
+        Aging::Element _age;
     };
 
 
@@ -234,21 +268,37 @@ private:
 
     class Route
     {
+        friend class IP;
         friend class Router;
 
     private:
-        typedef Simple_List<Route> Table;
+        typedef Simple_Ordered_List<Route> Table; // routes to the same destination, ranked by metric
         typedef Table::Element Element;
 
+    public:
+        struct Statistics
+        {
+            Statistics(): tx_datagrams(0), tx_bytes(0), forwarded_datagrams(0), forwarded_bytes(0), dropped(0) {}
+
+            unsigned int tx_datagrams;          // originated by this node
+            unsigned int tx_bytes;
+            unsigned int forwarded_datagrams;   // received from another node and forwarded
+            unsigned int forwarded_bytes;
+            unsigned int dropped;               // could not be forwarded (e.g. TTL exceeded or malformed)
+        };
+
     public:
         Route(NIC * nic, IP * ip, ARP<NIC, IP> * arp, const Address & d, const Address & g, const Address & m, unsigned int t = 0, unsigned int w = 0):
-            _destination(d), _gateway(g), _genmask(m), _flags(t), _metric(w), _nic(nic), _ip(ip), _arp(arp), _link(this) {}
+            _destination(d), _gateway(g), _genmask(m), _flags(t), _metric(w), _nic(nic), _ip(ip), _arp(arp), _link(this, w) {}
 
         const Address & gateway() const { return _gateway; }
+        const Address & next_hop(const Address & to) const { return (_gateway == _ip->address()) ? to : _gateway; }
         NIC * nic() { return _nic; }
         IP * ip() { return _ip; }
         ARP<NIC, IP> * arp() { return _arp; }
 
+        const Statistics & statistics() const { return _statistics; }
+
         friend Debug & operator<<(Debug & db, const Route & r) {
             db << "{d=" << r._destination
                 << ",g=" << r._gateway
@@ -257,6 +307,9 @@ private:
                 << ",w=" << r._metric
                 << ",nic=" << r._nic
                 << ",ip=" << r._ip
+                << ",tx=" << r._statistics.tx_datagrams
+                << ",fw=" << r._statistics.forwarded_datagrams
+                << ",drop=" << r._statistics.dropped
                 << "}";
             return db;
         }
@@ -270,56 +323,127 @@ private:
         NIC * _nic;
         IP * _ip;
         ARP<NIC, IP> * _arp;
+        Statistics _statistics;
 
         Element _link;
     };
 
 
+    // Routing table as a path-compressed binary trie of destination prefixes (genmasks are assumed to be contiguous).
+    // Each node holds the routes to exactly its prefix, so the longest-prefix match is the deepest node with routes
+    // found on the way down, which takes at most as many steps as the address has bits, whatever the number of routes.
     class Router
     {
     private:
-        typedef Route::Table::Element Element;
+        typedef CPU::Reg32 Key;
+
+        static const unsigned int BITS = sizeof(Key) * 8;
+
+        class Node
+        {
+        public:
+            Node(const Key & prefix, unsigned int length): _prefix(prefix), _length(length) { _child[0] = _child[1] = 0; }
+
+            bool covers(const Key & key) const { return (key & mask(_length)) == _prefix; }
+            Node ** next(const Key & key) { return (_length < BITS) ? &_child[bit(key, _length)] : 0; }
+
+        public:
+            Key _prefix;        // with the bits past _length cleared
+            unsigned int _length;
+            Route::Table _routes;
+            Node * _child[2];   // indexed by the first bit past _length
+        };
 
     public:
+        Router(): _root(0, 0) {}
+
         void insert(NIC * nic, IP * ip, ARP<NIC, IP> * arp, const Address & d, const Address & g, const Address & m, unsigned int t = 0, unsigned int w = 0) {
             Route * route = new (SYSTEM) Route(nic, ip, arp, d, g, m, t, w);
 
             db<IP>(TRC) << "IP::Router::insert() => " << *route << endl;
 
-            _table.insert(&route->_link);
+            unsigned int length = prefix(m);
+            Key key = bits(d) & mask(length);
+
+            Node * node = &_root;
+            while(node->_length != length) {
+                Node ** link = node->next(key);
+                Node * child = *link;
+
+                if(!child) { // no more specific prefix along this path
+                    node = *link = new (SYSTEM) Node(key, length);
+                    break;
+                }
+
+                unsigned int common = shared(key, length, child->_prefix, child->_length);
+                if(common < child->_length) { // the new prefix diverges from (or is shorter than) the child's, so split the edge
+                    Node * split = new (SYSTEM) Node(key & mask(common), common);
+                    split->_child[bit(child->_prefix, common)] = child;
+                    *link = split;
+                }
+                node = *link;
+            }
+
+            node->_routes.insert(&route->_link);
         }
 
         void remove(const Address & to) {
             db<IP>(TRC) << "IP::Router::remove(to=" << to << ")" << endl;
 
-            Element * e = _table.head();
-            for(; e && ((to & e->object()->_genmask) != e->object()->_destination); e = e->next());
-            if(e) {
-                db<IP>(INF) << "IP::Router::remove: removing and deleting " << *e->object() << endl;
+            Node * node = lookup(bits(to));
+            if(node) {
+                Route * route = node->_routes.remove_head()->object();
+
+                db<IP>(INF) << "IP::Router::remove: removing and deleting " << *route << endl;
 
-                _table.remove(e);
-                delete e->object();
+                delete route; // the node is kept (routing tables seldom shrink and empty nodes are just skipped)
             }
         }
 
-        Route * search(Address to) {
-            // Assume default (0.0.0.0) to have genmask 0.0.0.0 and be the last route in table
-            // Assume all routes to be network routes (i.g. flags "G")
+        Route * search(const Address & to) {
             db<IP>(TRC) << "IP::Route::search(to=" << to << ")" << endl;
 
-            Element * e = _table.head();
-            for(; e && ((to & e->object()->_genmask) != e->object()->_destination); e = e->next());
-            if(e) {
-                db<IP>(INF) << "IP::Route::search: found route to " << to << " => " << *e->object() << endl;
-                return e->object();
+            Node * node = lookup(bits(to));
+            if(node) {
+                db<IP>(INF) << "IP::Route::search: found route to " << to << " => " << *node->_routes.head()->object() << endl;
+                return node->_routes.head()->object();
             } else
                 return 0;
         }
 
     private:
-        Route::Table _table;
-    };
+        // Deepest node with routes whose prefix covers key
+        Node * lookup(const Key & key) {
+            Node * found = 0;
+            for(Node * node = &_root; node && node->covers(key); node = node->next(key) ? *node->next(key) : 0)
+                if(!node->_routes.empty())
+                    found = node;
+            return found;
+        }
 
+        static Key bits(const Address & a) { return (Key(a[0]) << 24) | (Key(a[1]) << 16) | (Key(a[2]) << 8) | Key(a[3]); }
+        static Key mask(unsigned int length) { return length ? ~Key(0) << (BITS - length) : 0; }
+        static unsigned int bit(const Key & key, unsigned int i) { return (key >> (BITS - 1 - i)) & 1; }
+
+        static unsigned int prefix(const Address & genmask) {
+            unsigned int length = 0;
+            for(Key m = bits(genmask); m & (Key(1) << (BITS - 1)); m <<= 1)
+                length++;
+            return length;
+        }
+
+        // Number of leading bits two prefixes have in common
+        static unsigned int shared(const Key & a, unsigned int la, const Key & b, unsigned int lb) {
+            unsigned int length = (la < lb) ? la : lb;
+            Key diff = (a ^ b) & mask(length);
+            unsigned int common = 0;
+            for(; (common < length) && !(diff & (Key(1) << (BITS - 1 - common))); common++);
+            return common;
+        }
+
+    private:
+        Node _root; // 0.0.0.0/0, where default routes go
+    };
 
 protected:
     template<unsigned int UNIT = 0>
@@ -359,8 +483,14 @@ public:
 
     static const unsigned int mtu() { return MTU; }
 
+    // Internet checksum (RFC 1071) of data, in host byte order (see CPU::csum() to sum and copy data in pieces)
     static unsigned short checksum(const void * data, unsigned int size);
 
+    // Incremental update (RFC 1624) of a checksum after a 16-bit word it covers changed from o to n (all as found in the packet)
+    static unsigned short checksum(unsigned short checksum, unsigned short o, unsigned short n) {
+        return ~CPU::csum_fold(CPU::Reg32(static_cast<unsigned short>(~checksum)) + static_cast<unsigned short>(~o) + n);
+    }
+
     static void attach(Observer * obs, const Protocol & prot) { _observed.attach(obs, prot); }
     static void detach(Observer * obs, const Protocol & prot) { _observed.detach(obs, prot); }
 
@@ -381,6 +511,11 @@ private:
     void config_by_dhcp();
 
     void update(NIC::Observed * obs, NIC::Protocol prot, Buffer * buf);
+    void forward(Buffer * buf);
+    void reassemble(Buffer * buf);
+
+    static int sweeper();
+    static void sweep();
 
     static bool notify(const Protocol & prot, Buffer * buf) { return _observed.notify(prot, buf); }
 
@@ -398,6 +533,13 @@ protected:
     static IP * _networks[Traits<NIC>::UNITS];
     static Router _router;
     static Reassembling _reassembling;
+    static Aging _aging;
+    static Spin _reassembling_lock;
+    static Semaphore * _sweep_tick;
+    static Semaphore_Handler * _sweeper_handler;
+    static Alarm * _sweeper; // a single periodic sweep expires stale reassemblies (in a thread, since it frees memory)
+    static Thread * _sweeper_thread;
+    static volatile unsigned int _sweeps;
     static Observed _observed; // shared by all IP instances, so the default for binding on a port is for all IPs
 };
 
@@ -54,6 +54,11 @@ template <> struct Traits<Timer>: public Traits<Machine_Common>
     // 10000 Hz. The choice must respect the scheduler time-slice, i. e.,
     // it must be higher than the scheduler invocation frequency.
     static const int FREQUENCY = 1000; // Hz
+
+    // In tickless mode, the timer is programmed in one-shot mode for the next
+    // expiration among its channels (e.g. the next Alarm) instead of
+    // interrupting at every tick. It is only available on single-core systems.
+    static const bool tickless = false;
 };
 
 template <> struct Traits<UART>: public Traits<Machine_Common>
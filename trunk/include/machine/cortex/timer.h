@@ -40,6 +40,19 @@ public:
         priv_timer(PTLR) = CLOCK / f;
         priv_timer(PTCLR) = IRQ_EN | AUTO_RELOAD;
     }
+
+    // One-shot operation (used by the tickless Timer)
+    static const Count MAX = 0xffffffff;
+
+    static void one_shot(const Count & count) {
+        priv_timer(PTCLR) = 0;
+        priv_timer(PTISR) = INT_CLR;
+        priv_timer(PTLR) = count; // also loads the counter
+        priv_timer(PTCLR) = IRQ_EN | TIMER_ENABLE;
+    }
+
+    static Count read() { return priv_timer(PTCTR); }
+    static bool expired() { return !priv_timer(PTCTR); } // stops at zero without AUTO_RELOAD
 };
 
 // Cortex-A Global Timer
@@ -112,6 +125,29 @@ public:
         scs(STRELOAD) = CLOCK / f;
         scs(STCTRL) = CLKSRC | INTEN;
     }
+
+    // One-shot operation (used by the tickless Timer)
+    static const Count MAX = 0x00ffffff;
+
+    static void one_shot(const Count & count) {
+        scs(STCTRL) = 0;
+        scs(STRELOAD) = count - 1;
+        scs(STCURRENT) = 0;
+        _expired = false;
+        scs(STCTRL) = CLKSRC | INTEN | ENABLE;
+    }
+
+    static Count read() { return scs(STCURRENT); }
+
+    // SysTick reloads and keeps on counting after reaching zero, and reading STCTRL clears COUNT, so remember it
+    static bool expired() {
+        if(scs(STCTRL) & COUNT)
+            _expired = true;
+        return _expired;
+    }
+
+private:
+    static volatile bool _expired;
 };
 
 // Cortex-M General Purpose Timer
@@ -213,6 +249,9 @@ public:
         USER
     };
 
+    // Tickless operation (see Traits<Timer>::tickless)
+    static const bool tickless = Traits<Timer>::tickless && !Traits<System>::multicore;
+
 protected:
     Timer(unsigned int channel, const Hertz & frequency, const Handler & handler, bool retrigger = true)
     : _channel(channel), _initial(FREQUENCY / frequency), _retrigger(retrigger), _handler(handler) {
@@ -252,12 +291,27 @@ public:
 
     void handler(const Handler & handler) { _handler = handler; }
 
+    // Tickless mode only: next expiration of this channel in "ticks" ticks (must be called with interrupts disabled)
+    void arm(const Tick & ticks) {
+        account();
+        _current[0] = (ticks <= 0) ? 1 : (static_cast<unsigned long>(ticks) < Count(~0)) ? ticks : Count(~0);
+        program();
+    }
+
+    // Tickless mode only: ticks elapsed since the timer was initialized
+    static Tick elapsed() { return _elapsed + (consumed() + _phase) / per_tick(); }
+
     static void eoi(const IC::Interrupt_Id & int_id) { Engine::eoi(int_id); }
 
 private:
     static Hertz count2freq(const Count & c) { return c ? Engine::clock() / c : 0; }
     static Count freq2count(const Hertz & f) { return f ? Engine::clock() / f : 0;}
 
+    static Count per_tick() { return Engine::clock() / FREQUENCY; }
+    static Count consumed();
+    static void account();
+    static void program();
+
     static void int_handler(const Interrupt_Id & i);
 
     static void init();
@@ -270,6 +324,12 @@ private:
     Handler _handler;
 
     static Timer * _channels[CHANNELS];
+
+    // Tickless state: ticks accounted for so far, counts elapsed in the current tick
+    // when the engine was last programmed and the count it was programmed with
+    static volatile Tick _elapsed;
+    static volatile Count _phase;
+    static volatile Count _programmed;
 };
 
 // Timer used by Thread::Scheduler
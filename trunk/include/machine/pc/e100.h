@@ -5,6 +5,7 @@
 
 #include <ic.h>
 #include <ethernet.h>
+#include <utility/spin.h>
 
 __BEGIN_SYS
 
@@ -398,7 +399,6 @@ protected:
     volatile unsigned int _tx_cuc_suspended;
     Ethernet::Address _address;
     Ethernet::Statistics _statistics;
-    Ethernet::Buffer * _tx_buffer_prev; // Previously transmitted buffer
 };
 
 class i82559ER: public i8255x // Works with QEMU
@@ -542,6 +542,11 @@ private:
     static const unsigned int UNITS = Traits<E100>::UNITS;
     static const unsigned int TX_BUFS = Traits<E100>::SEND_BUFFERS;
     static const unsigned int RX_BUFS = Traits<E100>::RECEIVE_BUFFERS;
+
+    // Deferred reception
+    static const bool deferred = Traits<E100>::deferred;
+    static const unsigned int BUDGET = Traits<E100>::BUDGET;
+
     static const unsigned int DMA_BUFFER_SIZE =
         ((sizeof(ConfigureCB) + 15) & ~15U) +
         ((sizeof(MACaddrCB) + 15) & ~15U) +
@@ -577,10 +582,21 @@ public:
 
     void reset();
 
+    // The first observer to attach (necessarily a thread) starts the receiver thread
+    void attach(Ethernet::Observer * obs, Ethernet::Protocol prot) { defer(); Ethernet::Observed::attach(obs, prot); }
+
     static E100 * get(unsigned int unit = 0) { return get_by_unit(unit); }
 
 private:
+    Buffer * seize();
+    void kick(int last);
+
     void handle_int();
+    unsigned int handle_rx(unsigned int budget);
+    bool rx_pending() { return _rx_ring[_rx_cur].status & cb_complete; }
+
+    void defer();
+    static int receiver(E100 * dev);
 
     static void int_handler(const IC::Interrupt_Id & interrupt);
 
@@ -713,17 +729,23 @@ private:
     Rx_Desc * _rx_ring;
     Phy_Addr _rx_ring_phy;
 
-    int _tx_cur, _tx_prev;
+    int _tx_cur;        // next TxCB to fill
+    int _tx_prev;       // last TxCB handed over to the CU (the one carrying the suspend bit)
     Tx_Desc * _tx_ring;
     Phy_Addr _tx_ring_phy;
+    Spin _tx_lock;
 
     unsigned int _tx_frames_sent;
 
     Buffer * _rx_buffer[RX_BUFS];
     Buffer * _tx_buffer[TX_BUFS];
+    unsigned int _tx_hint; // where to start looking for a free transmit buffer
 
     DMA_Buffer * _dma_buffer;
 
+    Thread * _receiver;
+    Semaphore * _rx_ready;
+
     static Device _devices[UNITS];
 
 private:
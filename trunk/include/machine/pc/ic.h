@@ -474,6 +474,9 @@ public:
 
     using Engine::ipi_send;
 
+    // Page faults are first offered to a handler (e.g. MMU::page_fault), which returns whether it could resolve them
+    typedef bool (* Fault_Handler)(const Log_Addr & address, Reg32 error);
+
 public:
     IC() {}
 
@@ -488,6 +491,11 @@ public:
         _int_vector[i] = h;
     }
 
+    static void fault_handler(const Fault_Handler & h) {
+        db<IC>(TRC) << "IC::fault_handler(h=" << reinterpret_cast<void *>(h) <<")" << endl;
+        _fault_handler = h;
+    }
+
     static void enable() {
         db<IC>(TRC) << "IC::enable()" << endl;
         assert(i < INTS);
@@ -529,11 +537,19 @@ private:
         }
     }
 
+    // Stack frame built by entry_pf() (pushal over the CPU's exception frame)
+    struct Fault_Frame {
+        Reg32 edi, esi, ebp, esp, ebx, edx, ecx, eax;
+        Reg32 error, eip, cs, eflags;
+    };
+
     // Logical handlers
     static void int_not(const Interrupt_Id & i);
 
     // Physical handlers
     static void entry();
+    static void entry_pf();
+    static void page_fault(Fault_Frame * frame);
     static void exc_not(Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error);
     static void exc_pf (Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error);
     static void exc_gpf(Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error);
@@ -543,6 +559,7 @@ private:
 
 private:
     static Interrupt_Handler _int_vector[INTS];
+    static Fault_Handler _fault_handler;
 };
 
 __END_SYS
@@ -73,6 +73,11 @@ template<> struct Traits<Timer>: public Traits<Machine_Common>
     // 10000 Hz. The choice must respect the scheduler time-slice, i. e.,
     // it must be higher than the scheduler invocation frequency.
     static const int FREQUENCY = 1000; // Hz
+
+    // In tickless mode, the timer is programmed in one-shot mode for the next
+    // expiration among its channels (e.g. the next Alarm) instead of
+    // interrupting at every tick. It is only available on single-core systems.
+    static const bool tickless = false;
 };
 
 template<> struct Traits<RTC>: public Traits<Machine_Common>
@@ -139,6 +144,9 @@ template<> struct Traits<PCNet32>: public Traits<NIC>
     static const unsigned int RECEIVE_BUFFERS = 256; // per unit
 
     static const bool promiscuous = false;
+
+    static const bool deferred = true; // receive frames in a high-priority thread instead of in the interrupt handler
+    static const unsigned int BUDGET = 64; // frames handled per polling round of the receiving thread
 };
 
 template<> struct Traits<E100>: public Traits<NIC>
@@ -148,6 +156,9 @@ template<> struct Traits<E100>: public Traits<NIC>
     static const unsigned int RECEIVE_BUFFERS = 64; // per unit
 
     static const bool promiscuous = false;
+
+    static const bool deferred = true; // receive frames in a high-priority thread instead of in the interrupt handler
+    static const unsigned int BUDGET = 64; // frames handled per polling round of the receiving thread
 };
 
 template<> struct Traits<C905>: public Traits<NIC>
@@ -159,6 +170,14 @@ template<> struct Traits<C905>: public Traits<NIC>
     static const bool promiscuous = false;
 };
 
+template<> struct Traits<Loopback>: public Traits<NIC>
+{
+    static const unsigned int UNITS = NICS::Count<Loopback>::Result;
+    static const unsigned int BUFFERS = 64; // per unit, shared by sending and receiving
+
+    static const bool promiscuous = false;
+};
+
 template<> struct Traits<FPGA>: public Traits<Machine_Common>
 {
     static const bool enabled = false;
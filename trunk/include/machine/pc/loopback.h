@@ -0,0 +1,88 @@
+// EPOS PC Loopback (In-Memory) Ethernet NIC Mediator Declarations
+
+#ifndef __loopback_h
+#define __loopback_h
+
+#include <ethernet.h>
+#include <utility/spin.h>
+
+__BEGIN_SYS
+
+// A NIC without hardware: frames sent through any Loopback unit travel through memory to every unit in the
+// image whose address matches the frame's destination (or to all of them, for broadcasts). A single unit thus
+// loops frames back to itself, while several units behave like nodes sharing a wire. Frames are handed over
+// without copying (only broadcasts reaching more than one unit are copied) and are delivered to the observers
+// by a high-priority receiver thread, just like the deferred reception of PCNet32 and E100, so the network
+// stack can be exercised and measured without emulated devices or host network setup.
+class Loopback: public Ethernet::NIC_Base<Ethernet, Traits<NIC>::NICS::Polymorphic>
+{
+    template<int unit> friend void call_init();
+
+private:
+    static const unsigned int UNITS = Traits<Loopback>::UNITS;
+    static const unsigned int BUFS = Traits<Loopback>::BUFFERS;
+    static const unsigned int QUEUE = BUFS / 2; // frames waiting for reception, beyond which new ones are dropped
+    static const bool promiscuous = Traits<Loopback>::promiscuous;
+
+protected:
+    Loopback(unsigned int unit);
+
+public:
+    ~Loopback();
+
+    int send(const Address & dst, const Protocol & prot, const void * data, unsigned int size);
+    int receive(Address * src, Protocol * prot, void * data, unsigned int size);
+
+    Buffer * alloc(NIC * nic, const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload);
+    void free(Buffer * buf);
+    int send(Buffer * buf);
+
+    const Address & address() { return _address; }
+    void address(const Address & address) { _address = address; }
+
+    const Statistics & statistics() { return _statistics; }
+
+    void reset();
+
+    // The first observer to attach (necessarily a thread) starts the receiver thread
+    void attach(Ethernet::Observer * obs, Ethernet::Protocol prot) { defer(); Ethernet::Observed::attach(obs, prot); }
+
+    static Loopback * get(unsigned int unit = 0) { return get_by_unit(unit); }
+
+private:
+    Buffer * seize();
+    void transmit(Buffer * buf);
+    void deliver(Buffer * buf);
+    Buffer * retrieve();
+
+    void defer();
+    static int receiver(Loopback * dev);
+
+    static Loopback * get_by_unit(unsigned int unit) {
+        assert(unit < UNITS);
+        return _devices[unit];
+    }
+
+    static void init(unsigned int unit);
+
+private:
+    unsigned int _unit;
+
+    Address _address;
+    Statistics _statistics;
+
+    unsigned int _cur;
+    Buffer * _buffer[BUFS];
+
+    Buffer::List _received; // frames waiting for reception, linked through Buffer::lext()
+    Semaphore * _rx_ready;
+    Spin _lock;
+
+    Thread * _receiver;
+
+    static Loopback * _devices[UNITS];
+};
+
+__END_SYS
+
+#endif
@@ -9,6 +9,7 @@
 #include "pcnet32.h"
 #include "e100.h"
 #include "c905.h"
+#include "loopback.h"
 
 __BEGIN_SYS
 
@@ -47,7 +48,7 @@ public:
 
     void reset() { _dev->reset(); }
 
-    void attach(Observer * obs, const Protocol & prot) { _dev->Ethernet::Observed::attach(obs, prot); }
+    void attach(Observer * obs, const Protocol & prot) { _dev->attach(obs, prot); }
     void detach(Observer * obs, const Protocol & prot) { _dev->Ethernet::Observed::detach(obs, prot); }
     void notify(const Protocol & prot, Buffer * buf) { _dev->Ethernet::Observed::notify(prot, buf); }
 
@@ -4,6 +4,7 @@
 #define __pcnet32_h
 
 #include <ethernet.h>
+#include <utility/spin.h>
 
 __BEGIN_SYS
 
@@ -403,6 +404,10 @@ private:
     static const unsigned int RX_BUFS =	Traits<PCNet32>::RECEIVE_BUFFERS;
     static const bool promiscuous = Traits<PCNet32>::promiscuous;
 
+    // Deferred reception
+    static const bool deferred = Traits<PCNet32>::deferred;
+    static const unsigned int BUDGET = Traits<PCNet32>::BUDGET;
+
     // Size of the DMA Buffer that will host the ring buffers and the init block
     static const unsigned int DMA_BUFFER_SIZE = ((sizeof(Init_Block) + 15) & ~15U) +
         RX_BUFS * ((sizeof(Rx_Desc) + 15) & ~15U) + TX_BUFS * ((sizeof(Tx_Desc) + 15) & ~15U) +
@@ -434,10 +439,22 @@ public:
 
     void reset();
 
+    // The first observer to attach (necessarily a thread) starts the receiver thread
+    void attach(Ethernet::Observer * obs, Ethernet::Protocol prot) { defer(); Ethernet::Observed::attach(obs, prot); }
+
     static PCNet32 * get(unsigned int unit = 0) { return get_by_unit(unit); }
 
 private:
+    Buffer * seize();
+    void reclaim();
+    Phy_Addr phy(Buffer * buf) { return _dma_buf->phy_address() + (Log_Addr(buf) - _dma_buf->log_address()); }
+
     void handle_int();
+    unsigned int handle_rx(unsigned int budget);
+    bool rx_pending() { return !(_rx_ring[_rx_cur].status & Rx_Desc::OWN); }
+
+    void defer();
+    static int receiver(PCNet32 * dev);
 
     static void int_handler(const IC::Interrupt_Id & interrupt);
 
@@ -472,12 +489,20 @@ private:
     Rx_Desc * _rx_ring;
     Phy_Addr _rx_ring_phy;
 
-    int _tx_cur;
+    int _tx_cur;        // next descriptor to hand over to the NIC
+    int _tx_done;       // oldest descriptor handed over and not yet reclaimed
+    int _tx_pending;    // descriptors handed over and not yet reclaimed
     Tx_Desc * _tx_ring;
     Phy_Addr _tx_ring_phy;
+    Spin _tx_lock;
 
     Buffer * _rx_buffer[RX_BUFS];
     Buffer * _tx_buffer[TX_BUFS];
+    Buffer * _tx_sent[TX_BUFS]; // buffer of each descriptor handed over
+    unsigned int _tx_hint; // where to start looking for a free transmit buffer
+
+    Thread * _receiver;
+    Semaphore * _rx_ready;
 
     static Device _devices[UNITS];
 };
@@ -89,7 +89,7 @@ public:
         break;
         default:
             cnt = CNT_0;
-            control = DEF_CTRL_C0;
+            control = periodic ? DEF_CTRL_C0 : (SC0 | LMSB | IOTC | BINARY);
         }
 
         CPU::out8(CTRL, control);
@@ -256,6 +256,9 @@ public:
         USER
     };
 
+    // Tickless operation (see Traits<Timer>::tickless)
+    static const bool tickless = Traits<Timer>::tickless && !Traits<System>::multicore;
+
     using Timer_Common::Hertz;
     using Timer_Common::Tick;
     using Timer_Common::Microsecond;
@@ -301,10 +304,25 @@ public:
     static void enable() { IC::enable(IC::INT_TIMER); }
     static void disable() { IC::disable(IC::INT_TIMER); }
 
+    // Tickless mode only: next expiration of this channel in "ticks" ticks (must be called with interrupts disabled)
+    void arm(const Tick & ticks) {
+        account();
+        _current[0] = (ticks <= 0) ? 1 : (static_cast<unsigned long>(ticks) < Count(~0)) ? ticks : Count(~0);
+        program();
+    }
+
+    // Tickless mode only: ticks elapsed since the timer was initialized
+    static Tick elapsed() { return _elapsed + (consumed() + _phase) / per_tick(); }
+
  private:
     static Hertz count2freq(const Count & c) { return c ? Engine::clock() / c : 0; }
     static Count freq2count(const Hertz & f) { return f ? Engine::clock() / f : 0; }
 
+    static Count per_tick() { return Engine::clock() / FREQUENCY; }
+    static Count consumed();
+    static void account();
+    static void program();
+
     static void int_handler(const Interrupt_Id & i);
 
     static void init();
@@ -317,6 +335,12 @@ protected:
     Handler _handler;
 
     static Timer * _channels[CHANNELS];
+
+    // Tickless state: ticks accounted for so far, counts elapsed in the current tick
+    // when the engine was last programmed and the count it was programmed with
+    static volatile Tick _elapsed;
+    static volatile Count _phase;
+    static volatile Count _programmed;
 };
 
 
@@ -44,6 +44,7 @@ public:
             CD  = 0x010, // Cache Disable (0=cacheable, 1=non-cacheable)
             CT  = 0x020, // Contiguous (0=non-contiguous, 1=contiguous)
             IO  = 0x040, // Memory Mapped I/O (0=memory, 1=I/O)
+            DZ  = 0x080, // Demand-zero (0=frames allocated upfront, 1=frames allocated and cleared when first touched)
             SYS = (PRE | RW ),
             APP = (PRE | RW | USR)
         };
@@ -8,17 +8,47 @@
 
 __BEGIN_SYS
 
+// Uncontended lock() and unlock() take a single atomic instruction, unless a real-time locking protocol is in use.
+// Under the real-time locking protocols selected by Traits<Mutex>::PROTOCOL, mutexes keep track of their owners,
+// which are boosted either to the priority of their highest-priority waiter (INHERITANCE), transitively on non-SMP
+// configurations, or to the mutex's ceiling while holding it (CEILING). Priorities are those of the scheduling
+// criterion in use (e.g. periods for RM) and lower values mean higher priorities. Under dynamic criteria (e.g. EDF),
+// jobs must release their mutexes before waiting for their next periods.
 class Mutex: protected Synchronizer_Common
 {
+    friend class Thread;
+
+private:
+    static const bool inheritance = (Traits<Mutex>::PROTOCOL == Traits<Mutex>::INHERITANCE);
+    static const bool ceiling = (Traits<Mutex>::PROTOCOL == Traits<Mutex>::CEILING);
+    static const bool protocol = inheritance || ceiling;
+
+    typedef List<Mutex>::Element Element;
+
+    // States (CONTENDED means there might be threads waiting)
+    enum { UNLOCKED, LOCKED, CONTENDED };
+
 public:
-    Mutex();
+    // c = priority of the highest-priority thread that might lock the mutex (used only under CEILING)
+    Mutex(int c = Thread::HIGH);
     ~Mutex();
 
     void lock();
     void unlock();
 
 private:
-    volatile bool _locked;
+    bool spin();
+    void acquired(Thread * owner);
+    void released();
+
+    // Priority imposed by this mutex on its owner
+    int priority() { return ceiling ? _ceiling : _queue.empty() ? int(Thread::IDLE) : int(_queue.head()->rank()); }
+
+private:
+    volatile int _locked;
+    Thread * volatile _owner;
+    int _ceiling;
+    Element _link;
 };
 
 
@@ -38,7 +38,7 @@ protected:
         ~Dynamic_Handler() {}
 
         void operator()() {
-            _thread->criterion().update();
+            _thread->update();
 
             Semaphore_Handler::operator()();
         }
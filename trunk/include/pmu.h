@@ -30,6 +30,7 @@ public:
         LLC_MISS = L3_MISS,
         CACHE_MISS = LLC_MISS,
         LLC_HITM,
+        DTLB_MISS,
         EVENTS
     };
 
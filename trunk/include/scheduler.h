@@ -17,6 +17,7 @@ namespace Scheduling_Criteria
     // Priority (static and dynamic)
     class Priority
     {
+        friend class _SYS::Thread;
         friend class _SYS::RT_Thread;
 
     public:
@@ -32,6 +33,8 @@ namespace Scheduling_Criteria
         static const bool dynamic = false;
         static const bool preemptive = true;
 
+        static const unsigned int QUEUES = 1;
+
     public:
         Priority(int p = NORMAL): _priority(p) {}
 
@@ -40,6 +43,8 @@ namespace Scheduling_Criteria
         void update() {}
         unsigned int queue() const { return 0; }
 
+        static unsigned int current_queue() { return 0; }
+
     protected:
         volatile int _priority;
     };
@@ -290,29 +295,67 @@ namespace Scheduling_Criteria
 template<typename T, typename R = typename T::Criterion>
 class Scheduling_Queue: public Scheduling_List<T> {};
 
+// Static priority criteria can use constant-time, bitmap-indexed lists and
+// dynamic priority ones can use heap-ordered lists (see Traits<Thread>::indexed_queues)
+template<typename T, typename R>
+class Static_Scheduling_Queue:
+public IF<Traits<T>::indexed_queues, Bitmap_Scheduling_List<T, R>, Scheduling_List<T, R> >::Result {};
+
+template<typename T, typename R>
+class Dynamic_Scheduling_Queue:
+public IF<Traits<T>::indexed_queues, Heap_Scheduling_List<T, R>, Scheduling_List<T, R> >::Result {};
+
+template<typename T, typename R>
+class Multihead_Dynamic_Scheduling_Queue:
+public IF<Traits<T>::indexed_queues, Multihead_Heap_Scheduling_List<T, R>, Multihead_Scheduling_List<T, R> >::Result {};
+
+template<typename T>
+class Scheduling_Queue<T, Scheduling_Criteria::Priority>:
+public Static_Scheduling_Queue<T, Scheduling_Criteria::Priority> {};
+
+template<typename T>
+class Scheduling_Queue<T, Scheduling_Criteria::RR>:
+public Static_Scheduling_Queue<T, Scheduling_Criteria::RR> {};
+
+template<typename T>
+class Scheduling_Queue<T, Scheduling_Criteria::FCFS>:
+public Static_Scheduling_Queue<T, Scheduling_Criteria::FCFS> {};
+
+template<typename T>
+class Scheduling_Queue<T, Scheduling_Criteria::RM>:
+public Static_Scheduling_Queue<T, Scheduling_Criteria::RM> {};
+
+template<typename T>
+class Scheduling_Queue<T, Scheduling_Criteria::DM>:
+public Static_Scheduling_Queue<T, Scheduling_Criteria::DM> {};
+
 template<typename T>
 class Scheduling_Queue<T, Scheduling_Criteria::GRR>:
 public Multihead_Scheduling_List<T> {};
 
 template<typename T>
 class Scheduling_Queue<T, Scheduling_Criteria::CPU_Affinity>:
-public Scheduling_Multilist<T> {};
+public Scheduling_Multilist<T, Scheduling_Criteria::CPU_Affinity, List_Elements::Doubly_Linked_Scheduling<T, Scheduling_Criteria::CPU_Affinity>, Static_Scheduling_Queue<T, Scheduling_Criteria::CPU_Affinity> > {};
 
 template<typename T>
 class Scheduling_Queue<T, Scheduling_Criteria::PRM>:
-public Scheduling_Multilist<T> {};
+public Scheduling_Multilist<T, Scheduling_Criteria::PRM, List_Elements::Doubly_Linked_Scheduling<T, Scheduling_Criteria::PRM>, Static_Scheduling_Queue<T, Scheduling_Criteria::PRM> > {};
+
+template<typename T>
+class Scheduling_Queue<T, Scheduling_Criteria::EDF>:
+public Dynamic_Scheduling_Queue<T, Scheduling_Criteria::EDF> {};
 
 template<typename T>
 class Scheduling_Queue<T, Scheduling_Criteria::GEDF>:
-public Multihead_Scheduling_List<T> {};
+public Multihead_Dynamic_Scheduling_Queue<T, Scheduling_Criteria::GEDF> {};
 
 template<typename T>
 class Scheduling_Queue<T, Scheduling_Criteria::PEDF>:
-public Scheduling_Multilist<T> {};
+public Scheduling_Multilist<T, Scheduling_Criteria::PEDF, typename Dynamic_Scheduling_Queue<T, Scheduling_Criteria::PEDF>::Element, Dynamic_Scheduling_Queue<T, Scheduling_Criteria::PEDF> > {};
 
 template<typename T>
 class Scheduling_Queue<T, Scheduling_Criteria::CEDF>:
-public Multihead_Scheduling_Multilist<T> {};
+public Scheduling_Multilist<T, Scheduling_Criteria::CEDF, typename Multihead_Dynamic_Scheduling_Queue<T, Scheduling_Criteria::CEDF>::Element, Multihead_Dynamic_Scheduling_Queue<T, Scheduling_Criteria::CEDF> > {};
 
 
 // Scheduler
@@ -329,7 +372,7 @@ private:
 public:
     typedef typename T::Criterion Criterion;
     typedef Scheduling_List<T, Criterion> Queue;
-    typedef typename Queue::Element Element;
+    typedef typename Base::Element Element;
 
 public:
     Scheduler() {}
@@ -19,6 +19,7 @@ public:
 public:
     Segment(unsigned int bytes, const Color & color = Color::WHITE, const Flags & flags = Flags::APP);
     Segment(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & flags);
+    Segment(const Segment & seg);
     ~Segment();
 
     unsigned int size() const;
@@ -8,10 +8,19 @@
 
 __BEGIN_SYS
 
+// Each synchronizer guards its waiting queue with its own lock, so operations on
+// distinct synchronizers only contend for the scheduling queues they touch (see Thread::lock()).
+// Uncontended operations do not even take it: synchronizers first try to update their
+// state with an atomic instruction and only fall back to begin_atomic() (after spinning
+// for a while on SMP) when they might have to block or wake up a thread.
 class Synchronizer_Common
 {
 protected:
+    static const bool smp = Traits<Thread>::smp;
+    static const unsigned int SPINS = smp ? Traits<Synchronizer>::SPINS : 0;
+
     typedef Thread::Queue Queue;
+    typedef Thread::Spin Spin;
 
 protected:
     Synchronizer_Common() {}
@@ -21,17 +30,28 @@ protected:
     bool tsl(volatile bool & lock) { return CPU::tsl(lock); }
     int finc(volatile int & number) { return CPU::finc(number); }
     int fdec(volatile int & number) { return CPU::fdec(number); }
+    int cas(volatile int & value, int compare, int replacement) { return CPU::cas(value, compare, replacement); }
 
     // Thread operations
-    void begin_atomic() { Thread::lock(); }
-    void end_atomic() { Thread::unlock(); }
-
-    void sleep() { Thread::sleep(&_queue); }
-    void wakeup() { Thread::wakeup(&_queue); }
-    void wakeup_all() { Thread::wakeup_all(&_queue); }
+    void begin_atomic() {
+        CPU::int_disable();
+        if(smp)
+            _lock.acquire();
+    }
+
+    void end_atomic() {
+        if(smp)
+            _lock.release();
+        CPU::int_enable();
+    }
+
+    void sleep() { Thread::sleep(&_queue, &_lock); }
+    void wakeup() { Thread::wakeup(&_queue, &_lock); }
+    void wakeup_all() { Thread::wakeup_all(&_queue, &_lock); }
 
 protected:
     Queue _queue;
+    Spin _lock;
 };
 
 __END_SYS
@@ -25,6 +25,20 @@ struct IF_INT<false, Then, Else>
 { enum { Result = Else }; };
 
 
+// Integer Base-2 Logarithm (rounded down)
+template<unsigned int N>
+struct LOG2
+{ enum { Result = LOG2<N / 2>::Result + 1 }; };
+
+template<>
+struct LOG2<1>
+{ enum { Result = 0 }; };
+
+template<>
+struct LOG2<0>
+{ enum { Result = 0 }; };
+
+
 // SWITCH-CASE of Types
 const int DEFAULT = ~(~0u >> 1); // Initialize with the smallest int
 
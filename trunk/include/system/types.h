@@ -109,6 +109,7 @@ class IEEE802_15_4;
 class PCNet32;
 class C905;
 class E100;
+class Loopback;
 class CC2538;
 class AT86RF;
 class GEM;
@@ -19,11 +19,13 @@ class Task
 
 private:
     static const bool multitask = Traits<System>::multitask;
+    static const bool smp = Traits<System>::multicore;
 
     typedef CPU::Log_Addr Log_Addr;
     typedef CPU::Phy_Addr Phy_Addr;
     typedef CPU::Context Context;
     typedef Thread::Queue Queue;
+    typedef Spin_Lock<Traits<Thread>::SPIN> Spin;
 
 protected:
     // This constructor is only used by Init_First
@@ -52,6 +54,16 @@ public:
 
         _main = new (SYSTEM) Thread(Thread::Configuration(conf.state, conf.criterion, this, 0), entry, an ...);
     }
+    // Duplicates task: the new task gets copies of its code and data segments, attached at the same addresses
+    // (whose frames the MMU shares copy-on-write), and a main thread of its own. Like the segments given to the
+    // other constructors, these copies are not deleted along with the task.
+    template<typename ... Tn>
+    Task(const Task & task, int (* entry)(Tn ...), Tn ... an)
+    : _as (new (SYSTEM) Address_Space), _cs(new (SYSTEM) Segment(*task._cs)), _ds(new (SYSTEM) Segment(*task._ds)), _entry(entry), _code(_as->attach(_cs, task._code)), _data(_as->attach(_ds, task._data)) {
+        db<Task>(TRC) << "Task(task=" << &task << ",as=" << _as << ",cs=" << _cs << ",ds=" << _ds << ",entry=" << _entry << ",code=" << _code << ",data=" << _data << ") => " << this << endl;
+
+        _main = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::MAIN, WHITE, this, 0), entry, an ...);
+    }
     ~Task();
 
     Address_Space * address_space() const { return _as; }
@@ -69,8 +81,12 @@ public:
 private:
     void activate() const { _as->activate(); }
 
-    void insert(Thread * t) { _threads.insert(new (SYSTEM) Queue::Element(t)); }
-    void remove(Thread * t) { Queue::Element * el = _threads.remove(t); if(el) delete el; }
+    // Threads are created and deleted under the locks of their own scheduling queues, so _threads needs a lock of its own
+    void insert(Thread * t) { Queue::Element * el = new (SYSTEM) Queue::Element(t); lock(); _threads.insert(el); unlock(); }
+    void remove(Thread * t) { lock(); Queue::Element * el = _threads.remove(t); unlock(); if(el) delete el; }
+
+    void lock() { if(smp) _lock.acquire(); }
+    void unlock() { if(smp) _lock.release(); }
 
     static Task * volatile current() { return _current; }
     static void current(Task * t) { _current = t; }
@@ -86,6 +102,7 @@ private:
     Log_Addr _data;
     Thread * _main;
     Queue _threads;
+    Spin _lock;
 
     static Task * volatile _current;
 };
@@ -6,6 +6,7 @@
 #include <utility/handler.h>
 #include <utility/random.h>
 #include <alarm.h>
+#include <chronometer.h>
 #include <condition.h>
 #include <ip.h>
 #include <icmp.h>
@@ -25,6 +26,13 @@ public:
     static const unsigned int TIMEOUT = Traits<TCP>::TIMEOUT * 1000000;
     static const unsigned int WINDOW = Traits<TCP>::WINDOW;
 
+    // Retransmission timeout bounds (RFC 6298 recommends a 1 s minimum, we follow common practice)
+    static const unsigned int RTO_MIN = 200000;   // us
+    static const unsigned int RTO_MAX = 60000000; // us
+
+    // Segments kept aside per connection while waiting for missing data (each holds NIC receive buffers)
+    static const unsigned int REORDERING = 16;
+
     typedef IP::Buffer Buffer;
 
     typedef UDP::Port Port;
@@ -33,12 +41,14 @@ public:
 
     typedef Data_Observer<Buffer, unsigned long long> Observer; // Condition = Connection::id()
     typedef Data_Observed<Buffer, unsigned long long> Observed;
+    typedef Hashed_Data_Observed<Buffer, unsigned long long, 256> Demultiplexer; // hashed by Connection::id()
 
 
     class Header
     {
     public:
         static const unsigned int DO = 5; // size of TCP header in 32-bit words
+        static const unsigned int OPTIONS = 40; // maximum size of the options (bytes)
 
         typedef unsigned char Flags;
         enum {
@@ -52,6 +62,16 @@ public:
             CWR = 0x80
         };
 
+        // Options (RFC 793, RFC 7323 and RFC 2018)
+        enum {
+            END = 0,
+            NOP = 1,
+            MAXIMUM_SEGMENT_SIZE = 2,
+            WINDOW_SCALE = 3,
+            SACK_PERMITTED = 4,
+            SACK = 5
+        };
+
     public:
         Header() {}
         Header(const Port & from, const Port & to, unsigned int sequence, unsigned short window)
@@ -65,6 +85,10 @@ public:
         unsigned int flags() const { return _flags; }
         unsigned int window() const { return ntohs(_window); }
 
+        // Header length, options included (bytes)
+        unsigned int offset() const { return _data_offset * 4; }
+        void offset(unsigned int bytes) { _data_offset = bytes / 4; }
+
         unsigned short checksum() const { return ntohs(_checksum); }
 
         friend OStream & operator<<(OStream & db, const Header & h) {
@@ -102,9 +126,12 @@ public:
         Header * header() { return this; }
 
         template<typename T>
-        T * data() { return reinterpret_cast<T *>(&_data); }
+        T * data() { return reinterpret_cast<T *>(reinterpret_cast<unsigned char *>(this) + offset()); }
+
+        unsigned char * options() { return reinterpret_cast<unsigned char *>(&_data); }
 
         void sum(const IP::Address & from, const IP::Address & to, const void * data, unsigned int length);
+        void sum_copy(const IP::Address & from, const IP::Address & to, const void * data, unsigned int length); // copies data in while summing it
         bool check(unsigned int length) { return IP::checksum(this, length) != 0xffff; } // FIXME
 
         friend Debug & operator<<(Debug & db, const Segment & m) {
@@ -112,6 +139,9 @@ public:
             return db;
         }
 
+    private:
+        void sum_headers(const IP::Address & from, const IP::Address & to, unsigned long data, unsigned int length);
+
     private:
         Data _data;
     } __attribute__((packed));
@@ -138,12 +168,58 @@ public:
 
         typedef void (Connection:: * State_Handler)();
 
+        typedef RTC::Microsecond Microsecond;
+
+        // Throughput and latency counters
+        struct Statistics
+        {
+            Statistics(): tx_segments(0), tx_bytes(0), rx_segments(0), rx_bytes(0), acked_bytes(0), retransmissions(0),
+                          fast_retransmissions(0), timeouts(0), rtt_samples(0), rtt_min(0), rtt_max(0) {}
+
+            friend Debug & operator<<(Debug & db, const Statistics & s) {
+                db << "{txs=" << s.tx_segments
+                   << ",txb=" << s.tx_bytes
+                   << ",rxs=" << s.rx_segments
+                   << ",rxb=" << s.rx_bytes
+                   << ",ackb=" << s.acked_bytes
+                   << ",rtx=" << s.retransmissions
+                   << ",frtx=" << s.fast_retransmissions
+                   << ",rto=" << s.timeouts
+                   << ",rtts=" << s.rtt_samples
+                   << ",rttmin=" << s.rtt_min
+                   << ",rttmax=" << s.rtt_max
+                   << "}";
+                return db;
+            }
+
+            unsigned int tx_segments;           // data segments sent (including retransmissions)
+            unsigned int tx_bytes;              // payload bytes sent (including retransmissions)
+            unsigned int rx_segments;
+            unsigned int rx_bytes;
+            unsigned int acked_bytes;           // payload bytes acknowledged by the peer
+            unsigned int retransmissions;       // data segments retransmitted
+            unsigned int fast_retransmissions;  // losses detected by duplicate acknowledgments
+            unsigned int timeouts;              // retransmission timeouts
+            unsigned int rtt_samples;
+            Microsecond rtt_min;
+            Microsecond rtt_max;
+        };
+
     public:
         Connection(const Port & from, const Address & to)
-        : Header(from, to.port(), Random::random() & 0x00ffffff, WINDOW), _peer(to.ip()), _peer_window(0), _next(ntohl(_sequence)),
+        : Header(from, to.port(), Random::random() & 0x00ffffff, (WINDOW > 0xffff) ? 0xffff : WINDOW), _peer(to.ip()), _peer_window(0), _next(ntohl(_sequence)),
           _unacknowledged(_next), _initial(_next), _state(CLOSED), _handler(&Connection::closed), _current(0), _length(0), _valid(false),
-          _streaming(false), _retransmiting(false), _timeout_handler(&timeout,this), _alarm(0), _tries(0), _observer(0) {}
-        ~Connection() { if(_alarm) delete _alarm; close(); }
+          _streaming(false), _retransmiting(false), _timeout_handler(&timeout,this), _alarm(0), _tries(0), _srtt(0), _rttvar(0), _rto(TIMEOUT),
+          _timing(false), _timed(0), _timed_at(0), _cwnd(initial_window()), _ssthresh(~0U), _recover(_initial), _duplicates(0),
+          _recovering(false), _resend(false), _scale(scale()), _peer_scale(0), _scaling(true), _sack(true), _latest(0), _observer(0) { _clock.start(); }
+        ~Connection() {
+            if(_alarm) delete _alarm;
+            close();
+            while(!_out_of_order.empty()) {
+                Buffer * pool = _out_of_order.remove()->object();
+                pool->nic()->free(pool);
+            }
+        }
 
         const volatile State & state() const { return _state; }
         const Header * header() const { return this; }
@@ -153,6 +229,17 @@ public:
 
         const IP::Address & peer() const { return _peer; }
 
+        const Statistics & statistics() const { return _statistics; }
+        Microsecond rtt() const { return _srtt >> 3; }
+        Microsecond rto() const { return _rto; }
+        unsigned int window() const { return _cwnd; }
+
+        // Average throughput (acknowledged payload bytes per second) since the connection was created
+        unsigned long throughput() {
+            Microsecond elapsed = _clock.read();
+            return elapsed ? static_cast<unsigned long long>(_statistics.acked_bytes) * 1000000 / elapsed : 0;
+        }
+
         unsigned long long id() const {
             unsigned long long tmp = _peer[0] << 24 | _peer[1] << 16 | _peer[2] << 8 | _peer[3];
             tmp = (tmp << 32) | ((to() << 16) | from());
@@ -177,7 +264,8 @@ public:
 
         friend Debug & operator<<(Debug & db, const Connection & c) {
             db << *c.header()
-               << ",peer=" << c._peer << ",pwin=" << c._peer_window << ",uack=" << ntohl(c._unacknowledged) << ",stat=" << c._state;
+               << ",peer=" << c._peer << ",pwin=" << c._peer_window << ",uack=" << c._unacknowledged << ",stat=" << c._state
+               << ",cwnd=" << c._cwnd << ",ssth=" << c._ssthresh << ",srtt=" << (c._srtt >> 3) << ",rto=" << c._rto;
             if(c._current)
                 db << ",curr=" << c._current << " => " << *c._current << ",len=" << c._length;
             return db;
@@ -215,12 +303,41 @@ public:
         bool check_sequence();
         void process_fin();
 
+        // Out-of-order reception (RFC 5681 and RFC 2018)
+        static Segment * segment(Buffer * pool) { return pool->frame()->data<Packet>()->data<Segment>(); }
+        static unsigned int length(Buffer * pool) { return pool->size() - sizeof(IP::Header) - segment(pool)->offset(); }
+        bool reorder(Buffer * pool);
+        void acknowledge();
+        void reassemble(unsigned long long socket, unsigned int next);
+
+        // Options and window scaling (RFC 7323)
+        static unsigned char scale() {
+            unsigned char s = 0;
+            while((s < 14) && ((WINDOW >> s) > 0xffff))
+                s++;
+            return s;
+        }
+        void advertise(const Flags & flags) { // SYN segments carry the window unscaled
+            unsigned int window = (flags & SYN) ? WINDOW : WINDOW >> _scale;
+            _window = htons((window > 0xffff) ? 0xffff : window);
+        }
+        void negotiate();
+        unsigned int options(unsigned int * words, const Flags & flags);
+
         static void timeout(Connection * c);
         void set_timeout(const Alarm::Microsecond & time = TIMEOUT);
 
+        // RTT estimation (RFC 6298) and NewReno congestion control (RFC 5681 and RFC 6582)
+        static unsigned int initial_window() { return (4 * MSS < 4380) ? 4 * MSS : (2 * MSS > 4380) ? 2 * MSS : 4380; }
+        unsigned int flight() const { return _next - _unacknowledged; }
+        void sample(const Microsecond & rtt);
+        void acknowledged(unsigned int ack);
+        bool duplicated();
+        void timed_out();
+
     private:
         IP::Address _peer;
-        unsigned short  _peer_window;   // (host endianness)
+        unsigned int _peer_window;      // already scaled (host endianness)
         unsigned int _next;             // next regular sequence number to be sent, it tells how far the conversation has gone (host endianness)
         unsigned int _unacknowledged;   // earliest unacknowledged sequence number sent (host endianness)
         const unsigned int _initial;    // initial sequence number (host endianness)
@@ -245,6 +362,33 @@ public:
         Alarm * _alarm;
         volatile int _tries; // either for close() or open() calls
 
+        // Round-trip time estimation (one segment is timed at a time and never a retransmitted one, as per Karn)
+        Chronometer _clock;
+        Microsecond _srtt;              // smoothed RTT (x 8)
+        Microsecond _rttvar;            // RTT variation (x 4)
+        Microsecond _rto;               // retransmission timeout
+        volatile bool _timing;
+        unsigned int _timed;            // sequence number whose acknowledgment ends the measurement (host endianness)
+        Microsecond _timed_at;
+
+        // Congestion control
+        unsigned int _cwnd;             // congestion window (bytes)
+        unsigned int _ssthresh;         // slow start threshold (bytes)
+        unsigned int _recover;          // SND.NXT when fast recovery started (host endianness)
+        unsigned int _duplicates;       // consecutive duplicate acknowledgments
+        volatile bool _recovering;      // in fast recovery
+        volatile bool _resend;          // the first unacknowledged segment must be retransmitted by the sender
+
+        // Out-of-order queue (ordered by sequence number) and options
+        unsigned char _scale;           // RCV.WND.SHIFT
+        unsigned char _peer_scale;      // SND.WND.SHIFT
+        bool _scaling;                  // window scaling offered (and, after the SYNs, agreed upon)
+        bool _sack;                     // SACK permitted offered (and, after the SYNs, agreed upon)
+        Buffer::List _out_of_order;
+        unsigned int _latest;           // sequence number of the last segment queued out of order (host endianness)
+
+        Statistics _statistics;
+
         TCP::Observer * _observer;
     };
 
@@ -295,7 +439,7 @@ private:
     }
 
 private:
-    static Observed _observed; // Channel protocols are singletons
+    static Demultiplexer _observed; // Channel protocols are singletons
 };
 
 __END_SYS
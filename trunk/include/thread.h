@@ -6,6 +6,7 @@
 #include <utility/queue.h>
 #include <utility/handler.h>
 #include <cpu.h>
+#include <fpu.h>
 #include <machine.h>
 #include <system.h>
 #include <scheduler.h>
@@ -21,6 +22,7 @@ class Thread
     friend class System;
     friend class Scheduler<Thread>;
     friend class Synchronizer_Common;
+    friend class Mutex;
     friend class Alarm;
     friend class Task;
     friend class Agent;
@@ -31,12 +33,14 @@ protected:
     static const bool multitask = Traits<System>::multitask;
     static const bool reboot = Traits<System>::reboot;
 
+    static const unsigned int QUEUES = Traits<Thread>::Criterion::QUEUES;
     static const unsigned int QUANTUM = Traits<Thread>::QUANTUM;
     static const unsigned int STACK_SIZE = multitask ? Traits<System>::STACK_SIZE : Traits<Application>::STACK_SIZE;
     static const unsigned int USER_STACK_SIZE = Traits<Application>::STACK_SIZE;
 
     typedef CPU::Log_Addr Log_Addr;
     typedef CPU::Context Context;
+    typedef Spin_Lock<Traits<Thread>::SPIN> Spin;
 
 public:
     // Thread State
@@ -111,15 +115,20 @@ protected:
 
     Criterion & criterion() { return const_cast<Criterion &>(_link.rank()); }
 
-    static void lock() {
+    unsigned int queue() const { return _link.rank().queue(); }
+    static unsigned int current_queue() { return Criterion::current_queue(); }
+
+    // Scheduler locking
+    // Each scheduling queue is guarded by its own lock (global criteria have a single queue and thus a single lock).
+    // Lock order: Alarm::_lock and Synchronizer_Common::_lock (never nested) come first, then scheduling queue
+    // locks in ascending queue order. The lock of the running CPU's queue is implicitly released by dispatch().
+    static void lock(unsigned int queue = current_queue()) {
         CPU::int_disable();
-        if(smp)
-            _lock.acquire();
+        acquire(queue);
     }
 
-    static void unlock() {
-        if(smp)
-            _lock.release();
+    static void unlock(unsigned int queue = current_queue()) {
+        release(queue);
         CPU::int_enable();
     }
 
@@ -127,12 +136,18 @@ protected:
 
     void suspend(bool locked);
 
-    static void sleep(Queue * q);
-    static void wakeup(Queue * q);
-    static void wakeup_all(Queue * q);
+    // Real-time locking protocols (see Mutex)
+    void inherit(int priority);
+
+    // Dynamic criteria (see Periodic_Thread)
+    void update();
+
+    static void sleep(Queue * q, Spin * guard);
+    static void wakeup(Queue * q, Spin * guard);
+    static void wakeup_all(Queue * q, Spin * guard);
 
     static void reschedule();
-    static void reschedule(unsigned int cpu);
+    static void reschedule(unsigned int queue);
     static void rescheduler(const IC::Interrupt_Id & interrupt);
     static void time_slicer(const IC::Interrupt_Id & interrupt);
 
@@ -143,21 +158,63 @@ protected:
 private:
     static void init();
 
+    static Spin & queue_lock(unsigned int queue) { return _lock[(QUEUES > 1) ? queue : 0]; }
+
+    // CPU that must reschedule after a change in a queue: the running one if it serves the queue (as all do under global
+    // criteria), otherwise the first CPU of the queue's partition or cluster (QUEUES x HEADS = CPUS)
+    static unsigned int cpu(unsigned int queue) {
+        return ((QUEUES == 1) || (queue == current_queue())) ? Machine::cpu_id() : queue * (Traits<Machine>::CPUS / QUEUES);
+    }
+
+    static void acquire(unsigned int queue) {
+        if(smp)
+            queue_lock(queue).acquire();
+    }
+
+    static void release(unsigned int queue) {
+        if(smp)
+            queue_lock(queue).release();
+    }
+
+    // Acquire the lock of a second queue while holding that of "held", preserving the ascending order
+    static void acquire(unsigned int held, unsigned int queue) {
+        if(smp && (&queue_lock(queue) != &queue_lock(held))) {
+            if(queue < held) {
+                release(held);
+                acquire(queue);
+                acquire(held);
+            } else
+                acquire(queue);
+        }
+    }
+
+    static void release(unsigned int held, unsigned int queue) {
+        if(smp && (&queue_lock(queue) != &queue_lock(held)))
+            release(queue);
+    }
+
 protected:
     Task * _task;
     Segment * _user_stack;
 
     char * _stack;
     Context * volatile _context;
+    FPU::Context * _fpu; // only with Traits<FPU>::enabled
     volatile State _state;
     Queue * _waiting;
+    Spin * _waiting_lock;
     Thread * volatile _joining;
     Queue::Element _link;
 
+    // Real-time locking protocols (see Mutex)
+    List<Mutex> _mutexes;               // mutexes held
+    volatile int _natural_priority;     // priority before any inheritance (valid only while holding mutexes)
+    Mutex * volatile _blocker;          // mutex being waited for
+
     static volatile unsigned int _thread_count;
     static Scheduler_Timer * _timer;
     static Scheduler<Thread> _scheduler;
-    static Spin _lock;
+    static Spin _lock[QUEUES];
 };
 
 __END_SYS
@@ -168,7 +225,7 @@ __BEGIN_SYS
 
 template<typename ... Tn>
 inline Thread::Thread(int (* entry)(Tn ...), Tn ... an)
-: _task(Task::self()), _user_stack(0), _state(READY), _waiting(0), _joining(0), _link(this, NORMAL)
+: _task(Task::self()), _user_stack(0), _state(READY), _waiting(0), _waiting_lock(0), _joining(0), _link(this, NORMAL), _blocker(0)
 {
     constructor_prologue(WHITE, STACK_SIZE);
     _context = CPU::init_stack(0, _stack + STACK_SIZE, &__exit, entry, an ...);
@@ -177,11 +234,11 @@ inline Thread::Thread(int (* entry)(Tn ...), Tn ... an)
 
 template<typename ... Tn>
 inline Thread::Thread(const Configuration & conf, int (* entry)(Tn ...), Tn ... an)
-: _task(conf.task ? conf.task : Task::self()), _state(conf.state), _waiting(0), _joining(0), _link(this, conf.criterion)
+: _task(conf.task ? conf.task : Task::self()), _state(conf.state), _waiting(0), _waiting_lock(0), _joining(0), _link(this, conf.criterion), _blocker(0)
 {
     if(multitask && !conf.stack_size) { // Auto-expand, user-level stack
         constructor_prologue(conf.color, STACK_SIZE);
-        _user_stack = new (SYSTEM) Segment(USER_STACK_SIZE);
+        _user_stack = new (SYSTEM) Segment(USER_STACK_SIZE, WHITE, Segment::Flags::APP | Segment::Flags::DZ); // only touched pages get frames
 
         // Attach the thread's user-level stack to the current address space so we can initialize it
         Log_Addr ustack = Task::self()->address_space()->attach(_user_stack);
@@ -62,6 +62,7 @@ public:
 
     typedef Data_Observer<Buffer, Port> Observer;
     typedef Data_Observed<Buffer, Port> Observed;
+    typedef Hashed_Data_Observed<Buffer, Port, 64> Demultiplexer; // hashed by port
 
 
     class Header
@@ -108,6 +109,7 @@ public:
 
         void sum_header(const IP::Address & from, const IP::Address & to);
         void sum_data(const void * data, unsigned int size);
+        void sum_copy(void * to, const void * data, unsigned int size); // copies data to "to" (within the datagram) while summing it
         void sum_trailer();
         bool check() { return Traits<UDP>::checksum ? (IP::checksum(this, length()) != 0xffff) : true; }
 
@@ -135,6 +137,15 @@ public:
     static int send(const Port & from, const Address & to, const void * data, unsigned int size);
     static int receive(Buffer * buf, void * data, unsigned int size);
 
+    // Zero-copy sending: alloc() lends the caller a datagram of "size" bytes within the NIC's transmit buffers,
+    // whose payload is written in place through payload() and then summed (in a single pass) and sent by send(pool).
+    // A datagram larger than a frame is fragmented, so payload() returns the address of the byte at "offset" and
+    // the number of bytes that can be contiguously written from there. A lent pool must always be sent. Sizes larger
+    // than a datagram's payload are rejected (alloc() returns 0).
+    static Buffer * alloc(const Port & from, const Address & to, unsigned int size);
+    static void * payload(Buffer * pool, unsigned int offset = 0, unsigned int * contiguous = 0);
+    static int send(Buffer * pool);
+
     static void attach(Observer * obs, const Port & port) { _observed.attach(obs, port); }
     static void detach(Observer * obs, const Port & port) { _observed.detach(obs, port); }
     static bool notify(const Port & port, Buffer * buf) { return _observed.notify(port, buf); }
@@ -142,7 +153,7 @@ public:
 private:
     void update(IP::Observed * obs, IP::Protocol prot, Buffer * buf);
 
-    static Observed _observed; // Channel protocols are singletons
+    static Demultiplexer _observed; // Channel protocols are singletons
 };
 
 __END_SYS
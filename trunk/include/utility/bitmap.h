@@ -54,6 +54,20 @@ public:
         return true;
     }
 
+    // Find first set: index of the lowest set bit at or above "from", or -1 if there is none
+    int first(unsigned int from = 0) const {
+        if(from >= BITS)
+            return -1;
+        unsigned int i = from / BPI;
+        unsigned int word = _map[i] & (~0U << (from & mask));
+        while(!word) {
+            if(++i >= SIZE)
+                return -1;
+            word = _map[i];
+        }
+        return i * BPI + __builtin_ctz(word);
+    }
+
 private:
      unsigned int _map[SIZE];
 };
@@ -0,0 +1,164 @@
+// EPOS Buddy System Utility Declarations
+
+#ifndef __buddy_h
+#define __buddy_h
+
+#include "string.h"
+
+__BEGIN_UTIL
+
+// Binary buddy system over UNITS allocation units (e.g. memory frames), identified by their indexes. Only bitmaps
+// are kept: bit i of order k is set when the block of 2^k units starting at unit i * 2^k is free and is not part of
+// a larger free block. The free units themselves are never written to, so they can be released while still in use
+// by the releaser (e.g. INIT, which runs from memory it hands over to the MMU). A summary bitmap per order (one bit
+// per non-empty word) and a hint at its first non-empty word bound searches, so both alloc() and free() run in
+// O(log UNITS).
+template<unsigned int UNITS>
+class Buddy
+{
+private:
+    static const unsigned int BPW = sizeof(unsigned int) * 8;
+    static const unsigned int ORDERS = LOG2<UNITS>::Result + 1;
+
+    // Upper bounds for the words all orders need together (each one rounds up by at most a word)
+    static const unsigned int WORDS = 2 * (UNITS / BPW) + ORDERS;
+    static const unsigned int SUMMARY = WORDS / BPW + ORDERS;
+
+public:
+    Buddy(): _available(0) {
+        memset(_map, 0, sizeof(_map));
+        memset(_summary, 0, sizeof(_summary));
+        for(unsigned int k = 0, map = 0, summary = 0; k < ORDERS; k++) {
+            _map_base[k] = map;
+            _summary_base[k] = summary;
+            _hint[k] = summary;
+            _count[k] = 0;
+            map += (blocks(k) + BPW - 1) / BPW;
+            summary += ((blocks(k) + BPW - 1) / BPW + BPW - 1) / BPW;
+        }
+    }
+
+    // Allocates n contiguous units, returning the index of the first one or -1 if there is no such block
+    int alloc(unsigned int n) {
+        if(!n || (n > UNITS))
+            return -1;
+
+        // Fast path for single units, which are found or split without rounding and trimming
+        if(n == 1)
+            return take(0);
+
+        unsigned int order = 0;
+        while((1U << order) < n)
+            order++;
+
+        int unit = take(order);
+        if(unit >= 0) // give back the tail of the block beyond n
+            free(unit + n, (1U << order) - n);
+
+        return unit;
+    }
+
+    // Releases n contiguous units starting at unit, merging them with their free buddies
+    void free(unsigned int unit, unsigned int n) {
+        if(unit + n > UNITS)
+            n = (unit < UNITS) ? UNITS - unit : 0;
+
+        // Split the range into the largest aligned blocks that fit in it
+        while(n) {
+            unsigned int order = unit ? __builtin_ctz(unit) : ORDERS - 1;
+            while((order >= ORDERS) || ((1U << order) > n))
+                order--;
+            insert(order, unit >> order);
+            unit += 1U << order;
+            n -= 1U << order;
+        }
+    }
+
+    // Size of the largest block that can be allocated
+    unsigned int allocable() const {
+        for(int k = ORDERS - 1; k >= 0; k--)
+            if(_count[k])
+                return 1U << k;
+        return 0;
+    }
+
+    // Number of free units
+    unsigned int available() const { return _available; }
+
+private:
+    static unsigned int blocks(unsigned int order) { return UNITS >> order; }
+
+    bool test(unsigned int order, unsigned int block) const {
+        return _map[_map_base[order] + block / BPW] & (1U << (block % BPW));
+    }
+
+    void set(unsigned int order, unsigned int block) {
+        unsigned int word = block / BPW;
+        _map[_map_base[order] + word] |= 1U << (block % BPW);
+        _summary[_summary_base[order] + word / BPW] |= 1U << (word % BPW);
+        if(_summary_base[order] + word / BPW < _hint[order])
+            _hint[order] = _summary_base[order] + word / BPW;
+        _count[order]++;
+        _available += 1U << order;
+    }
+
+    void reset(unsigned int order, unsigned int block) {
+        unsigned int word = block / BPW;
+        _map[_map_base[order] + word] &= ~(1U << (block % BPW));
+        if(!_map[_map_base[order] + word])
+            _summary[_summary_base[order] + word / BPW] &= ~(1U << (word % BPW));
+        _count[order]--;
+        _available -= 1U << order;
+    }
+
+    // Index of the first free block of the given order (which must have at least one)
+    unsigned int first(unsigned int order) {
+        unsigned int s = _hint[order];
+        while(!_summary[s])
+            s++;
+        _hint[order] = s;
+        unsigned int word = (s - _summary_base[order]) * BPW + __builtin_ctz(_summary[s]);
+        return word * BPW + __builtin_ctz(_map[_map_base[order] + word]);
+    }
+
+    // Takes a free block of the given order, splitting the smallest larger one if needed
+    int take(unsigned int order) {
+        unsigned int k = order;
+        while((k < ORDERS) && !_count[k])
+            k++;
+        if(k >= ORDERS)
+            return -1;
+
+        unsigned int block = first(k);
+        reset(k, block);
+        for(; k > order; k--) { // keep the lower half, free the upper one
+            block <<= 1;
+            set(k - 1, block + 1);
+        }
+
+        return block << order;
+    }
+
+    void insert(unsigned int order, unsigned int block) {
+        for(; order < ORDERS - 1; order++, block >>= 1) {
+            unsigned int buddy = block ^ 1;
+            if((buddy >= blocks(order)) || !test(order, buddy))
+                break;
+            reset(order, buddy);
+        }
+        set(order, block);
+    }
+
+private:
+    unsigned int _map[WORDS];
+    unsigned int _summary[SUMMARY];
+    unsigned int _map_base[ORDERS];
+    unsigned int _summary_base[ORDERS];
+    unsigned int _hint[ORDERS];
+    unsigned int _count[ORDERS];
+    unsigned int _available;
+};
+
+__END_UTIL
+
+#endif
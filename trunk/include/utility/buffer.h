@@ -19,10 +19,10 @@ public:
     // This constructor is meant to be used at initialization time to correlate shadow data structures (e.g. NIC ring buffers)
     Buffer(Shadow * s): _lock(false), _owner(0), _shadow(s), _size(sizeof(Data)), _link1(this), _link2(this) {}
 
-    // These constructors are used whenever a Buffer receives new data
-    Buffer(Owner * o, unsigned int s): _lock(false), _owner(o), _size(s), _link1(this), _link2(this) {}
+    // These constructors are used whenever a Buffer receives new data, by whoever holds it, so the new Buffer is locked
+    Buffer(Owner * o, unsigned int s): _lock(true), _owner(o), _size(s), _link1(this), _link2(this) {}
     template<typename ... Tn>
-    Buffer(Owner * o, unsigned int s, Tn ... an): Data(an ...), _lock(false), _owner(o), _size(s), _link1(this), _link2(this) {}
+    Buffer(Owner * o, unsigned int s, Tn ... an): Data(an ...), _lock(true), _owner(o), _size(s), _link1(this), _link2(this) {}
 
     Data * data() { return this; }
     Data * frame() { return data(); }
@@ -10,54 +10,83 @@
 __BEGIN_UTIL
 
 // Heap
+// Segregated-fit allocator: requests that fit in a small block (up to 2^MAX_ORDER bytes, header included) are
+// rounded up to a power of two and served in constant time from per-size-class free lists, which are refilled
+// in batches from the large-object pool. Larger requests are served first-fit from the pool, a Grouping_List
+// that coalesces neighboring free blocks. Free small blocks only return to the pool (and get coalesced) when
+// the pool alone cannot satisfy a request. Each block keeps its size in a header (preceded by a pointer to the
+// heap in typed heaps), so free(addr, bytes) puts blocks of exactly a size class back into their free lists and
+// anything else (including memory given to the heap) into the pool.
 class Simple_Heap: private Grouping_List<char>
 {
 protected:
     static const bool typed = Traits<System>::multiheap;
 
-public:
-    using Grouping_List<char>::empty;
-    using Grouping_List<char>::size;
+private:
+    typedef Grouping_List<char> Base;
+
+protected:
+    // Small blocks must be able to hold a pool element, since they can be given back to the pool
+    static const unsigned int MIN_ORDER = (sizeof(Element) <= 16) ? 4 : (sizeof(Element) <= 32) ? 5 : 6;
+    static const unsigned int MAX_ORDER = 11;
+    static const unsigned int CLASSES = MAX_ORDER - MIN_ORDER + 1;
+    static const unsigned int HEADER = (typed ? sizeof(void *) : 0) + sizeof(int); // heap pointer and size
+
+private:
+    static const unsigned int BATCH = 1024; // bytes taken from the pool at once to refill a size class
+
+    struct Block {
+        Block * next;
+    };
 
-    Simple_Heap() {
+public:
+    Simple_Heap(): _small(0) {
         db<Init, Heaps>(TRC) << "Heap() => " << this << endl;
+
+        for(unsigned int i = 0; i < CLASSES; i++)
+            _free[i] = 0;
     }
 
-    Simple_Heap(void * addr, unsigned int bytes) {
+    Simple_Heap(void * addr, unsigned int bytes): _small(0) {
         db<Init, Heaps>(TRC) << "Heap(addr=" << addr << ",bytes=" << bytes << ") => " << this << endl;
 
+        for(unsigned int i = 0; i < CLASSES; i++)
+            _free[i] = 0;
+
         free(addr, bytes);
     }
 
+    bool empty() const { return !size(); }
+
+    // Free memory, in bytes
+    unsigned int size() const { return grouped_size() + _small; }
+
     void * alloc(unsigned int bytes) {
         db<Heaps>(TRC) << "Heap::alloc(this=" << this << ",bytes=" << bytes;
 
         if(!bytes)
             return 0;
 
-        if(!Traits<CPU>::unaligned_memory_access)
-            while((bytes % sizeof(void *)))
-                ++bytes;
+        bytes = gross(bytes);
 
-        if(typed)
-            bytes += sizeof(void *);  // add room for heap pointer
-        bytes += sizeof(int);         // add room for size
-        if(bytes < sizeof(Element))
-            bytes = sizeof(Element);
+        char * block;
+        unsigned int c = size_class(bytes);
+        if(c < CLASSES) {
+            bytes = block_size(c);
+            if(!_free[c])
+                refill(c);
+            block = pop(c);
+        } else
+            block = take(bytes, true);
 
-        Element * e = search_decrementing(bytes);
-        if(!e) {
+        if(!block) {
             out_of_memory();
             return 0;
         }
 
-        int * addr = reinterpret_cast<int *>(e->object() + e->size());
+        void * addr = mark(block, bytes);
 
-        if(typed)
-            *addr++ = reinterpret_cast<int>(this);
-        *addr++ = bytes;
-
-        db<Heaps>(TRC) << ") => " << reinterpret_cast<void *>(addr) << endl;
+        db<Heaps>(TRC) << ") => " << addr << endl;
 
         return addr;
     }
@@ -66,9 +95,11 @@ public:
         db<Heaps>(TRC) << "Heap::free(this=" << this << ",ptr=" << ptr << ",bytes=" << bytes << ")" << endl;
 
         if(ptr && (bytes >= sizeof(Element))) {
-            Element * e = new (ptr) Element(reinterpret_cast<char *>(ptr), bytes);
-            Element * m1, * m2;
-            insert_merging(e, &m1, &m2);
+            unsigned int c = size_class(bytes);
+            if((c < CLASSES) && (bytes == block_size(c)))
+                push(c, reinterpret_cast<char *>(ptr));
+            else
+                give(reinterpret_cast<char *>(ptr), bytes);
         }
     }
 
@@ -85,8 +116,104 @@ public:
         heap->free(addr, bytes);
     }
 
+protected:
+    static unsigned int block_size(unsigned int c) { return 1U << (c + MIN_ORDER); }
+
+    // Size class of a block (CLASSES if it is a large one)
+    static unsigned int size_class(unsigned int bytes) {
+        unsigned int c = 0;
+        while((c < CLASSES) && (block_size(c) < bytes))
+            c++;
+        return c;
+    }
+
+    // Block size needed to satisfy a request
+    static unsigned int gross(unsigned int bytes) {
+        if(!Traits<CPU>::unaligned_memory_access)
+            while((bytes % sizeof(void *)))
+                ++bytes;
+
+        bytes += HEADER;
+        if(bytes < sizeof(Element))
+            bytes = sizeof(Element);
+
+        return bytes;
+    }
+
+    // Writes the header of a block, returning the address handed out to its user
+    void * mark(char * block, unsigned int bytes) {
+        int * addr = reinterpret_cast<int *>(block);
+
+        if(typed)
+            *addr++ = reinterpret_cast<int>(this);
+        *addr++ = bytes;
+
+        return addr;
+    }
+
 private:
+    void push(unsigned int c, char * ptr) {
+        Block * b = reinterpret_cast<Block *>(ptr);
+        b->next = _free[c];
+        _free[c] = b;
+        _small += block_size(c);
+    }
+
+    char * pop(unsigned int c) {
+        Block * b = _free[c];
+        if(b) {
+            _free[c] = b->next;
+            _small -= block_size(c);
+        }
+        return reinterpret_cast<char *>(b);
+    }
+
+    void give(char * ptr, unsigned int bytes) {
+        Element * e = new (ptr) Element(ptr, bytes);
+        Element * m1, * m2;
+        insert_merging(e, &m1, &m2);
+    }
+
+    // Takes a block from the pool, giving the free small blocks back to it first if needed (and allowed)
+    char * take(unsigned int bytes, bool reclaiming) {
+        Element * e = search_decrementing(bytes);
+        if(!e && reclaiming && reclaim())
+            e = search_decrementing(bytes);
+        return e ? e->object() + e->size() : 0;
+    }
+
+    // Refills a size class with as many blocks as fit in BATCH bytes, or as many as the pool can provide
+    void refill(unsigned int c) {
+        unsigned int size = block_size(c);
+        unsigned int n = (size < BATCH) ? BATCH / size : 1;
+
+        char * chunk = 0;
+        for(; (n > 1) && !(chunk = take(n * size, false)); n >>= 1);
+        if(!chunk)
+            chunk = take(size, true);
+        if(!chunk)
+            return;
+
+        for(unsigned int i = 0; i < n; i++)
+            push(c, chunk + i * size);
+    }
+
+    // Gives all free small blocks back to the pool, so they can be coalesced
+    bool reclaim() {
+        bool reclaimed = false;
+        for(unsigned int c = 0; c < CLASSES; c++)
+            for(char * b = pop(c); b; b = pop(c)) {
+                give(b, block_size(c));
+                reclaimed = true;
+            }
+        return reclaimed;
+    }
+
     void out_of_memory();
+
+private:
+    Block * _free[CLASSES];
+    unsigned int _small;
 };
 
 
@@ -101,17 +228,34 @@ public:
 
 
 // Wrapper for atomic heap
+// On multicore builds, each CPU keeps a magazine of free blocks for each size class in front of the shared heap,
+// so most allocations and releases neither take the heap lock nor touch other CPUs' cache lines. Magazines are
+// refilled and flushed in batches of half their capacity. They are only used where _heap_pin() can keep the
+// caller from migrating (i.e. at system level), user-level heaps go straight to the shared heap.
 extern "C" {
     void _heap_lock();
     void _heap_unlock();
+    int _heap_pin(); // returns the current CPU or -1 if per-CPU caching is not possible
+    void _heap_unpin();
 }
 
 template<typename T>
 class Heap_Wrapper<T, true>: public T
 {
+private:
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+    static const unsigned int CLASSES = T::CLASSES;
+    static const unsigned int ROUNDS = 16;      // maximum number of blocks in a magazine
+    static const unsigned int MAGAZINE = 4096;  // maximum number of bytes in a magazine
+
+    struct Magazine {
+        unsigned int count;
+        void * rounds[ROUNDS];
+    };
+
 public:
-    Heap_Wrapper() {}
-    Heap_Wrapper(void * addr, unsigned int bytes): T(addr, bytes) {}
+    Heap_Wrapper() { init(); }
+    Heap_Wrapper(void * addr, unsigned int bytes): T(addr, bytes) { init(); }
 
     bool empty() {
         enter();
@@ -128,6 +272,19 @@ public:
     }
 
     void * alloc(unsigned int bytes) {
+        unsigned int c = bytes ? T::size_class(T::gross(bytes)) : CLASSES;
+        if(c < CLASSES) {
+            int cpu = _heap_pin();
+            if(cpu >= 0) {
+                Magazine * m = &_magazines[cpu][c];
+                void * tmp = m->count ? m->rounds[--m->count] : 0;
+                _heap_unpin();
+                if(tmp)
+                    return tmp;
+                return refill(c, bytes);
+            }
+        }
+
         enter();
         void * tmp = T::alloc(bytes);
         leave();
@@ -141,14 +298,106 @@ public:
     }
 
     void free(void * ptr, unsigned int bytes) {
+        unsigned int c = T::size_class(bytes);
+        if(ptr && (c < CLASSES) && (bytes == T::block_size(c))) {
+            int cpu = _heap_pin();
+            if(cpu >= 0) {
+                Magazine * m = &_magazines[cpu][c];
+                if(m->count < capacity(c)) {
+                    m->rounds[m->count++] = T::mark(reinterpret_cast<char *>(ptr), bytes);
+                    _heap_unpin();
+                    return;
+                }
+                _heap_unpin();
+                flush(c);
+            }
+        }
+
         enter();
         T::free(ptr, bytes);
         leave();
     }
 
+    // Blocks carry a pointer to the T inside the wrapper that allocated them, so the release must be redirected
+    static void typed_free(void * ptr) {
+        int * addr = reinterpret_cast<int *>(ptr);
+        unsigned int bytes = *--addr;
+        Heap_Wrapper * heap = static_cast<Heap_Wrapper *>(reinterpret_cast<T *>(*--addr));
+        heap->free(addr, bytes);
+    }
+
+    static void untyped_free(Heap_Wrapper * heap, void * ptr) {
+        int * addr = reinterpret_cast<int *>(ptr);
+        unsigned int bytes = *--addr;
+        heap->free(addr, bytes);
+    }
+
 private:
     void enter() { _heap_lock(); }
     void leave() { _heap_unlock(); }
+
+    void init() {
+        for(unsigned int i = 0; i < CPUS; i++)
+            for(unsigned int j = 0; j < CLASSES; j++)
+                _magazines[i][j].count = 0;
+    }
+
+    static unsigned int capacity(unsigned int c) {
+        return (MAGAZINE / T::block_size(c) < ROUNDS) ? MAGAZINE / T::block_size(c) : ROUNDS;
+    }
+
+    static unsigned int batch(unsigned int c) {
+        return (capacity(c) > 1) ? capacity(c) / 2 : 1;
+    }
+
+    // Takes a batch of blocks of the size class of a request from the shared heap, returning one and caching
+    // the others (the caller might be on another CPU by the time they get cached, which is fine)
+    void * refill(unsigned int c, unsigned int bytes) {
+        void * blocks[ROUNDS];
+        unsigned int n = batch(c);
+
+        enter();
+        for(unsigned int i = 0; i < n; i++)
+            blocks[i] = T::alloc(bytes);
+        leave();
+
+        unsigned int i = 1;
+        int cpu = _heap_pin();
+        Magazine * m = &_magazines[cpu][c];
+        for(; (i < n) && blocks[i] && (m->count < capacity(c)); i++)
+            m->rounds[m->count++] = blocks[i];
+        _heap_unpin();
+
+        if(i < n) {
+            enter();
+            for(; i < n; i++)
+                if(blocks[i])
+                    T::free(reinterpret_cast<char *>(blocks[i]) - T::HEADER, T::block_size(c));
+            leave();
+        }
+
+        return blocks[0];
+    }
+
+    // Gives a batch of blocks from the current CPU's magazine back to the shared heap
+    void flush(unsigned int c) {
+        void * blocks[ROUNDS];
+        unsigned int n = 0;
+
+        int cpu = _heap_pin();
+        Magazine * m = &_magazines[cpu][c];
+        for(; (n < batch(c)) && m->count; n++)
+            blocks[n] = m->rounds[--m->count];
+        _heap_unpin();
+
+        enter();
+        for(unsigned int i = 0; i < n; i++)
+            T::free(reinterpret_cast<char *>(blocks[i]) - T::HEADER, T::block_size(c));
+        leave();
+    }
+
+private:
+    Magazine _magazines[CPUS][CLASSES];
 };
 
 
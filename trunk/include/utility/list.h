@@ -4,6 +4,7 @@
 #define __list_h
 
 #include <system/config.h>
+#include "bitmap.h"
 
 __BEGIN_UTIL
 
@@ -232,6 +233,44 @@ namespace List_Elements
     };
 
 
+    // Scheduling Heap Element
+    // Besides the links used when the element is in an ordinary list (e.g. a
+    // synchronizer's queue), it carries the child pointer used by pairing heaps.
+    // While in a heap, prev() is the parent for the leftmost child and the left
+    // sibling for all others, and next() is the right sibling.
+    template<typename T, typename R = Rank>
+    class Doubly_Linked_Heap_Scheduling
+    {
+    public:
+        typedef T Object_Type;
+        typedef Rank Rank_Type;
+        typedef Doubly_Linked_Heap_Scheduling Element;
+
+    public:
+        Doubly_Linked_Heap_Scheduling(const T * o,  const R & r = 0): _object(o), _rank(r), _prev(0), _next(0), _child(0) {}
+
+        T * object() const { return const_cast<T *>(_object); }
+
+        Element * prev() const { return _prev; }
+        Element * next() const { return _next; }
+        Element * child() const { return _child; }
+        void prev(Element * e) { _prev = e; }
+        void next(Element * e) { _next = e; }
+        void child(Element * e) { _child = e; }
+
+        const R & rank() const { return _rank; }
+        void rank(const R & r) { _rank = r; }
+        int promote(const R & n = 1) { _rank -= n; return _rank; }
+        int demote(const R & n = 1) { _rank += n; return _rank; }
+
+    private:
+        const T * _object;
+        R _rank;
+        Element * _prev;
+        Element * _next;
+        Element * _child;
+    };
+
     // Grouping List Element
     template<typename T>
     class Doubly_Linked_Grouping
@@ -1088,6 +1127,479 @@ private:
 };
 
 
+// Doubly-Linked, Bitmap-Indexed Scheduling List
+// A Scheduling_List for static priorities whose operations do not depend on the
+// number of elements in the list. Ranks are mapped onto LEVELS ordered priority
+// levels (one per rank for small ranks, logarithmic buckets for larger ones and
+// a level of its own for IDLE). A bitmap of non-empty levels and a pointer to
+// the first element of each level let insert() find its place with a single
+// find-first-set. Elements sharing a level are kept in rank order by walking
+// back from the next level, which costs nothing in the usual cases of equal
+// (e.g. RR) or monotonically growing (e.g. FCFS) ranks. Like in the other
+// scheduling lists, ranks must not be changed while an element is in the list.
+template<typename T,
+          typename R = typename T::Criterion,
+          typename El = List_Elements::Doubly_Linked_Scheduling<T, R> >
+class Bitmap_Scheduling_List: private List<T, El>
+{
+private:
+    typedef List<T, El> Base;
+
+    static const unsigned int EXACT = 16;
+    static const unsigned int FRACTION = 3; // bits of each bucket's mantissa
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef typename Base::Iterator Iterator;
+
+    static const unsigned int LEVELS = 256;
+
+public:
+    Bitmap_Scheduling_List(): _chosen(0) {
+        for(unsigned int i = 0; i < LEVELS; i++)
+            _first[i] = 0;
+    }
+
+    using Base::empty;
+    using Base::size;
+    using Base::head;
+    using Base::tail;
+    using Base::begin;
+    using Base::end;
+
+    Element * volatile & chosen() { return _chosen; }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Bitmap_Scheduling_List::insert(e=" << e
+                       << ") => {p=" << (e ? e->prev() : (void *) -1)
+                       << ",o=" << (e ? e->object() : (void *) -1)
+                       << ",n=" << (e ? e->next() : (void *) -1)
+                       << "}" << endl;
+
+        if(_chosen)
+            enqueue(e);
+        else
+            _chosen = e;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Bitmap_Scheduling_List::remove(e=" << e
+                       << ") => {p=" << (e ? e->prev() : (void *) -1)
+                       << ",o=" << (e ? e->object() : (void *) -1)
+                       << ",n=" << (e ? e->next() : (void *) -1)
+                       << "}" << endl;
+
+        if(e == _chosen)
+            _chosen = dequeue_head();
+        else
+            e = dequeue(e);
+
+        return e;
+    }
+
+    Element * choose() {
+        db<Lists>(TRC) << "Bitmap_Scheduling_List::choose()" << endl;
+
+        if(!empty()) {
+            enqueue(_chosen);
+            _chosen = dequeue_head();
+        }
+
+        return _chosen;
+    }
+
+    Element * choose_another() {
+        db<Lists>(TRC) << "Bitmap_Scheduling_List::choose_another()" << endl;
+
+        if(!empty() && head()->rank() != R::IDLE) {
+            Element * tmp = _chosen;
+            _chosen = dequeue_head();
+            enqueue(tmp);
+        }
+
+        return _chosen;
+    }
+
+    Element * choose(Element * e) {
+        db<Lists>(TRC) << "Bitmap_Scheduling_List::choose(e=" << e
+                       << ") => {p=" << (e ? e->prev() : (void *) -1)
+                       << ",o=" << (e ? e->object() : (void *) -1)
+                       << ",n=" << (e ? e->next() : (void *) -1)
+                       << "}" << endl;
+
+        if(e != _chosen) {
+            enqueue(_chosen);
+            _chosen = dequeue(e);
+        }
+
+        return _chosen;
+    }
+
+private:
+    static unsigned int level(int rank) {
+        if(rank == R::IDLE)
+            return LEVELS - 1;
+        if(rank < static_cast<int>(EXACT))
+            return (rank < 0) ? 0 : rank;
+        unsigned int exponent = sizeof(int) * 8 - 1 - __builtin_clz(rank);
+        unsigned int mantissa = (rank >> (exponent - FRACTION)) & ((1 << FRACTION) - 1);
+        return EXACT + ((exponent - 4) << FRACTION) + mantissa;
+    }
+
+    void enqueue(Element * e) {
+        unsigned int l = level(e->rank());
+
+        // Walk back from the first element of the next non-empty level (or the tail) to keep ranks in order
+        int n = _levels.first(l + 1);
+        Element * prev = (n >= 0) ? _first[n]->prev() : tail();
+        while(prev && (level(prev->rank()) == l) && (prev->rank() > e->rank()))
+            prev = prev->prev();
+
+        if(!prev)
+            Base::insert_head(e);
+        else if(!prev->next())
+            Base::insert_tail(e);
+        else
+            Base::insert(e, prev, prev->next());
+
+        if(!prev || (level(prev->rank()) != l)) {
+            _first[l] = e;
+            _levels.set(l);
+        }
+    }
+
+    Element * dequeue(Element * e) {
+        unsigned int l = level(e->rank());
+
+        if(_first[l] == e) {
+            Element * next = e->next();
+            if(next && (level(next->rank()) == l))
+                _first[l] = next;
+            else {
+                _first[l] = 0;
+                _levels.reset(l);
+            }
+        }
+
+        return Base::remove(e);
+    }
+
+    Element * dequeue_head() { return empty() ? 0 : dequeue(head()); }
+
+private:
+    Element * volatile _chosen;
+    Element * _first[LEVELS];
+    Bitmap<LEVELS> _levels;
+};
+
+
+// Pairing Heap
+// An intrusive min-heap on the elements' ranks with constant-time insert() and
+// head() and logarithmic (amortized) remove(). Elements with equal ranks are
+// not kept in FIFO order. Pairing needs no recursion, so it is safe on small
+// kernel stacks.
+template<typename T,
+          typename R = typename T::Criterion,
+          typename El = List_Elements::Doubly_Linked_Heap_Scheduling<T, R> >
+class Pairing_Heap
+{
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef List_Iterators::Bidirecional<El> Iterator;
+
+public:
+    Pairing_Heap(): _root(0), _size(0) {}
+
+    bool empty() const { return !_size; }
+    unsigned int size() const { return _size; }
+
+    Element * head() { return _root; }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Pairing_Heap::insert(e=" << e << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        e->prev(0);
+        e->next(0);
+        e->child(0);
+        _root = meld(_root, e);
+        _size++;
+    }
+
+    Element * remove() {
+        db<Lists>(TRC) << "Pairing_Heap::remove()" << endl;
+
+        Element * e = _root;
+        if(e) {
+            _root = pair(e->child());
+            _size--;
+        }
+        return e;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Pairing_Heap::remove(e=" << e << ") => {p=" << (e ? e->prev() : (void *) -1)
+                       << ",o=" << (e ? e->object() : (void *) -1) << ",n=" << (e ? e->next() : (void *) -1) << "}" << endl;
+
+        if(e == _root)
+            return remove();
+
+        // Cut e's subtree off its parent or left sibling and meld the pairing of its children back into the heap
+        Element * prev = e->prev();
+        if(prev->child() == e)
+            prev->child(e->next());
+        else
+            prev->next(e->next());
+        if(e->next())
+            e->next()->prev(prev);
+
+        _root = meld(_root, pair(e->child()));
+        _size--;
+
+        return e;
+    }
+
+    Element * remove_head() { return remove(); }
+
+private:
+    // Links two roots (whose next() must be null) making the one with the larger rank the leftmost child of the other
+    static Element * meld(Element * a, Element * b) {
+        if(!a)
+            return b;
+        if(!b)
+            return a;
+        if(b->rank() < a->rank()) {
+            Element * tmp = a;
+            a = b;
+            b = tmp;
+        }
+        b->prev(a);
+        b->next(a->child());
+        if(a->child())
+            a->child()->prev(b);
+        a->child(b);
+        return a;
+    }
+
+    // Standard two-pass pairing of a sibling list: meld pairs left to right, then meld the results right to left
+    static Element * pair(Element * first) {
+        Element * pairs = 0; // pairs are stacked through next()
+        while(first) {
+            Element * a = first;
+            Element * b = a->next();
+            first = b ? b->next() : 0;
+            a->next(0);
+            if(b)
+                b->next(0);
+            a = meld(a, b);
+            a->next(pairs);
+            pairs = a;
+        }
+
+        Element * root = 0;
+        while(pairs) {
+            Element * next = pairs->next();
+            pairs->next(0);
+            root = meld(root, pairs);
+            pairs = next;
+        }
+        if(root)
+            root->prev(0);
+
+        return root;
+    }
+
+private:
+    Element * _root;
+    unsigned int _size;
+};
+
+
+// Heap-Ordered Scheduling List
+// A Scheduling_List whose non-chosen elements are kept in a Pairing_Heap
+// instead of an Ordered_List, so releasing a job under dynamic priority
+// criteria (e.g. EDF) no longer walks the ready list. The elements must be
+// Doubly_Linked_Heap_Scheduling and cannot be iterated over in rank order.
+template<typename T,
+          typename R = typename T::Criterion,
+          typename El = List_Elements::Doubly_Linked_Heap_Scheduling<T, R> >
+class Heap_Scheduling_List: private Pairing_Heap<T, R, El>
+{
+private:
+    typedef Pairing_Heap<T, R, El> Base;
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef typename Base::Iterator Iterator;
+
+public:
+    Heap_Scheduling_List(): _chosen(0) {}
+
+    using Base::empty;
+    using Base::size;
+    using Base::head;
+
+    Element * volatile & chosen() { return _chosen; }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Heap_Scheduling_List::insert(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        if(_chosen)
+            Base::insert(e);
+        else
+            _chosen = e;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Heap_Scheduling_List::remove(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        if(e == _chosen)
+            _chosen = Base::remove_head();
+        else
+            e = Base::remove(e);
+
+        return e;
+    }
+
+    Element * choose() {
+        db<Lists>(TRC) << "Heap_Scheduling_List::choose()" << endl;
+
+        if(!empty()) {
+            Base::insert(_chosen);
+            _chosen = Base::remove_head();
+        }
+
+        return _chosen;
+    }
+
+    Element * choose_another() {
+        db<Lists>(TRC) << "Heap_Scheduling_List::choose_another()" << endl;
+
+        if(!empty() && head()->rank() != R::IDLE) {
+            Element * tmp = _chosen;
+            _chosen = Base::remove_head();
+            Base::insert(tmp);
+        }
+
+        return _chosen;
+    }
+
+    Element * choose(Element * e) {
+        db<Lists>(TRC) << "Heap_Scheduling_List::choose(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        if(e != _chosen) {
+            Base::insert(_chosen);
+            _chosen = Base::remove(e);
+        }
+
+        return _chosen;
+    }
+
+private:
+    Element * volatile _chosen;
+};
+
+
+// Heap-Ordered, Multihead Scheduling List
+// Same as Multihead_Scheduling_List (see below), but with the non-chosen
+// elements kept in a Pairing_Heap shared by all heads.
+template<typename T,
+          typename R = typename T::Criterion,
+          typename El = List_Elements::Doubly_Linked_Heap_Scheduling<T, R>,
+          unsigned int H = R::HEADS>
+class Multihead_Heap_Scheduling_List: private Pairing_Heap<T, R, El>
+{
+private:
+    typedef Pairing_Heap<T, R, El> Base;
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef typename Base::Iterator Iterator;
+
+public:
+    Multihead_Heap_Scheduling_List() {
+        for(unsigned int i = 0; i < H; i++)
+            _chosen[i] = 0;
+    }
+
+    using Base::empty;
+    using Base::size;
+    using Base::head;
+
+    Element * volatile & chosen() { return _chosen[R::current_head()]; }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Multihead_Heap_Scheduling_List::insert(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        if(_chosen[R::current_head()])
+            Base::insert(e);
+        else
+            _chosen[R::current_head()] = e;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Multihead_Heap_Scheduling_List::remove(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        if(e == _chosen[R::current_head()])
+            _chosen[R::current_head()] = Base::remove_head();
+        else
+            e = Base::remove(e);
+
+        return e;
+    }
+
+    Element * choose() {
+        db<Lists>(TRC) << "Multihead_Heap_Scheduling_List::choose()" << endl;
+
+        if(!empty()) {
+            Base::insert(_chosen[R::current_head()]);
+            _chosen[R::current_head()] = Base::remove_head();
+        }
+
+        return _chosen[R::current_head()];
+    }
+
+    Element * choose_another() {
+        db<Lists>(TRC) << "Multihead_Heap_Scheduling_List::choose_another()" << endl;
+
+        if(!empty() && head()->rank() != R::IDLE) {
+            Element * tmp = _chosen[R::current_head()];
+            _chosen[R::current_head()] = Base::remove_head();
+            Base::insert(tmp);
+        }
+
+        return _chosen[R::current_head()];
+    }
+
+    Element * choose(Element * e) {
+        db<Lists>(TRC) << "Multihead_Heap_Scheduling_List::choose(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        if(e != _chosen[R::current_head()]) {
+            Base::insert(_chosen[R::current_head()]);
+            _chosen[R::current_head()] = Base::remove(e);
+        }
+
+        return _chosen[R::current_head()];
+    }
+
+private:
+    Element * volatile _chosen[H];
+};
+
+
 // Doubly-Linked, Multihead Scheduling List
 // Besides declaring "Criterion", objects subject to scheduling policies that
 // use the Multihead list must export the HEADS constant to indicate the
@@ -176,12 +176,15 @@ private:
 template<typename T1, typename T2 = void>
 class Data_Observer;
 
+template<typename T1, typename T2, unsigned int SIZE>
+class Hashed_Data_Observed;
+
 template<typename T1, typename T2 = void>
 class Data_Observed
 {
     friend class Data_Observer<T1, T2>;
 
-private:
+protected:
     typedef Data_Observer<T1, T2> Observer;
     typedef typename Simple_Ordered_List<Data_Observer<T1, T2>, T2>::Element Element;
 
@@ -244,10 +247,87 @@ private:
     Simple_Ordered_List<Data_Observer<T1, T2>, T2> _observers;
 };
 
+// Data Observed with observers spread over a hash table indexed by their conditions, so notify() only visits
+// the observers in the condition's bucket instead of all of them (e.g. sockets keyed by (port, peer, peer port))
+template<typename T1, typename T2, unsigned int SIZE>
+class Hashed_Data_Observed: public Data_Observed<T1, T2>
+{
+private:
+    typedef Data_Observed<T1, T2> Base;
+    typedef typename Base::Observer Observer;
+    typedef typename Base::Element Element;
+    typedef Simple_List<Observer, Element> Bucket;
+
+public:
+    Hashed_Data_Observed() {
+        db<Observers>(TRC) << "Hashed_Data_Observed<T>() => " << this << endl;
+    }
+
+    ~Hashed_Data_Observed() {
+        db<Observers>(TRC) << "~Hashed_Data_Observed<T>(this=" << this << ")" << endl;
+    }
+
+    virtual void attach(Observer * o, T2 c) {
+        db<Observers>(TRC) << "Hashed_Data_Observed<T>::attach(obs=" << o << ",cond=" << c << ")" << endl;
+
+        o->_link = Element(o, c);
+        bucket(c)->insert(&o->_link);
+    }
+
+    virtual void detach(Observer * o, T2 c) {
+        db<Observers>(TRC) << "Hashed_Data_Observed<T>::detach(obs=" << o << ",cond=" << c << ")" << endl;
+
+        bucket(c)->remove(&o->_link);
+    }
+
+    virtual bool notify(T2 c, T1 * d) {
+        bool notified = false;
+
+        db<Observers>(TRC) << "Hashed_Data_Observed<T>::notify(this=" << this << ",cond=" << c << ")" << endl;
+
+        // Observers might reattach themselves under other conditions during update(), so fetch next() beforehand
+        for(Element * e = bucket(c)->head(), * next; e; e = next) {
+            next = e->next();
+            if(e->rank() == c) {
+                db<Observers>(INF) << "Hashed_Data_Observed<T>::notify(this=" << this << ",obs=" << e->object() << ")" << endl;
+                e->object()->update(this, c, d);
+                notified = true;
+            }
+        }
+
+        return notified;
+    }
+
+    virtual Observer * observer(T2 c, unsigned int index = 0) {
+        Observer * o = 0;
+        for(Element * e = bucket(c)->head(); e; e = e->next()) {
+            if(e->rank() == c) {
+                if(!index)
+                    o =  e->object();
+                else
+                    index--;
+            }
+        }
+        return o;
+    }
+
+private:
+    // Folds all the condition's bits into the index, since the low ones alone (e.g. the local port) are often shared
+    Bucket * bucket(const T2 & c) {
+        unsigned long long k = static_cast<unsigned long long>(c);
+        unsigned int h = static_cast<unsigned int>(k ^ (k >> 32));
+        return &_buckets[(h ^ (h >> 16)) % SIZE];
+    }
+
+private:
+    Bucket _buckets[SIZE];
+};
+
 template<typename T1, typename T2>
 class Data_Observer
 {
     friend class Data_Observed<T1, T2>;
+    template<typename, typename, unsigned int> friend class Hashed_Data_Observed;
 
 public:
     typedef T1 Observed_Data;
@@ -12,60 +12,191 @@ class This_Thread
 {
 public:
     static unsigned int id();
+    static unsigned int cpu();
     static void not_booting() { _not_booting = true; }
 
 private:
     static bool _not_booting;
 };
 
-// Recursive Spin Lock
-class Spin
+// Flat Spin Lock (test-and-test-and-set)
+// Waiters spin on a cached copy of the lock and only try to take it once it looks free
+class Simple_Spin
+{
+public:
+    Simple_Spin(): _locked(false) {}
+
+    void acquire() {
+        while(CPU::tsl(_locked))
+            while(_locked);
+
+        db<Spin>(TRC) << "Spin::acquire[SPIN=" << this << "]()" << endl;
+    }
+
+    void release() {
+//        if(_locked)
+            _locked = 0;
+
+        db<Spin>(TRC) << "Spin::release[SPIN=" << this << "]()}" << endl;
+    }
+
+private:
+    volatile bool _locked;
+};
+
+// Flat Ticket Spin Lock
+// Each acquirer takes a ticket and waits for it to be served, so the lock is handed over in FIFO order
+class Ticket_Spin
+{
+public:
+    Ticket_Spin(): _next(0), _serving(0) {}
+
+    void acquire() {
+        unsigned int ticket = CPU::finc(_next);
+        while(_serving != ticket);
+
+        db<Spin>(TRC) << "Ticket_Spin::acquire[SPIN=" << this << "]() => {ticket=" << ticket << "}" << endl;
+    }
+
+    void release() {
+        _serving = _serving + 1;
+
+        db<Spin>(TRC) << "Ticket_Spin::release[SPIN=" << this << "]() => {serving=" << _serving << "}" << endl;
+    }
+
+private:
+    volatile unsigned int _next;
+    volatile unsigned int _serving;
+};
+
+// Flat MCS Spin Lock (a la Mellor-Crummey and Scott)
+// Acquirers queue up and each one spins on its own node, so a release only disturbs the next one in line.
+// There is one node per CPU, so the lock must be acquired with interrupts disabled (as kernel locks are).
+class MCS_Spin
 {
+private:
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+
+    struct Node {
+        Node * volatile next;
+        volatile bool waiting;
+    };
+
 public:
-    Spin(): _level(0), _owner(0) {}
+    MCS_Spin(): _tail(0) {}
+
+    void acquire() {
+        Node * me = &_nodes[This_Thread::cpu()];
+        me->next = 0;
+        me->waiting = true;
+
+        Node * prev;
+        do
+            prev = _tail;
+        while(CPU::cas(_tail, prev, me) != prev);
+
+        if(prev) {
+            prev->next = me;
+            while(me->waiting);
+        }
+
+        db<Spin>(TRC) << "MCS_Spin::acquire[SPIN=" << this << "]() => {node=" << me << ",prev=" << prev << "}" << endl;
+    }
+
+    void release() {
+        Node * me = &_nodes[This_Thread::cpu()];
+
+        db<Spin>(TRC) << "MCS_Spin::release[SPIN=" << this << "]() => {node=" << me << ",next=" << me->next << "}" << endl;
+
+        if(!me->next) {
+            if(CPU::cas(_tail, me, static_cast<Node *>(0)) == me)
+                return;
+            while(!me->next); // a successor is linking itself
+        }
+        me->next->waiting = false;
+    }
+
+private:
+    Node * volatile _tail;
+    Node _nodes[CPUS];
+};
+
+// Recursive Spin Lock built on top of a flat one
+template<typename L>
+class Recursive_Spin
+{
+public:
+    Recursive_Spin(): _level(0), _owner(0) {}
 
     void acquire() {
         int me = This_Thread::id();
 
-        while(CPU::cas(_owner, 0, me) != me);
+        if(_owner != me) {
+            _lock.acquire();
+            _owner = me;
+        }
         _level++;
 
         db<Spin>(TRC) << "Spin::acquire[SPIN=" << this << ",ID=" << me << "]() => {owner=" << _owner << ",level=" << _level << "}" << endl;
     }
 
     void release() {
-    	if(--_level <= 0)
+        if(_level > 1)
+            _level--;
+        else if(_owner) {
+            _level = 0;
             _owner = 0;
+            _lock.release();
+        }
 
         db<Spin>(TRC) << "Spin::release[SPIN=" << this << "]() => {owner=" << _owner << ",level=" << _level << "}" << endl;
     }
 
 private:
+    L _lock;
     volatile int _level;
     volatile int _owner;
 };
 
-// Flat Spin Lock
-class Simple_Spin
+// Recursive Spin Lock using the algorithm selected by ALGORITHM (see Traits<Spin>)
+template<unsigned int ALGORITHM>
+class Spin_Lock: public Recursive_Spin<typename IF<ALGORITHM == Traits<Spin>::MCS, MCS_Spin,
+                                                  typename IF<ALGORITHM == Traits<Spin>::TICKET, Ticket_Spin,
+                                                               Simple_Spin>::Result>::Result> {};
+
+// Recursive Spin Lock using the system-wide algorithm (components can pick another one through their SPIN traits)
+class Spin: public Spin_Lock<Traits<Spin>::ALGORITHM> {};
+
+// Scoped critical section over data shared with interrupt handlers: masks interrupts on this CPU and, on multicore
+// builds, also holds the lock. Interrupts are restored to the state they were in when the section was entered.
+// release() and acquire() leave and reenter the section within the scope (e.g. around an allocation).
+template<typename L = Spin>
+class Spin_Guard
 {
 public:
-    Simple_Spin(): _locked(false) {}
+    Spin_Guard(L & lock): _lock(lock) { acquire(); }
+    ~Spin_Guard() { if(_held) release(); }
 
     void acquire() {
-        while(CPU::tsl(_locked));
-
-        db<Spin>(TRC) << "Spin::acquire[SPIN=" << this << "]()" << endl;
+        _disabled = CPU::int_disabled();
+        CPU::int_disable();
+        if(Traits<System>::multicore)
+            _lock.acquire();
+        _held = true;
     }
 
     void release() {
-//        if(_locked)
-            _locked = 0;
-
-        db<Spin>(TRC) << "Spin::release[SPIN=" << this << "]()}" << endl;
+        _held = false;
+        if(Traits<System>::multicore)
+            _lock.release();
+        if(!_disabled)
+            CPU::int_enable();
     }
 
 private:
-    volatile bool _locked;
+    L & _lock;
+    bool _disabled;
+    bool _held;
 };
 
 __END_UTIL
@@ -0,0 +1,226 @@
+// EPOS Timing Wheel Utility Declarations
+
+// Timing_Wheel is a hierarchical timing wheel (a la Varghese and Lauck)
+// that keeps objects tagged with the absolute time (in ticks) at which they
+// expire, i.e. "element.rank". Level 0 has one slot per tick for the next
+// 2^BITS ticks, while each slot of level L covers 2^(BITS * L) ticks and is
+// cascaded onto the lower levels when the wheel gets to it. Insertions and
+// removals take constant time, finding the next expiration takes at most a
+// find-first-set per level and expiring elements only visits non-empty
+// slots, so the wheel can be advanced by arbitrarily many ticks at once.
+// Elements farther than 2^(BITS * LEVELS) ticks away are parked on the
+// last slot of the top level and cascaded again until they get in range.
+// Ranks are compared modulo 2^32, so they can wrap around.
+
+#ifndef __wheel_h
+#define	__wheel_h
+
+#include <system/config.h>
+#include "list.h"
+#include "bitmap.h"
+
+__BEGIN_UTIL
+
+namespace List_Elements
+{
+    // Timing Wheel Element
+    // Besides the links, it records the slot the element is in (0 if none)
+    template<typename T, typename R = Rank>
+    class Doubly_Linked_Timed
+    {
+    public:
+        typedef T Object_Type;
+        typedef Rank Rank_Type;
+        typedef Doubly_Linked_Timed Element;
+        typedef List<T, Element> Slot;
+
+    public:
+        Doubly_Linked_Timed(const T * o,  const R & r = 0): _object(o), _rank(r), _prev(0), _next(0), _slot(0) {}
+
+        T * object() const { return const_cast<T *>(_object); }
+
+        Element * prev() const { return _prev; }
+        Element * next() const { return _next; }
+        void prev(Element * e) { _prev = e; }
+        void next(Element * e) { _next = e; }
+
+        const R & rank() const { return _rank; }
+        void rank(const R & r) { _rank = r; }
+
+        Slot * slot() const { return _slot; }
+        void slot(Slot * s) { _slot = s; }
+
+    private:
+        const T * _object;
+        R _rank;
+        Element * _prev;
+        Element * _next;
+        Slot * _slot;
+    };
+};
+
+template<typename T,
+          typename R = List_Element_Rank,
+          typename El = List_Elements::Doubly_Linked_Timed<T, R>,
+          unsigned int LEVELS = 4,
+          unsigned int BITS = 6>
+class Timing_Wheel
+{
+private:
+    typedef typename El::Slot Slot;
+
+    static const unsigned int SLOTS = 1 << BITS;
+    static const unsigned int MASK = SLOTS - 1;
+    static const unsigned int SPAN = 1U << (BITS * LEVELS);
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+
+public:
+    Timing_Wheel(const R & now = 0): _now(now), _size(0) {}
+
+    bool empty() const { return (_size == 0); }
+    unsigned int size() const { return _size; }
+
+    // The next tick to be expired
+    const R & now() const { return _now; }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Timing_Wheel::insert(e=" << e << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1) << ",now=" << int(_now) << "}" << endl;
+
+        place(e);
+        _size++;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Timing_Wheel::remove(e=" << e << ") => {o=" << (e ? e->object() : (void *) -1) << "}" << endl;
+
+        Slot * s = e->slot();
+        if(!s)
+            return 0;
+
+        s->remove(e);
+        e->slot(0);
+        if(s->empty())
+            unmark(s);
+        _size--;
+
+        return e;
+    }
+
+    // Removes an element whose rank is not after "now", advancing the wheel up to "now" on the way.
+    // Returns 0 (with the wheel at "now + 1") when there is no such element.
+    Element * expire(const R & now) {
+        while(distance(_now, now) >= 0) {
+            unsigned int index = _now & MASK;
+            Slot * s = &_slots[0][index];
+            if(!s->empty())
+                return remove(s->head());
+
+            // Skip directly to the next non-empty slot of this turn or, if there is none, to the next tick
+            // in which something may expire (turns whose cascades would be empty are skipped altogether)
+            int n = _maps[0].first(index + 1);
+            R next = (n >= 0) ? later(_now, n - index) : empty() ? later(now, 1) : this->next();
+            if(distance(next, now) < 0)
+                next = later(now, 1);
+            advance(next);
+        }
+
+        return 0;
+    }
+
+    // Earliest tick at which expire() may return an element (elements in the upper levels
+    // are accounted for at the tick in which they get cascaded). Only meaningful if !empty().
+    R next() const {
+        unsigned int index = _now & MASK;
+        int n = _maps[0].first(index);
+        if(n >= 0)
+            return later(_now, n - index);
+
+        unsigned int shortest = SPAN;
+        n = _maps[0].first(0);
+        if(n >= 0)
+            shortest = SLOTS - index + n;
+
+        for(unsigned int level = 1; level < LEVELS; level++) {
+            unsigned int turn = static_cast<unsigned int>(_now) >> (BITS * level);
+            index = turn & MASK;
+            n = _maps[level].first(index + 1);
+            if(n < 0)
+                n = _maps[level].first(0);
+            if(n < 0)
+                continue;
+            unsigned int slots = (n - index) & MASK;
+            unsigned int d = ((turn + (slots ? slots : SLOTS)) << (BITS * level)) - static_cast<unsigned int>(_now);
+            if(d < shortest)
+                shortest = d;
+        }
+
+        return later(_now, shortest);
+    }
+
+private:
+    static int distance(const R & from, const R & to) {
+        return static_cast<int>(static_cast<unsigned int>(to) - static_cast<unsigned int>(from));
+    }
+
+    static R later(const R & t, unsigned int ticks) {
+        return static_cast<int>(static_cast<unsigned int>(t) + ticks);
+    }
+
+    void place(Element * e) {
+        int delta = distance(_now, e->rank());
+        R when = e->rank();
+        if(delta < 0) { // late, expire on the next call to expire()
+            delta = 0;
+            when = _now;
+        } else if(static_cast<unsigned int>(delta) >= SPAN) {
+            delta = SPAN - 1;
+            when = later(_now, delta);
+        }
+
+        unsigned int level = 0;
+        while((level < LEVELS - 1) && (static_cast<unsigned int>(delta) >= (1U << (BITS * (level + 1)))))
+            level++;
+
+        unsigned int index = (static_cast<unsigned int>(when) >> (BITS * level)) & MASK;
+        _slots[level][index].insert_tail(e);
+        e->slot(&_slots[level][index]);
+        _maps[level].set(index);
+    }
+
+    void unmark(Slot * s) {
+        unsigned int i = s - &_slots[0][0];
+        _maps[i / SLOTS].reset(i % SLOTS);
+    }
+
+    void advance(const R & now) {
+        _now = now;
+        if(_now & MASK)
+            return;
+
+        // Crossed a turn of level 0, so cascade the current slot of each level whose turn also ended
+        for(unsigned int level = 1; level < LEVELS; level++) {
+            unsigned int index = (static_cast<unsigned int>(_now) >> (BITS * level)) & MASK;
+            Slot * s = &_slots[level][index];
+            _maps[level].reset(index);
+            while(!s->empty())
+                place(s->remove_head());
+            if(index)
+                break;
+        }
+    }
+
+private:
+    R _now;
+    unsigned int _size;
+    Slot _slots[LEVELS][SLOTS];
+    Bitmap<SLOTS> _maps[LEVELS];
+};
+
+__END_UTIL
+
+#endif
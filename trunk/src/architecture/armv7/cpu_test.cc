@@ -1,6 +1,7 @@
 // EPOS ARMV7 Test Program
 
 #include <utility/ostream.h>
+#include <utility/string.h>
 #include <cpu.h>
 
 using namespace EPOS;
@@ -57,6 +58,33 @@ int main()
             else
                 cout << "cas(): ok" << endl;
     }
+    {
+        // Internet checksum: compare the architecture's kernels with a byte-pair reference on every alignment
+        static unsigned char data[1500 + 8];
+        static unsigned char copy[1500 + 8];
+        for(unsigned int i = 0; i < sizeof(data); i++)
+            data[i] = i * 7 + (i >> 8);
+
+        bool ok = true;
+        for(unsigned int off = 0; ok && (off < 8); off++)
+            for(unsigned int size = 0; ok && (size <= 1500); size += (size < 64) ? 1 : 61) {
+                unsigned long sum = 0;
+                for(unsigned int i = 0; i < size; i += 2)
+                    sum += (data[off + i] << 8) | ((i + 1 < size) ? data[off + i + 1] : 0);
+                while(sum >> 16)
+                    sum = (sum & 0xffff) + (sum >> 16);
+
+                unsigned short tmp = cpu.ntohs(cpu.csum(&data[off], size));
+                unsigned short cpy = cpu.ntohs(cpu.csum_copy(&copy[(off + size) % 8], &data[off], size));
+                if((tmp != sum) || (cpy != sum) || memcmp(&copy[(off + size) % 8], &data[off], size)) {
+                    cout << "csum(): doesn't function properly (off=" << off << ",size=" << size << ",sum=" << hex << tmp
+                         << ",copy=" << cpy << ", should be " << sum << ")!" << dec << endl;
+                    ok = false;
+                }
+            }
+        if(ok)
+            cout << "csum(): ok" << endl;
+    }
 
     cout << "ARMv7 test finished" << endl;
 
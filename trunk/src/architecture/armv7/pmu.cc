@@ -19,6 +19,8 @@ const CPU::Reg32 ARMv7_A_PMU::_events[EVENTS] = {
                          /* L1_MISS            */ L1D_REFILL,
                          /* L2_MISS            */ 0,
                          /* L3_MISS            */ 0,
+                         /* LLC_HITM           */ 0,
+                         /* DTLB_MISS          */ L1D_TLB_REFILL,
 };
 
 __END_SYS
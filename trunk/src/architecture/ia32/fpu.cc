@@ -0,0 +1,65 @@
+// EPOS IA32 FPU Mediator Implementation
+
+#include <architecture/ia32/fpu.h>
+#include <machine.h>
+
+__BEGIN_SYS
+
+// Class attributes
+FPU::Context * volatile FPU::_owner[FPU::CPUS];
+FPU::Context * volatile FPU::_current[FPU::CPUS];
+
+
+// Class methods
+void FPU::switch_context(Context * next)
+{
+    unsigned int cpu = Machine::cpu_id();
+    Context * prev = _current[cpu];
+
+    // With SMP, the outgoing thread might resume on another CPU, so the state it has produced here (if it
+    // touched the FPU since it was dispatched, thus clearing TS) must be saved before anyone else can load it
+    if(smp && prev && (_owner[cpu] == prev) && !(CPU::cr0() & CPU::CR0_TS))
+        save(prev);
+
+    _current[cpu] = next;
+
+    // The registers still hold the state of the incoming thread if it was the last one to use them
+    if((_owner[cpu] == next) && (!smp || (next->_cpu == cpu)))
+        clts();
+    else
+        stts();
+}
+
+
+void FPU::discard(Context * ctx)
+{
+    for(unsigned int i = 0; i < CPUS; i++)
+        if(_owner[i] == ctx)
+            _owner[i] = 0;
+}
+
+
+void FPU::nodev(const IC::Interrupt_Id & i)
+{
+    unsigned int cpu = Machine::cpu_id();
+    Context * owner = _owner[cpu];
+    Context * current = _current[cpu];
+
+    clts();
+
+    // The FPU was touched before the first thread was dispatched (i.e. by INIT)
+    if(!current)
+        return;
+
+    db<FPU>(TRC) << "FPU::nodev(cpu=" << cpu << ",owner=" << owner << ",current=" << current << ")" << endl;
+
+    // With SMP, owners were saved when they left the CPU and might have run elsewhere since then
+    if(!smp && owner)
+        save(owner);
+
+    load(current);
+    current->_cpu = cpu;
+    _owner[cpu] = current;
+}
+
+__END_SYS
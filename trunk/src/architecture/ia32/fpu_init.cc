@@ -0,0 +1,37 @@
+// EPOS IA32 FPU Mediator Initialization
+
+#include <architecture/ia32/fpu.h>
+#include <machine.h>
+
+__BEGIN_SYS
+
+void FPU::init()
+{
+    db<Init, FPU>(TRC) << "FPU::init()" << endl;
+
+    Reg32 eax, ebx, ecx = 0, edx;
+    CPU::cpuid(1, &eax, &ebx, &ecx, &edx);
+    if(!(edx & CPUID_FXSR)) {
+        db<Init, FPU>(WRN) << "FPU::init: CPU does not support FXSAVE! FPU context switching won't be available!" << endl;
+        return;
+    }
+
+    // Native FPU error reporting, WAIT/FWAIT also trapping while TS is set, and no emulation
+    CPU::cr0((CPU::cr0() | CPU::CR0_MP | CPU::CR0_NE) & ~CPU::CR0_EM);
+
+    // Let FXSAVE/FXRSTOR handle the SSE registers and SIMD exceptions be reported as such
+    if(edx & CPUID_SSE)
+        CPU::cr4(CPU::cr4() | CPU::CR4_OSFXSR | CPU::CR4_OSXMMEXCPT);
+
+    if(Machine::cpu_id() == 0)
+        IC::int_vector(CPU::EXC_NODEV, nodev);
+
+    _owner[Machine::cpu_id()] = 0;
+    _current[Machine::cpu_id()] = 0;
+
+    // Leave the state of INIT behind: the first thread to touch the FPU will start from a clean context
+    ASM("fninit");
+    stts();
+}
+
+__END_SYS
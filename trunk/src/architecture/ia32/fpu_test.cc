@@ -0,0 +1,134 @@
+// EPOS IA32 FPU Mediator Test Program
+
+// Several threads run the same floating-point computation (x87 and SSE) with different inputs, yielding the CPU
+// in the middle of it, while another one only does integer arithmetic (and must therefore never trap on #NM).
+// Lazy FPU context switching is correct if each thread ends up with the result the main thread computes alone.
+
+#include <utility/ostream.h>
+#include <thread.h>
+
+using namespace EPOS;
+
+const int THREADS = 4;
+const int ITERATIONS = 1000;
+
+OStream cout;
+
+Thread * thread[THREADS];
+volatile double x87[THREADS];
+volatile float sse[THREADS];
+
+// Each step of the computations below runs TERMS iterations in asm, with its operands in the FPU registers, where a
+// preemption (e.g. by the time slicer) finds them live. The i386 ABI leaves neither the x87 stack nor the XMM registers
+// live across calls, so the operands are stored in memory before each Thread::yield() and reloaded afterwards.
+const int TERMS = 16;
+
+// Leibniz series for pi/4, scaled by n. The sum, the denominator and the sign of the next term stay on the x87 stack
+// throughout each step.
+double series(int n, bool yield)
+{
+    double sum = 0;
+    double d = 1;
+    double s = 1;
+
+    for(int k = 0; k < ITERATIONS; k++) {
+        int t = TERMS;
+        ASM("fldl   %[s]            \n"    // [s]
+            "fldl   %[d]            \n"    // [d, s]
+            "fldl   %[sum]          \n"    // [sum, d, s]
+            "1:                     \n"
+            "fld    %%st(2)         \n"    // [s, sum, d, s]
+            "fdiv   %%st(2), %%st   \n"    // [s/d, sum, d, s]
+            "faddp                  \n"    // [sum, d, s]
+            "fxch   %%st(2)         \n"    // [s, d, sum]
+            "fchs                   \n"    // [-s, d, sum]
+            "fld1                   \n"
+            "fadd   %%st(0), %%st   \n"    // [2, -s, d, sum]
+            "faddp  %%st, %%st(2)   \n"    // [-s, d + 2, sum]
+            "fxch   %%st(2)         \n"    // [sum, d + 2, -s]
+            "dec    %[t]            \n"
+            "jnz    1b              \n"
+            "fstpl  %[sum]          \n"
+            "fstpl  %[d]            \n"
+            "fstpl  %[s]            \n"
+            : [sum] "+m"(sum), [d] "+m"(d), [s] "+m"(s), [t] "+r"(t) : : "st", "st(1)", "st(2)", "st(3)", "cc");
+
+        if(yield)
+            Thread::yield();
+    }
+
+    return sum * n;
+}
+
+// Packed single-precision multiply on the XMM registers, which hold the product throughout each step
+float vector(int n, bool yield)
+{
+    float v[4] __attribute__((aligned(16))) = { float(n), float(n) + 0.5f, float(n) + 0.25f, float(n) + 0.125f };
+    float m[4] __attribute__((aligned(16))) = { 1.0001f, 0.9999f, 1.0002f, 0.9998f };
+
+    for(int k = 0; k < ITERATIONS; k++) {
+        int t = TERMS;
+        ASM("movaps %[v], %%xmm0    \n"
+            "movaps %[m], %%xmm1    \n"
+            "1:                     \n"
+            "mulps  %%xmm1, %%xmm0  \n"
+            "dec    %[t]            \n"
+            "jnz    1b              \n"
+            "movaps %%xmm0, %[v]    \n"
+            : [v] "+m"(v), [t] "+r"(t) : [m] "m"(m) : "cc");
+
+        if(yield)
+            Thread::yield();
+    }
+
+    return v[0] + v[1] + v[2] + v[3];
+}
+
+int compute(int n)
+{
+    x87[n] = series(n + 1, true);
+    sse[n] = vector(n + 1, true);
+
+    return n;
+}
+
+int count(int n)
+{
+    int sum = 0;
+    for(int k = 0; k < ITERATIONS; k++) {
+        sum += k;
+        Thread::yield();
+    }
+
+    return sum;
+}
+
+int main()
+{
+    cout << "FPU Test" << endl;
+
+    for(int i = 0; i < THREADS - 1; i++)
+        thread[i] = new Thread(&compute, i);
+    thread[THREADS - 1] = new Thread(&count, THREADS - 1);
+
+    for(int i = 0; i < THREADS; i++)
+        thread[i]->join();
+
+    int errors = 0;
+    for(int i = 0; i < THREADS - 1; i++) {
+        double x = series(i + 1, false);
+        float s = vector(i + 1, false);
+        if((x87[i] != x) || (sse[i] != s))
+            errors++;
+        cout << "Thread " << i << ": x87=" << static_cast<int>(x87[i] * 1000000) << " (expected " << static_cast<int>(x * 1000000)
+             << "), sse=" << static_cast<int>(sse[i] * 1000) << " (expected " << static_cast<int>(s * 1000) << ")" << endl;
+    }
+    cout << "Integer-only thread returned " << thread[THREADS - 1]->join() << endl;
+
+    for(int i = 0; i < THREADS; i++)
+        delete thread[i];
+
+    cout << (errors ? "Failed!" : "Passed!") << endl;
+
+    return 0;
+}
@@ -0,0 +1,297 @@
+#ifndef __traits_h
+#define __traits_h
+
+#include <system/config.h>
+
+__BEGIN_SYS
+
+// Global Configuration
+template<typename T>
+struct Traits
+{
+    static const bool enabled = true;
+    static const bool debugged = true;
+    static const bool hysterically_debugged = false;
+    typedef TLIST<> ASPECTS;
+};
+
+template<> struct Traits<Build>
+{
+    enum {LIBRARY, BUILTIN, KERNEL};
+    static const unsigned int MODE = LIBRARY;
+
+    enum {IA32, ARMv7};
+    static const unsigned int ARCHITECTURE = IA32;
+
+    enum {PC, Cortex};
+    static const unsigned int MACHINE = PC;
+
+    enum {Legacy_PC, eMote3, LM3S811, Zynq};
+    static const unsigned int MODEL = Legacy_PC;
+
+    static const unsigned int CPUS = 2;
+    static const unsigned int NODES = 1; // > 1 => NETWORKING
+};
+
+
+// Utilities
+template<> struct Traits<Debug>
+{
+    static const bool error   = true;
+    static const bool warning = true;
+    static const bool info    = false;
+    static const bool trace   = false;
+};
+
+template<> struct Traits<Lists>: public Traits<void>
+{
+    static const bool debugged = hysterically_debugged;
+};
+
+template<> struct Traits<Spin>: public Traits<void>
+{
+    static const bool debugged = hysterically_debugged;
+
+    // Spin lock algorithm used system-wide (TAS: test-and-test-and-set; TICKET and MCS: FIFO handover)
+    enum {TAS, TICKET, MCS};
+    static const unsigned int ALGORITHM = TAS;
+};
+
+template<> struct Traits<Heaps>: public Traits<void>
+{
+    static const bool debugged = hysterically_debugged;
+
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM; // for the kernel heap lock
+};
+
+
+// System Parts (mostly to fine control debugging)
+template<> struct Traits<Boot>: public Traits<void>
+{
+};
+
+template<> struct Traits<Setup>: public Traits<void>
+{
+};
+
+template<> struct Traits<Init>: public Traits<void>
+{
+};
+
+
+// Mediators
+template<> struct Traits<Serial_Display>: public Traits<void>
+{
+    static const bool enabled = true;
+    enum {UART, USB};
+    static const int ENGINE = UART;
+    static const int COLUMNS = 80;
+    static const int LINES = 24;
+    static const int TAB_SIZE = 8;
+};
+
+template<> struct Traits<CPU>: public Traits<void>
+{
+    enum {LITTLE, BIG};
+    static const unsigned int ENDIANESS         = LITTLE;
+    static const unsigned int WORD_SIZE         = 32;
+    static const unsigned int CLOCK             = 2000000000;
+    static const bool unaligned_memory_access   = true;
+};
+
+template<> struct Traits<TSC>: public Traits<void>
+{
+};
+
+template<> struct Traits<MMU>: public Traits<void>
+{
+    static const bool colorful = false;
+    static const unsigned int COLORS = 1;
+    static const bool large_pages = true;   // use 4 MB pages for the physical memory map and large Segments (if the CPU has PSE)
+    static const unsigned int LARGE_CHUNK = 16 * 1024 * 1024; // smallest Segment mapped with 4 MB pages
+    static const bool global_pages = true;  // keep the kernel's mappings in the TLB across address space switches (if the CPU has PGE)
+};
+
+template<> struct Traits<FPU>: public Traits<void>
+{
+    static const bool enabled = true;
+};
+
+template<> struct Traits<PMU>: public Traits<void>
+{
+    static const bool enabled = true;
+    enum { V1, V2, V3, DUO, MICRO, ATOM, NEHALEN, NETBURST, SANDY_BRIDGE };
+    static const unsigned int VERSION = V2;
+};
+
+__END_SYS
+
+#include __MACH_TRAITS_H
+
+__BEGIN_SYS
+
+
+// Components
+template<> struct Traits<Application>: public Traits<void>
+{
+    static const unsigned int STACK_SIZE = Traits<Machine>::STACK_SIZE;
+    static const unsigned int HEAP_SIZE = Traits<Machine>::HEAP_SIZE;
+    static const unsigned int MAX_THREADS = Traits<Machine>::MAX_THREADS;
+};
+
+template<> struct Traits<System>: public Traits<void>
+{
+    static const unsigned int mode = Traits<Build>::MODE;
+    static const bool multithread = (Traits<Application>::MAX_THREADS > 1);
+    static const bool multitask = (mode != Traits<Build>::LIBRARY);
+    static const bool multicore = (Traits<Build>::CPUS > 1) && multithread;
+    static const bool multiheap = (mode != Traits<Build>::LIBRARY) || Traits<Scratchpad>::enabled;
+
+    enum {FOREVER = 0, SECOND = 1, MINUTE = 60, HOUR = 3600, DAY = 86400, WEEK = 604800, MONTH = 2592000, YEAR = 31536000};
+    static const unsigned long LIFE_SPAN = 1 * HOUR; // in seconds
+
+    static const bool reboot = true;
+
+    static const unsigned int STACK_SIZE = Traits<Machine>::STACK_SIZE;
+    static const unsigned int HEAP_SIZE = (Traits<Application>::MAX_THREADS + 1) * Traits<Application>::STACK_SIZE;
+};
+
+template<> struct Traits<Task>: public Traits<void>
+{
+    static const bool enabled = Traits<System>::multitask;
+};
+
+template<> struct Traits<Thread>: public Traits<void>
+{
+    static const bool smp = Traits<System>::multicore;
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM; // for scheduling queue and synchronizer locks
+
+    typedef Scheduling_Criteria::GRR Criterion;
+    static const unsigned int QUANTUM = 10000; // us
+    static const bool indexed_queues = false; // bitmap-indexed (static) or heap-ordered (dynamic) scheduling queues
+
+    static const bool trace_idle = hysterically_debugged;
+};
+
+template<> struct Traits<Scheduler<Thread> >: public Traits<void>
+{
+    static const bool debugged = Traits<Thread>::trace_idle || hysterically_debugged;
+};
+
+template<> struct Traits<Periodic_Thread>: public Traits<void>
+{
+    static const bool simulate_capacity = false;
+};
+
+template<> struct Traits<Address_Space>: public Traits<void>
+{
+    static const bool enabled = Traits<System>::multiheap;
+};
+
+template<> struct Traits<Segment>: public Traits<void>
+{
+    static const bool enabled = Traits<System>::multiheap;
+};
+
+template<> struct Traits<Alarm>: public Traits<void>
+{
+    static const bool visible = hysterically_debugged;
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM;
+};
+
+template<> struct Traits<Synchronizer>: public Traits<void>
+{
+    static const bool enabled = Traits<System>::multithread;
+
+    // Contended synchronizers are spun on for up to SPINS iterations (while their owners run on other CPUs)
+    // before blocking the calling thread (SMP only)
+    static const unsigned int SPINS = 1000;
+};
+
+template<> struct Traits<Mutex>: public Traits<Synchronizer>
+{
+    // Real-time locking protocol (to bound priority inversion)
+    // INHERITANCE: the owner inherits the priority of the highest-priority thread waiting for the mutex
+    // CEILING: the owner runs at the mutex's priority ceiling while holding it (immediate priority ceiling)
+    enum {NONE, INHERITANCE, CEILING};
+    static const unsigned int PROTOCOL = NONE;
+};
+
+template<> struct Traits<Network>: public Traits<void>
+{
+    static const bool enabled = (Traits<Build>::NODES > 1);
+
+    static const unsigned int RETRIES = 3;
+    static const unsigned int TIMEOUT = 10; // s
+
+    // This list is positional, with one network for each NIC in Traits<NIC>::NICS
+    typedef LIST<IP> NETWORKS;
+};
+
+template<> struct Traits<ELP>: public Traits<Network>
+{
+    static const bool enabled = NETWORKS::Count<ELP>::Result;
+
+    static const bool acknowledged = true;
+};
+
+template<> struct Traits<TSTP>: public Traits<Network>
+{
+    static const bool enabled = NETWORKS::Count<TSTP>::Result;
+};
+
+template<> template <typename S> struct Traits<Smart_Data<S>>: public Traits<Network>
+{
+    static const bool enabled = NETWORKS::Count<TSTP>::Result;
+};
+
+template<> struct Traits<IP>: public Traits<Network>
+{
+    static const bool enabled = NETWORKS::Count<IP>::Result;
+
+    enum {STATIC, MAC, INFO, RARP, DHCP};
+
+    struct Default_Config {
+        static const unsigned int  TYPE    = DHCP;
+        static const unsigned long ADDRESS = 0;
+        static const unsigned long NETMASK = 0;
+        static const unsigned long GATEWAY = 0;
+    };
+
+    template<unsigned int UNIT>
+    struct Config: public Default_Config {};
+
+    static const unsigned int TTL  = 0x40; // Time-to-live
+
+    static const bool forwarding = false; // forward datagrams addressed to other nodes through the routing table
+};
+
+template<> struct Traits<IP>::Config<0> //: public Traits<IP>::Default_Config
+{
+    static const unsigned int  TYPE      = MAC;
+    static const unsigned long ADDRESS   = 0x0a000100;  // 10.0.1.x x=MAC[5]
+    static const unsigned long NETMASK   = 0xffffff00;  // 255.255.255.0
+    static const unsigned long GATEWAY   = 0;           // 10.0.1.1
+};
+
+template<> struct Traits<IP>::Config<1>: public Traits<IP>::Default_Config
+{
+};
+
+template<> struct Traits<UDP>: public Traits<Network>
+{
+    static const bool checksum = true;
+};
+
+template<> struct Traits<TCP>: public Traits<Network>
+{
+    static const unsigned int WINDOW = 4096;
+};
+
+template<> struct Traits<DHCP>: public Traits<Network>
+{
+};
+
+__END_SYS
+
+#endif
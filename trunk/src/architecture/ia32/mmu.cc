@@ -5,7 +5,67 @@
 __BEGIN_SYS
 
 // Class attributes
-MMU::List MMU::_free[colorful * COLORS + 1];
+MMU::White_Frames MMU::_white;
+MMU::Colored_Frames MMU::_colored[colorful ? COLORS : 1];
 MMU::Page_Directory * MMU::_master;
+bool MMU::_large;
+bool MMU::_global;
+unsigned char MMU::_shares[FRAMES];
+Spin MMU::_lock;
+
+// Class methods
+// Resolves faults on demand-zero pages (by mapping them to a cleared frame) and writes to copy-on-write pages (by
+// giving the writer a private copy of the frame, unless it is the last one sharing it). Other faults are errors.
+// The entry is checked and updated with the frame allocators' lock held (it is recursive), so threads faulting on the
+// same page (on other CPUs, or preempted before taking the lock) find it resolved instead of resolving it again.
+bool MMU::page_fault(const Log_Addr & addr, CPU::Reg32 error)
+{
+    PD_Entry pde = (*static_cast<Page_Directory *>(phy2log(current())))[directory(addr)];
+    if(!(pde & IA32_Flags::PRE) || (pde & IA32_Flags::PS))
+        return false;
+
+    Log_Addr * pte = phy2log(&(*static_cast<Page_Table *>(Phy_Addr(indexes(pde))))[page(addr)]);
+
+    Spin_Guard<> guard(_lock);
+
+    if(!(error & PF_PRESENT)) {
+        if(*pte & IA32_Flags::PRE) // mapped meanwhile (e.g. by another thread)
+            return true;
+        if(!*pte) // not a demand-zero page
+            return false;
+
+        Phy_Addr frame = calloc(1, WHITE);
+        if(!frame)
+            return false;
+
+        db<MMU>(TRC) << "MMU::page_fault(addr=" << addr << ") => demand-zero frame=" << frame << endl;
+
+        *pte = frame | *pte | IA32_Flags::PRE;
+        return true;
+    }
+
+    if(!(error & PF_WRITE))
+        return false;
+    if(!(*pte & IA32_Flags::COW)) // copied meanwhile by another thread (which left it writable), or really read-only
+        return *pte & IA32_Flags::RW;
+
+    Phy_Addr frame = indexes(*pte);
+    if(unshare(frame)) { // others still read it, so the writer gets a copy
+        Phy_Addr copy = alloc(1, WHITE);
+        if(!copy) {
+            share(frame);
+            return false;
+        }
+        memcpy(phy2log(copy), phy2log(frame), sizeof(Page));
+        frame = copy;
+    }
+
+    db<MMU>(TRC) << "MMU::page_fault(addr=" << addr << ") => copy-on-write frame=" << frame << endl;
+
+    *pte = frame | ((offset(*pte) | IA32_Flags::RW) & ~IA32_Flags::COW);
+    flush_tlb(addr);
+
+    return true;
+}
 
 __END_SYS
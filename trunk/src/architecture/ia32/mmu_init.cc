@@ -1,6 +1,7 @@
 // EPOS IA32 MMU Mediator Initialization
 
 #include <mmu.h>
+#include <ic.h>
 #include <system.h>
 
 __BEGIN_SYS
@@ -22,8 +23,8 @@ void MMU::init()
 
     // BIG NOTE HERE: INIT (i.e. this program) will be part of the free
     // storage after the following is executed, but it will remain alive
-    // This only works because the _free.insert_merging() only
-    // touches the first page of each chunk and INIT is not there
+    // This only works because the buddy systems keep their bitmaps apart
+    // and never touch the free frames themselves
 
     if(colorful) {
         int f1b = si->pmm.free1_base;
@@ -33,10 +34,10 @@ void MMU::init()
         int f3b = si->pmm.free3_base;
         int f3t = si->pmm.free3_top;
 
-        // Insert a bulk of memory large enough to contain the System's heap into _free[WHITE] lists
+        // Insert a bulk of memory large enough to contain the System's heap into the WHITE buddy system
         int size = Traits<System>::HEAP_SIZE;
         if((f1t - f1b) > size) {
-            white_free(f1b, pages(f1b + size));
+            white_free(f1b, pages(size));
             f1b += size;
             size = 0;
         } else {
@@ -46,7 +47,7 @@ void MMU::init()
         }
         if(size > 0) {
             if((f2t - f2b) > size) {
-                white_free(f2b, pages(f2b + size));
+                white_free(f2b, pages(size));
                 f2b += size;
                 size = 0;
             } else {
@@ -57,7 +58,7 @@ void MMU::init()
         }
         if(size > 0) {
             if((f3t - f3b) > size) {
-                white_free(f3b, pages(f3b + size));
+                white_free(f3b, pages(size));
                 f3b += size;
                 size = 0;
             } else {
@@ -66,10 +67,10 @@ void MMU::init()
                 f3b = f3t = 0;
             }
         }
-        if((size > 0) || (_free[WHITE].grouped_size() * MMU::PAGE_SIZE < Traits<System>::HEAP_SIZE))
+        if((size > 0) || (_white.available() * MMU::PAGE_SIZE < Traits<System>::HEAP_SIZE))
             db<Init, MMU>(ERR) << "MMU::int: System's heap size (Traits<System>::HEAP_SIZE=" << Traits<System>::HEAP_SIZE << ") is larger than memory!" << endl;
 
-        // Insert the remaining free memory into the _free[color] lists
+        // Insert the remaining free memory, frame by frame, into the buddy system of each frame's color
         int frame = f1b;
         while(frame < f1t) {
             free(frame);
@@ -88,7 +89,7 @@ void MMU::init()
             frame += MMU::PAGE_SIZE;
         }
     } else {
-        // Insert all free memory into the _free[WHITE] list
+        // Insert all free memory into the WHITE buddy system
         free(si->pmm.free1_base, pages(si->pmm.free1_top - si->pmm.free1_base));
         free(si->pmm.free2_base, pages(si->pmm.free2_top - si->pmm.free2_base));
         free(si->pmm.free3_base, pages(si->pmm.free3_top - si->pmm.free3_base));
@@ -98,6 +99,15 @@ void MMU::init()
     _master = reinterpret_cast<Page_Directory *>(CPU::pdp());
 
     db<Init, MMU>(INF) << "MMU::master page directory=" << _master << endl;
+
+    // SETUP only enables 4 MB and global pages if both Traits<MMU> and the CPU allow them
+    _large = CPU::cr4() & CPU::CR4_PSE;
+    _global = CPU::cr4() & CPU::CR4_PGE;
+
+    db<Init, MMU>(INF) << "MMU::paging features={large=" << _large << ",global=" << _global << "}" << endl;
+
+    // Demand-zero and copy-on-write pages are resolved on page faults
+    IC::fault_handler(&page_fault);
 }
 
 __END_SYS
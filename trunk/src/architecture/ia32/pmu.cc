@@ -17,6 +17,8 @@ const CPU::Reg32 Intel_PMU_V1::_events[EVENTS] = {
                          /* L1_MISS            */ 0,
                          /* L2_MISS            */ 0,
                          /* L3_MISS            */ LLC_MISSES,
+                         /* LLC_HITM           */ 0,
+                         /* DTLB_MISS          */ DTLB_LOAD_MISSES,
 };
 
 __END_SYS
@@ -51,11 +51,17 @@ template<> struct Traits<Lists>: public Traits<void>
 template<> struct Traits<Spin>: public Traits<void>
 {
     static const bool debugged = hysterically_debugged;
+
+    // Spin lock algorithm used system-wide (TAS: test-and-test-and-set; TICKET and MCS: FIFO handover)
+    enum {TAS, TICKET, MCS};
+    static const unsigned int ALGORITHM = TAS;
 };
 
 template<> struct Traits<Heaps>: public Traits<void>
 {
     static const bool debugged = hysterically_debugged;
+
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM; // for the kernel heap lock
 };
 
 
@@ -125,9 +131,11 @@ template<> struct Traits<Task>: public Traits<void>
 template<> struct Traits<Thread>: public Traits<void>
 {
     static const bool smp = Traits<System>::multicore;
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM; // for scheduling queue and synchronizer locks
 
     typedef Scheduling_Criteria::PEDF Criterion;
     static const unsigned int QUANTUM = 10000; // us
+    static const bool indexed_queues = false; // bitmap-indexed (static) or heap-ordered (dynamic) scheduling queues
 
     static const bool trace_idle = hysterically_debugged;
 };
@@ -155,11 +163,25 @@ template<> struct Traits<Segment>: public Traits<void>
 template<> struct Traits<Alarm>: public Traits<void>
 {
     static const bool visible = hysterically_debugged;
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM;
 };
 
 template<> struct Traits<Synchronizer>: public Traits<void>
 {
     static const bool enabled = Traits<System>::multithread;
+
+    // Contended synchronizers are spun on for up to SPINS iterations (while their owners run on other CPUs)
+    // before blocking the calling thread (SMP only)
+    static const unsigned int SPINS = 1000;
+};
+
+template<> struct Traits<Mutex>: public Traits<Synchronizer>
+{
+    // Real-time locking protocol (to bound priority inversion)
+    // INHERITANCE: the owner inherits the priority of the highest-priority thread waiting for the mutex
+    // CEILING: the owner runs at the mutex's priority ceiling while holding it (immediate priority ceiling)
+    enum {NONE, INHERITANCE, CEILING};
+    static const unsigned int PROTOCOL = NONE;
 };
 
 template<> struct Traits<Network>: public Traits<void>
@@ -190,6 +212,8 @@ template<> struct Traits<IP>: public Traits<Network>
     struct Config: public Default_Config {};
 
     static const unsigned int TTL  = 0x40; // Time-to-live
+
+    static const bool forwarding = false; // forward datagrams addressed to other nodes through the routing table
 };
 
 template<> struct Traits<IP>::Config<0> //: public Traits<IP>::Default_Config
@@ -0,0 +1,72 @@
+// EPOS IA32 TLB Benchmark Program
+
+// Compares the DTLB pressure of a Segment mapped with 4 KB pages against that of one mapped with 4 MB pages (see
+// Traits<MMU>::large_pages and LARGE_CHUNK). The first is one page short of LARGE_CHUNK and the second is exactly
+// LARGE_CHUNK, so both span the same memory, but far more 4 KB pages than the DTLB can hold. Each pass reads one
+// word of every page, one cache line further into the page than on the previous one, so the accesses spread over
+// the cache sets instead of fighting for a few of them. DTLB misses are counted by the PMU.
+
+#include <utility/ostream.h>
+#include <address_space.h>
+#include <segment.h>
+#include <pmu.h>
+#include <tsc.h>
+
+using namespace EPOS;
+
+const unsigned int SIZE = Traits<MMU>::LARGE_CHUNK;
+const unsigned int PASSES = 16;
+const unsigned int LINE = 64;
+const PMU::Channel CHANNEL = 3; // the first programmable channel (0 to 2 are fixed from PMU version 2 on)
+
+OStream cout;
+Address_Space * self;
+
+int bench(const char * name, unsigned int bytes)
+{
+    Segment * seg = new Segment(bytes);
+    volatile int * data = self->attach(seg);
+    unsigned int pages = bytes / sizeof(MMU::Page);
+    unsigned int accesses = PASSES * pages;
+    int sum = 0;
+
+    // Warm up the caches (and, for 4 KB pages, bring the page tables into them as well)
+    for(unsigned int i = 0; i < pages; i++)
+        sum += data[(i * sizeof(MMU::Page) + (i * LINE) % sizeof(MMU::Page)) / sizeof(int)];
+
+    PMU::config(CHANNEL, PMU::DTLB_MISS);
+    PMU::reset(CHANNEL);
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    for(unsigned int p = 0; p < PASSES; p++)
+        for(unsigned int i = 0; i < pages; i++)
+            sum += data[(i * sizeof(MMU::Page) + (i * LINE) % sizeof(MMU::Page)) / sizeof(int)];
+    TSC::Time_Stamp t1 = TSC::time_stamp();
+    PMU::Count misses = PMU::read(CHANNEL);
+    PMU::stop(CHANNEL);
+
+    // Chunks backed by large pages are physically contiguous, so only they have a physical address
+    cout << "  " << name << ": " << pages << " pages mapped with " << (seg->phy_address() ? "4 MB" : "4 KB") << " pages => "
+         << misses << " DTLB misses in " << accesses << " accesses (" << misses * 1000 / accesses << " per thousand), "
+         << (t1 - t0) / accesses << " cycles per access" << endl;
+
+    self->detach(seg);
+    delete seg;
+
+    return sum;
+}
+
+int main()
+{
+    cout << "TLB Benchmark" << endl;
+
+    self = new Address_Space(MMU::current());
+
+    bench("small", SIZE - sizeof(MMU::Page));
+    bench("large", SIZE);
+
+    delete self;
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
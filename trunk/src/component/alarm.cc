@@ -10,18 +10,21 @@ __BEGIN_SYS
 Alarm_Timer * Alarm::_timer;
 volatile Alarm::Tick Alarm::_elapsed;
 Alarm::Queue Alarm::_request;
+Alarm::Spin Alarm::_lock;
 
 
 // Methods
 Alarm::Alarm(const Microsecond & time, Handler * handler, int times)
-: _time(time), _handler(handler), _times(times), _ticks(ticks(time)), _link(this, _ticks)
+: _time(time), _handler(handler), _times(times), _ticks(ticks(time)), _link(this, 0)
 {
     lock();
 
     db<Alarm>(TRC) << "Alarm(t=" << time << ",tk=" << _ticks << ",h=" << reinterpret_cast<void *>(handler) << ",x=" << times << ") => " << this << endl;
 
     if(_ticks) {
+        _link.rank(elapsed() + _ticks);
         _request.insert(&_link);
+        reprogram();
         unlock();
     } else {
         unlock();
@@ -36,7 +39,7 @@ Alarm::~Alarm()
 
     db<Alarm>(TRC) << "~Alarm(this=" << this << ")" << endl;
 
-    _request.remove(this);
+    _request.remove(&_link);
 
     unlock();
 }
@@ -47,10 +50,12 @@ void Alarm::period(const Microsecond & p)
 
     db<Alarm>(TRC) << "Alarm::period(this=" << this << ",p=" << p << ")" << endl;
 
-    _request.remove(this);
+    _request.remove(&_link);
     _time = p;
     _ticks = ticks(p);
+    _link.rank(elapsed() + _ticks);
     _request.insert(&_link);
+    reprogram();
 
     unlock();
 }
@@ -68,44 +73,58 @@ void Alarm::delay(const Microsecond & time)
 }
 
 
+// Tickless mode: have the timer interrupt when the next alarm is due (must be called with the lock held)
+void Alarm::reprogram()
+{
+    if(tickless)
+        _timer->arm(_request.empty() ? Tick(~0U >> 1) : _request.next() - elapsed());
+}
+
+
 void Alarm::handler(const IC::Interrupt_Id & i)
 {
     lock();
 
-    _elapsed++;
+    if(!tickless)
+        _elapsed++;
+
+    Tick now = elapsed();
 
     if(Traits<Alarm>::visible) {
         Display display;
         int lin, col;
         display.position(&lin, &col);
         display.position(0, 79);
-        display.putc(_elapsed);
+        display.putc(now);
         display.position(lin, col);
     }
 
-    Alarm * alarm = 0;
-
-    if(!_request.empty()) {
-        // Replacing the following "if" by a "while" loop is tempting, but recovering the lock and dispatching the handler is
-        // troublesome if the Alarm gets destroyed in between, like is the case for the idle thread returning to shutdown the machine
-        if(_request.head()->promote() <= 0) { // rank can be negative whenever multiple handlers get created for the same time tick
-            Queue::Element * e = _request.remove();
-            alarm = e->object();
-            if(alarm->_times != INFINITE)
-                alarm->_times--;
-            if(alarm->_times) {
-                e->rank(alarm->_ticks);
-                _request.insert(e);
-            }
+    // All alarms due by now are handled in a single pass. Since the lock is released while each handler
+    // runs, alarms are taken out of the queue one at a time, so those destroyed in between (e.g. by a
+    // thread returning from delay()) are never touched. Periodic alarms are reinserted relative to their
+    // previous deadline, so they do not drift.
+    Queue::Element * e;
+    while((e = _request.expire(now))) {
+        Alarm * alarm = e->object();
+        if(alarm->_times != INFINITE)
+            alarm->_times--;
+        if(alarm->_times) {
+            e->rank(e->rank() + (alarm->_ticks ? alarm->_ticks : 1));
+            _request.insert(e);
         }
-    }
+        Handler * handler = alarm->_handler;
 
-    unlock();
+        unlock();
+
+        db<Alarm>(TRC) << "Alarm::handler(this=" << alarm << ",e=" << now << ",h=" << reinterpret_cast<void*>(handler) << ")" << endl;
+        (*handler)();
 
-    if(alarm) {
-        db<Alarm>(TRC) << "Alarm::handler(this=" << alarm << ",e=" << _elapsed << ",h=" << reinterpret_cast<void*>(alarm->handler) << ")" << endl;
-        (*alarm->_handler)();
+        lock();
     }
+
+    reprogram();
+
+    unlock();
 }
 
 __END_SYS
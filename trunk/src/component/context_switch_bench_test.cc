@@ -0,0 +1,67 @@
+// EPOS Context Switch Benchmark Program
+
+// Measures the cost of a thread switch between two threads of the same task and between threads of different tasks,
+// which also switches address spaces. Each pair of threads yields the CPU to each other ROUNDS times, so the figures
+// include the scheduler and, for different tasks, the reload of CR3 and the TLB refills it causes. The kernel's
+// mappings survive such reloads when they are global (see Traits<MMU>::global_pages). The second task shares the
+// code and data segments of the first, which land at the same addresses in its own address space.
+
+#include <utility/ostream.h>
+#include <thread.h>
+#include <task.h>
+#include <chronometer.h>
+
+using namespace EPOS;
+
+const unsigned int ROUNDS = 10000;
+
+OStream cout;
+
+int ping_pong()
+{
+    for(unsigned int i = 0; i < ROUNDS; i++)
+        Thread::yield();
+
+    return 0;
+}
+
+void report(const char * name, unsigned int elapsed)
+{
+    cout << "  " << name << ": " << 2 * ROUNDS << " switches in " << elapsed << " us => "
+         << elapsed * 1000 / (2 * ROUNDS) << " ns per switch" << endl;
+}
+
+int main()
+{
+    cout << "Context Switch Benchmark" << endl;
+
+    Chronometer chrono;
+    Task * task0 = Task::self();
+
+    // Same task: the threads run only once main blocks on the first join
+    Thread * a = new Thread(&ping_pong);
+    Thread * b = new Thread(&ping_pong);
+    chrono.start();
+    a->join();
+    b->join();
+    chrono.stop();
+    report("same task", chrono.read());
+    delete a;
+    delete b;
+
+    // Different tasks: the main thread of the new task plays the part of b
+    a = new Thread(&ping_pong);
+    Task * task1 = new Task(task0->code_segment(), task0->data_segment(), &ping_pong);
+    chrono.reset();
+    chrono.start();
+    a->join();
+    task1->main()->join();
+    chrono.stop();
+    report("cross task", chrono.read());
+    delete a;
+    delete task1;
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
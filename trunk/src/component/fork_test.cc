@@ -0,0 +1,102 @@
+// EPOS Task Duplication (Copy-on-Write) Test Program
+
+// Duplicates this task and checks that the copies of its code and data segments are private to each task, although
+// they share their frames until written (see MMU::Chunk(const Chunk &)). It then copies segments of a few sizes, checks
+// that writing to the originals leaves the copies untouched, and compares the time taken by a copy with that of
+// copying the contents by hand. Only the interface exported to applications is used (see segment_bench_test for cycles).
+
+#include <utility/ostream.h>
+#include <address_space.h>
+#include <segment.h>
+#include <thread.h>
+#include <task.h>
+#include <chronometer.h>
+
+using namespace EPOS;
+
+const unsigned int SIZES[] = { 64 * 1024, 256 * 1024, 1024 * 1024 };
+const unsigned int PAGE_SIZE = 4096;
+
+OStream cout;
+
+volatile int value = 1;
+
+int child()
+{
+    cout << "  child: value=" << value << " (expected 1)" << endl;
+    value = 2;
+    cout << "  child: value=" << value << " (expected 2)" << endl;
+
+    return value;
+}
+
+bool copy(Address_Space * self, unsigned int bytes)
+{
+    Chronometer chrono;
+
+    Segment * seg = new Segment(bytes);
+    char * data = self->attach(seg);
+    memset(data, 'x', bytes);
+
+    chrono.start();
+    Segment * cow = new Segment(*seg);
+    chrono.stop();
+    unsigned int cow_time = chrono.read();
+
+    Segment * eager = new Segment(bytes);
+    char * contents = self->attach(eager);
+    chrono.reset();
+    chrono.start();
+    memcpy(contents, data, bytes);
+    chrono.stop();
+    unsigned int memcpy_time = chrono.read();
+    self->detach(eager);
+    delete eager;
+
+    // The first write to each page of seg gives it a frame of its own, so cow must keep the original contents
+    for(unsigned int i = 0; i < bytes; i += PAGE_SIZE)
+        data[i] = 'y';
+    char * shared = self->attach(cow);
+    bool ok = true;
+    for(unsigned int i = 0; i < bytes; i += PAGE_SIZE)
+        ok = ok && (shared[i] == 'x') && (data[i] == 'y');
+
+    cout << "  " << bytes / 1024 << " KB: copy-on-write=" << cow_time << " us, memcpy=" << memcpy_time << " us, "
+         << (ok ? "private" : "SHARED!") << endl;
+
+    self->detach(cow);
+    delete cow;
+    self->detach(seg);
+    delete seg;
+
+    return ok;
+}
+
+int main()
+{
+    cout << "Task duplication test" << endl;
+
+    Task * task0 = Task::self();
+
+    cout << "Duplicating this task:" << endl;
+    Task * task1 = new Task(*task0, &child);
+    int status = task1->main()->join();
+    cout << "  parent: value=" << value << " (expected 1), child exited with " << status << " (expected 2)" << endl;
+    Segment * cs1 = task1->code_segment();
+    Segment * ds1 = task1->data_segment();
+    delete task1;
+    delete cs1;
+    delete ds1;
+
+    cout << "Segment copies:" << endl;
+    Address_Space * self = task0->address_space();
+    bool ok = (value == 1) && (status == 2);
+    for(unsigned int i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++)
+        ok = copy(self, SIZES[i]) && ok;
+
+    cout << (ok ? "Passed!" : "Failed!") << endl;
+
+    cout << "I'm done, bye!" << endl;
+
+    return 0;
+}
@@ -16,6 +16,13 @@ unsigned short IP::Header::_next_id = 0;
 IP * IP::_networks[];
 IP::Router IP::_router;
 IP::Reassembling IP::_reassembling;
+IP::Aging IP::_aging;
+Spin IP::_reassembling_lock;
+Semaphore * IP::_sweep_tick;
+Semaphore_Handler * IP::_sweeper_handler;
+Alarm * IP::_sweeper;
+Thread * IP::_sweeper_thread;
+volatile unsigned int IP::_sweeps;
 IP::Observed IP::_observed;
 
 // Methods
@@ -52,18 +59,25 @@ IP::Buffer * IP::alloc(const Address & to, const Protocol & prot, unsigned int o
     db<IP>(TRC) << "IP::alloc(to=" << to << ",prot=" << prot << ",on=" << once<< ",pl=" << payload << ")" << endl;
 
     Route * through = _router.search(to);
-    IP * ip = through->ip();
-    NIC * nic = through->nic();
-
-    MAC_Address mac = through->arp()->resolve((through->gateway() == through->ip()->address()) ? to : through->gateway());
-    if(!mac) {
+    if(!through) {
          db<IP>(WRN) << "IP::alloc: destination host (" << to << ") unreachable!" << endl;
          return 0;
     }
+    IP * ip = through->ip();
+    NIC * nic = through->nic();
+
+    // If the next hop is not resolved yet, the frames go without a destination, which ARP fills in later (see send())
+    MAC_Address mac = through->arp()->lookup(through->next_hop(to));
 
     Buffer * pool = nic->alloc(mac, NIC::IP, once, sizeof(IP::Header), payload);
+    if(!pool)
+        return 0;
+
+    through->_statistics.tx_datagrams++;
+    through->_statistics.tx_bytes += once + payload;
 
     Header header(ip->address(), to, prot, 0); // length will be defined latter for each fragment
+    header.sum(); // and the checksum incrementally updated
 
     unsigned int offset = 0;
     for(Buffer::Element * el = pool->link(); el; el = el->next()) {
@@ -74,7 +88,7 @@ IP::Buffer * IP::alloc(const Address & to, const Protocol & prot, unsigned int o
         packet->flags(el->next() ? Header::MF : 0);
         packet->length(el->object()->size());
         packet->offset(offset);
-        packet->header()->sum();
+        packet->header()->resum(header);
         db<IP>(INF) << "IP::alloc:pkt=" << packet << " => " << *packet << endl;
 
         offset += MFS;
@@ -87,6 +101,18 @@ int IP::send(Buffer * buf)
 {
     db<IP>(TRC) << "IP::send(buf=" << buf << ")" << endl;
 
+    if(!buf->frame()->dst()) { // next hop unresolved at alloc()
+        Address to = buf->frame()->data<Packet>()->to();
+        Route * through = _router.search(to);
+        if(!through) { // the route was removed after alloc()
+            db<IP>(WRN) << "IP::send: destination host (" << to << ") unreachable!" << endl;
+            for(Buffer::Element * el = buf->link(); el; el = el->next()) // gives the transmit buffers back to the NIC
+                el->object()->unlock();
+            return 0;
+        }
+        return through->arp()->send(through->next_hop(to), buf); // parks the pool until the next hop is resolved
+    }
+
     return buf->nic()->send(buf); // implicitly releases the pool
 }
 
@@ -99,8 +125,13 @@ void IP::update(NIC::Observed * obs, NIC::Protocol prot, Buffer * buf)
 
     if((packet->to() != _address) && (packet->to() != _broadcast)) {
         db<IP>(INF) << "IP::update: datagram was not for me!" << endl;
-        if(packet->to() != Address(Address::BROADCAST))
-            db<IP>(WRN) << "IP::update: routing not implemented!" << endl;
+        if(packet->to() != Address(Address::BROADCAST)) {
+            if(forwarding) {
+                forward(buf);
+                return;
+            }
+            db<IP>(WRN) << "IP::update: forwarding is disabled!" << endl;
+        }
         _nic.free(buf);
         return;
     }
@@ -116,73 +147,153 @@ void IP::update(NIC::Observed * obs, NIC::Protocol prot, Buffer * buf)
     // The Ethernet Frame in Buffer might have been padded, so we need to adjust it to the datagram length
     buf->size(packet->length());
 
-    if((packet->flags() & Header::MF) || (packet->offset() != 0)) { // Fragmented
-        Key key = ((packet->from() & ~_netmask) << 16) | packet->id();
-        Reassembling::Element * el = _reassembling.search_key(key);
-
-        Fragmented * frag;
-        if(el)
-            frag = el->object();
-        else {
-            frag = new (SYSTEM) Fragmented(key); // the Alarm created within Fragmented will re-enable interrupts
-            _reassembling.insert(frag->link());
-        }
-        frag->insert(buf);
-
-        if(frag->reassembled()) {
-            db<IP>(INF) << "IP::update: notifying reassembled datagram" << endl;
-            frag->reorder();
-            Buffer * pool = frag->pool();
-            _reassembling.remove(frag->link());
-            delete frag;
-            if(!notify(packet->protocol(), pool))
-                pool->nic()->free(pool);
-        }
-    } else {
+    if((packet->flags() & Header::MF) || (packet->offset() != 0)) // Fragmented
+        reassemble(buf);
+    else {
         db<IP>(INF) << "IP::update: notifying whole datagram" << endl;
         if(!notify(packet->protocol(), buf))
             buf->nic()->free(buf);
     }
 }
 
-void IP::Fragmented::reorder() {
-    db<IP>(TRC) << "IP::Fragmented::reorder(this=" << this << ")" << endl;
+// Fragments are forwarded as they come, since reassembly is up to the destination
+void IP::forward(Buffer * buf)
+{
+    db<IP>(TRC) << "IP::forward(buf=" << buf << ")" << endl;
+
+    Packet * packet = buf->frame()->data<Packet>();
+    unsigned int size = packet->length();
+
+    Route * through = _router.search(packet->to());
+    if(!through) {
+        db<IP>(WRN) << "IP::forward: destination host (" << packet->to() << ") unreachable!" << endl;
+        _nic.free(buf);
+        return;
+    }
+
+    if((packet->ttl() <= 1) || (size > buf->size()) || !packet->check()) {
+        db<IP>(INF) << "IP::forward: dropping expired or malformed datagram " << *packet << endl;
+        through->_statistics.dropped++;
+        _nic.free(buf);
+        return;
+    }
+
+    MAC_Address mac = through->arp()->lookup(through->next_hop(packet->to()));
+    Buffer * out = through->nic()->alloc(mac, NIC::IP, 0, 0, size);
+    if(!out) {
+        through->_statistics.dropped++;
+        _nic.free(buf);
+        return;
+    }
+
+    Packet * copy = out->frame()->data<Packet>();
+    memcpy(copy, packet, size);
+    _nic.free(buf);
+
+    copy->hop();
+
+    db<IP>(INF) << "IP::forward:pkt=" << copy << " => " << *copy << endl;
+
+    through->_statistics.forwarded_datagrams++;
+    through->_statistics.forwarded_bytes += size;
+
+    send(out); // implicitly releases the buffer
+}
+
+void IP::reassemble(Buffer * buf)
+{
+    Packet * packet = buf->frame()->data<Packet>();
+    Key key = ((packet->from() & ~_netmask) << 16) | packet->id();
+
+    db<IP>(TRC) << "IP::reassemble(key=" << hex << key << dec << ",buf=" << buf << ")" << endl;
+
+    // The heap might re-enable interrupts, so it is only used with the reassembly lock released
+    Fragmented * fresh = 0;
+    Fragmented * frag;
+    Spin_Guard<> guard(_reassembling_lock);
+    Reassembling::Element * el = _reassembling.search_key(key);
+    if(!el) {
+        guard.release();
+        fresh = new (SYSTEM) Fragmented(key);
+        guard.acquire();
+        el = _reassembling.search_key(key);
+    }
+    if(el)
+        frag = el->object();
+    else {
+        frag = fresh;
+        fresh = 0;
+        _reassembling.insert(frag->link());
+        _aging.insert(frag->age());
+    }
 
-    if(_list.size() > 1) {
-        Buffer::List tmp;
-        unsigned int i = 0;
-        while(!_list.empty()) {
-            Buffer * buf = _list.remove()->object();
+    bool inserted = frag->insert(buf);
 
-            if((buf->frame()->data<Packet>()->offset() / MFS) == i) {
-                tmp.insert(buf->link());
-                i++;
-            } else
-                _list.insert(buf->link());
-        };
+    Buffer * pool = 0;
+    if(frag->reassembled()) {
+        pool = frag->pool();
+        _reassembling.remove(frag->link());
+        _aging.remove(frag->age());
+    }
 
-        while(!tmp.empty())
-            _list.insert(tmp.remove()->object()->link());
+    guard.release();
+
+    if(fresh) // some other context started the same reassembly meanwhile
+        delete fresh;
+
+    if(!inserted) {
+        db<IP>(INF) << "IP::reassemble: dropping duplicate fragment" << endl;
+        buf->nic()->free(buf);
+    }
+
+    if(pool) {
+        db<IP>(INF) << "IP::reassemble: notifying reassembled datagram" << endl;
+        delete frag;
+        if(!notify(packet->protocol(), pool))
+            pool->nic()->free(pool);
     }
 }
 
-unsigned short IP::checksum(const void * data, unsigned int size)
+int IP::sweeper()
 {
-    db<IP>(TRC) << "IP::checksum(d=" << data << ",s=" << size << ")" << endl;
+    while(true) {
+        _sweep_tick->p();
+        sweep();
+    }
+
+    return 0;
+}
+
+// Runs every TIMEOUT / 2 (see init()), so a reassembly that misses fragments lasts between TIMEOUT and 1.5 * TIMEOUT
+void IP::sweep()
+{
+    Aging expired;
+
+    Spin_Guard<> guard(_reassembling_lock);
+    _sweeps++;
+    while(!_aging.empty() && _aging.head()->object()->expired()) { // queued by age, so the first live one ends the sweep
+        Fragmented * frag = _aging.remove()->object();
+        _reassembling.remove(frag->link());
+        expired.insert(frag->age());
+    }
+    guard.release();
 
-    const unsigned char * ptr = reinterpret_cast<const unsigned char *>(data);
-    unsigned long sum = 0;
+    while(!expired.empty()) {
+        Fragmented * frag = expired.remove()->object();
 
-    for(unsigned int i = 0; i < size; i += 2)
-        sum += (ptr[i] << 8) | ptr[i+1];
+        db<IP>(INF) << "IP::sweep: reassembly timed out after " << frag->_count << " fragments" << endl;
 
-    if(size & 1)
-        sum += ptr[size - 1];
+        Buffer * pool = frag->pool();
+        pool->nic()->free(pool);
+        delete frag;
+    }
+}
 
-    while(sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
+unsigned short IP::checksum(const void * data, unsigned int size)
+{
+    db<IP>(TRC) << "IP::checksum(d=" << data << ",s=" << size << ")" << endl;
 
-    return ~sum;
+    return ntohs(~CPU::csum(data, size));
 }
 
 __END_SYS
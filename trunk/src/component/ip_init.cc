@@ -27,8 +27,8 @@ IP::IP(unsigned int nic)
     _router.insert(&_nic, this, &_arp, _address & _netmask, _address, _netmask);
 
     if(_gateway) {
-        _router.insert(&_nic, this, &_arp, Address::NULL, _gateway, Address::NULL); // Default route must be the last one in table
-        _arp.resolve(_gateway);
+        _router.insert(&_nic, this, &_arp, Address::NULL, _gateway, Address::NULL); // default route
+        _arp.lookup(_gateway); // resolved in the background
     }
 }
 
@@ -37,6 +37,13 @@ void IP::init(unsigned int unit)
     db<Init, IP>(TRC) << "IP::init(u=" << unit << ")" << endl;
 
     _networks[unit] = new (SYSTEM) IP(unit);
+
+    if(!_sweeper) {
+        _sweep_tick = new (SYSTEM) Semaphore(0);
+        _sweeper_handler = new (SYSTEM) Semaphore_Handler(_sweep_tick);
+        _sweeper_thread = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::HIGH), &sweeper);
+        _sweeper = new (SYSTEM) Alarm(TIMEOUT / 2, _sweeper_handler, Alarm::INFINITE);
+    }
 }
 
 __END_SYS
@@ -163,6 +163,86 @@ int udp_test()
     return stat.tx_bytes + stat.rx_bytes;
 }
 
+int udp_zero_copy_test()
+{
+    cout << "UDP Zero-Copy Test" << endl;
+
+    char data[PDU];
+    Link<UDP> * com;
+
+    IP * ip = IP::get_by_nic(0);
+
+    cout << "  IP: " << ip->address() << endl;
+    cout << "  MAC: " << ip->nic()->address() << endl;
+
+    if(ip->address()[3] % 2) { // sender
+        cout << "Sender:" << endl;
+
+        IP::Address peer_ip = ip->address();
+        peer_ip[3]--;
+
+        com = new Link<UDP>(8001, Link<UDP>::Address(peer_ip, UDP::Port(8001)));
+
+        UDP::Buffer * pool = com->alloc(sizeof(UDP::Data) + 1);
+        if(pool) {
+            cout << "  An oversized datagram was not rejected!" << endl;
+            com->send(pool);
+        } else
+            cout << "  Oversized datagram rejected" << endl;
+
+        for(int i = 0; i < ITERATIONS; i++) {
+            // The datagram is written right into the NIC's buffers (a real application would serialize its message there)
+            pool = com->alloc(sizeof(data));
+            if(!pool) {
+                cout << "  No buffers for a " << sizeof(data) << " bytes long datagram!" << endl;
+                continue;
+            }
+
+            unsigned int contiguous;
+            for(unsigned int offset = 0; offset < sizeof(data); offset += contiguous) {
+                char * fragment = reinterpret_cast<char *>(UDP::payload(pool, offset, &contiguous));
+                for(unsigned int j = 0; j < contiguous; j++)
+                    fragment[j] = '0' + i + ((offset + j) % 10);
+            }
+            char * last = reinterpret_cast<char *>(UDP::payload(pool, sizeof(data) - 2));
+            last[0] = '\n';
+            last[1] = 0;
+
+            int sent = com->send(pool); // the buffers go back to the NIC, so pool must not be touched anymore
+            if(sent == sizeof(data))
+                cout << "  Data: " << sent << " bytes written in place" << endl;
+            else
+                cout << "  Data was not correctly sent. It was " << sizeof(data) << " bytes long, but only " << sent << " bytes were sent!"<< endl;
+        }
+    } else { // receiver
+        cout << "Receiver:" << endl;
+
+        IP::Address peer_ip = ip->address();
+        peer_ip[3]++;
+
+        com = new Link<UDP>(8001, Link<UDP>::Address(peer_ip, UDP::Port(8001)));
+
+        for(int i = 0; i < ITERATIONS; i++) {
+            int received = com->receive(&data, sizeof(data));
+            if(received == sizeof(data))
+                cout << "  Data: " << data << endl;
+            else
+                cout << "  Data was not correctly received. It was " << sizeof(data) << " bytes long, but " << received << " bytes were received!"<< endl;
+        }
+    }
+
+    delete com;
+
+    NIC::Statistics stat = ip->nic()->statistics();
+    cout << "Statistics\n"
+         << "Tx Packets: " << stat.tx_packets << "\n"
+         << "Tx Bytes:   " << stat.tx_bytes << "\n"
+         << "Rx Packets: " << stat.rx_packets << "\n"
+         << "Rx Bytes:   " << stat.rx_bytes << endl;
+
+    return stat.tx_bytes + stat.rx_bytes;
+}
+
 int tcp_test()
 {
     cout << "TCP Test" << endl;
@@ -262,6 +342,8 @@ int main()
     Alarm::delay(2000000);
     udp_test();
     Alarm::delay(2000000);
+    udp_zero_copy_test();
+    Alarm::delay(2000000);
     tcp_test();
 
     return 0;
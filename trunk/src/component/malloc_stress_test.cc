@@ -0,0 +1,86 @@
+// EPOS Multicore Memory Allocation Stress Test Program
+
+// Each CPU runs a worker that keeps a window of live blocks of varied sizes, replacing
+// them round-robin. Most sizes fall in the heap's size classes (and thus in the per-CPU
+// caches), while a few are large enough to go straight to the shared heap. Every block
+// is filled with its owner's tag and checked before being freed.
+
+#include <utility/ostream.h>
+#include <utility/malloc.h>
+#include <machine.h>
+#include <tsc.h>
+#include <thread.h>
+
+using namespace EPOS;
+
+const int iterations = 100000;
+const int window = 64;
+const unsigned int sizes[] = {8, 16, 24, 40, 64, 100, 128, 250, 512, 1000, 3000};
+const unsigned int kinds = sizeof(sizes) / sizeof(unsigned int);
+
+OStream cout;
+
+Thread * worker[Traits<Build>::CPUS];
+TSC::Time_Stamp cycles[Traits<Build>::CPUS];
+unsigned int errors[Traits<Build>::CPUS];
+
+int work(int n)
+{
+    char * block[window];
+    unsigned int size[window];
+    for(int i = 0; i < window; i++)
+        block[i] = 0;
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+
+    for(int i = 0; i < iterations; i++) {
+        int w = i % window;
+        if(block[w]) {
+            if((block[w][0] != n) || (block[w][size[w] - 1] != n))
+                errors[n]++;
+            free(block[w]);
+        }
+
+        size[w] = sizes[(i * 7 + n) % kinds];
+        block[w] = reinterpret_cast<char *>(malloc(size[w]));
+        if(!block[w]) {
+            errors[n]++;
+            continue;
+        }
+        block[w][0] = block[w][size[w] - 1] = n;
+    }
+
+    cycles[n] = TSC::time_stamp() - t0;
+
+    for(int i = 0; i < window; i++)
+        if(block[i])
+            free(block[i]);
+
+    return iterations;
+}
+
+int main()
+{
+    cout << "Multicore memory allocation stress test" << endl;
+    cout << "Running " << iterations << " malloc/free pairs on each of " << Machine::n_cpus() << " CPUs" << endl;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        worker[i] = new Thread(Thread::Configuration(Thread::READY, Thread::Criterion(Thread::NORMAL, i)), &work, int(i));
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        worker[i]->join();
+
+        cout << "CPU " << i << ": " << cycles[i] / iterations << " cycles/malloc+free, "
+             << TSC::Time_Stamp(iterations) * TSC::frequency() / cycles[i] << " allocations/s";
+        if(errors[i])
+            cout << ", " << errors[i] << " corrupted or failed allocations!";
+        cout << endl;
+    }
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        delete worker[i];
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
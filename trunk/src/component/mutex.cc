@@ -4,7 +4,7 @@
 
 __BEGIN_SYS
 
-Mutex::Mutex(): _locked(false)
+Mutex::Mutex(int c): _locked(UNLOCKED), _owner(0), _ceiling(c), _link(this)
 {
     db<Synchronizer>(TRC) << "Mutex() => " << this << endl;
 }
@@ -13,6 +13,13 @@ Mutex::Mutex(): _locked(false)
 Mutex::~Mutex()
 {
     db<Synchronizer>(TRC) << "~Mutex(this=" << this << ")" << endl;
+
+    if(protocol) {
+        begin_atomic();
+        if(_owner)
+            _owner->_mutexes.remove(&_link);
+        end_atomic();
+    }
 }
 
 
@@ -20,11 +27,34 @@ void Mutex::lock()
 {
     db<Synchronizer>(TRC) << "Mutex::lock(this=" << this << ")" << endl;
 
+    if(!protocol && ((cas(_locked, UNLOCKED, LOCKED) == UNLOCKED) || spin())) {
+        _owner = Thread::running();
+        return;
+    }
+
     begin_atomic();
-    if(tsl(_locked))
+    int state;
+    while(((state = _locked) != CONTENDED) && (cas(_locked, state, CONTENDED) != state));
+    if(state != UNLOCKED) {
+        if(inheritance) {
+            // Boost the owner and, on non-SMP configurations, whoever is holding it back
+            Thread * running = Thread::running();
+            int p = running->priority();
+            running->_blocker = this;
+            for(Thread * owner = _owner; owner && (p < int(owner->priority())); owner = owner->_blocker ? owner->_blocker->_owner : 0) {
+                owner->inherit(p);
+                if(smp)
+                    break;
+            }
+        }
         sleep(); // implicit end_atomic()
-    else
+    } else {
+        if(protocol)
+            acquired(Thread::running());
+        else
+            _owner = Thread::running();
         end_atomic();
+    }
 }
 
 
@@ -32,12 +62,85 @@ void Mutex::unlock()
 {
     db<Synchronizer>(TRC) << "Mutex::unlock(this=" << this << ")" << endl;
 
+    if(!protocol) {
+        Thread * owner = _owner;
+        _owner = 0;
+        if(cas(_locked, LOCKED, UNLOCKED) == LOCKED)
+            return;
+        _owner = owner;
+    }
+
     begin_atomic();
+    bool dropped = false;
+    if(protocol && _owner) {
+        int p = _owner->priority();
+        released();
+        dropped = (int(_owner->priority()) > p);
+    }
+    _owner = 0;
+
     if(_queue.empty()) {
-        _locked = false;
-        end_atomic();
-    } else
+        _locked = UNLOCKED;
+        if(Thread::preemptive && dropped) {
+            // Threads that were kept from preempting the owner by its former priority might now take over
+            if(smp)
+                _lock.release();
+            Thread::acquire(Thread::current_queue());
+            Thread::reschedule();
+        } else
+            end_atomic();
+    } else {
+        // Hand the mutex over to the thread that will be woken up (it stays CONTENDED, since there might be others)
+        if(protocol)
+            acquired(_queue.head()->object());
+        else
+            _owner = _queue.head()->object();
         wakeup(); // implicit end_atomic()
+    }
+}
+
+
+// Spins while the owner is running on another CPU, trying to get the mutex before resorting to blocking
+bool Mutex::spin()
+{
+    for(unsigned int i = 0; i < SPINS; i++) {
+        Thread * owner = _owner;
+        if((_locked == UNLOCKED) && (cas(_locked, UNLOCKED, LOCKED) == UNLOCKED))
+            return true;
+        if((_locked == CONTENDED) || (owner && (owner->state() != Thread::RUNNING)))
+            break;
+    }
+
+    return false;
+}
+
+
+// Makes "owner" the owner of the mutex, imposing on it the ceiling if under CEILING (guard must be held)
+void Mutex::acquired(Thread * owner)
+{
+    if(owner->_mutexes.empty())
+        owner->_natural_priority = owner->priority();
+    owner->_mutexes.insert(&_link);
+    owner->_blocker = 0;
+    _owner = owner;
+
+    if(ceiling && (_ceiling < int(owner->priority())))
+        owner->inherit(_ceiling);
+}
+
+
+// Releases the mutex from its owner, whose priority goes back to the highest of its natural one and
+// those imposed by the mutexes it still holds (guard must be held)
+void Mutex::released()
+{
+    _owner->_mutexes.remove(&_link);
+
+    int p = _owner->_natural_priority;
+    for(List<Mutex>::Iterator i = _owner->_mutexes.begin(); i != _owner->_mutexes.end(); i++)
+        if(i->object()->priority() < p)
+            p = i->object()->priority();
+
+    _owner->inherit(p);
 }
 
 __END_SYS
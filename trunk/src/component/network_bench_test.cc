@@ -0,0 +1,275 @@
+// EPOS Network Benchmark Program
+
+// Measures the network stack over the in-memory Loopback NIC (see Traits<NIC>::NICS in the test's traits), so the
+// figures depend on the software alone and can be compared across runs, hosts and changes to the stack. For raw
+// Ethernet, UDP and TCP it reports the throughput of a one-way stream (messages/s and bytes/s) and the round-trip
+// latency of a ping-pong exchange (percentiles over SAMPLES round trips). A single Loopback unit loops frames back
+// to the node itself (10.0.1.1), so the receiving side of each benchmark runs in a thread of its own.
+
+#include <utility/ostream.h>
+#include <communicator.h>
+#include <semaphore.h>
+#include <thread.h>
+#include <tsc.h>
+
+using namespace EPOS;
+
+const unsigned int MESSAGES = 10000;    // per stream
+const unsigned int SIZE = 1000;         // bytes per streamed message (a single frame for raw Ethernet and UDP)
+const unsigned int SAMPLES = 1000;      // round trips per latency measurement
+const unsigned int PING = 64;           // bytes per ping and pong
+
+const NIC::Protocol PROT_PING = 0x88b5; // IEEE 802 local experimental EtherTypes
+const NIC::Protocol PROT_PONG = 0x88b6;
+
+const unsigned short SINK = 8000;       // UDP and TCP ports
+const unsigned short SOURCE = 8001;
+
+OStream cout;
+
+IP * ip;
+char data[SIZE];
+TSC::Time_Stamp samples[SAMPLES];
+
+// Shared between each benchmark and its receiving side
+volatile unsigned int received;
+volatile bool done;
+TSC::Time_Stamp finish;
+Semaphore * ready;
+
+
+TSC::Time_Stamp us(const TSC::Time_Stamp & ts) { return ts * 1000000 / TSC::frequency(); }
+
+void throughput(const char * name, const TSC::Time_Stamp & elapsed, unsigned int messages)
+{
+    cout << "  " << name << " stream:  " << messages << " x " << SIZE << " bytes in " << us(elapsed) << " us => "
+         << (elapsed ? TSC::Time_Stamp(messages) * TSC::frequency() / elapsed : 0) << " msgs/s, "
+         << (elapsed ? TSC::Time_Stamp(messages) * SIZE * TSC::frequency() / elapsed : 0) << " bytes/s" << endl;
+}
+
+void latency(const char * name)
+{
+    // Insertion sort is fine for a thousand samples, which arrive mostly in order anyway
+    for(unsigned int i = 1; i < SAMPLES; i++) {
+        TSC::Time_Stamp s = samples[i];
+        unsigned int j = i;
+        for(; j && (samples[j - 1] > s); j--)
+            samples[j] = samples[j - 1];
+        samples[j] = s;
+    }
+
+    cout << "  " << name << " round trip (" << PING << " bytes):  p50=" << us(samples[SAMPLES / 2]) << " us, p90=" << us(samples[SAMPLES * 90 / 100])
+         << " us, p99=" << us(samples[SAMPLES * 99 / 100]) << " us, max=" << us(samples[SAMPLES - 1]) << " us" << endl;
+}
+
+
+// Raw Ethernet: the observers run in the NIC's receiver thread
+class Sink: public NIC::Observer
+{
+public:
+    void update(NIC::Observed * obs, NIC::Protocol prot, NIC::Buffer * buf) {
+        finish = TSC::time_stamp();
+        received++;
+        ip->nic()->free(buf);
+    }
+};
+
+class Reflector: public NIC::Observer
+{
+public:
+    void update(NIC::Observed * obs, NIC::Protocol prot, NIC::Buffer * buf) {
+        NIC::Frame * frame = buf->frame();
+        if(prot == PROT_PING)
+            ip->nic()->send(frame->src(), PROT_PONG, frame->data<void>(), buf->size());
+        else
+            ready->v();
+        ip->nic()->free(buf);
+    }
+};
+
+void ethernet_bench()
+{
+    NIC * nic = ip->nic();
+    const NIC::Statistics & stat = nic->statistics();
+
+    Sink sink;
+    nic->attach(&sink, PROT_PING);
+
+    // Frames dropped for the lack of buffers are accounted as overruns, so waiting for them would never end
+    received = 0;
+    unsigned int overruns = stat.rx_overruns;
+    TSC::Time_Stamp start = TSC::time_stamp();
+    for(unsigned int i = 0; i < MESSAGES; i++)
+        nic->send(nic->address(), PROT_PING, data, SIZE);
+    while(received + stat.rx_overruns - overruns < MESSAGES)
+        Thread::yield();
+    throughput("Ethernet", finish - start, received);
+
+    nic->detach(&sink, PROT_PING);
+
+    Reflector reflector;
+    nic->attach(&reflector, PROT_PING);
+    nic->attach(&reflector, PROT_PONG);
+
+    for(unsigned int i = 0; i < SAMPLES; i++) {
+        TSC::Time_Stamp t0 = TSC::time_stamp();
+        nic->send(nic->address(), PROT_PING, data, PING);
+        ready->p();
+        samples[i] = TSC::time_stamp() - t0;
+    }
+    latency("Ethernet");
+
+    nic->detach(&reflector, PROT_PONG);
+    nic->detach(&reflector, PROT_PING);
+}
+
+
+// UDP
+int udp_sink()
+{
+    Link<UDP> com(SINK, Link<UDP>::Address(ip->address(), UDP::Port(SOURCE)));
+    char buf[SIZE];
+
+    // A shorter datagram marks the end of the stream
+    ready->v();
+    while(com.receive(buf, SIZE) == int(SIZE)) {
+        finish = TSC::time_stamp();
+        received++;
+    }
+    done = true;
+
+    return received;
+}
+
+int udp_reflector()
+{
+    Link<UDP> com(SINK, Link<UDP>::Address(ip->address(), UDP::Port(SOURCE)));
+    char buf[PING];
+
+    ready->v();
+    for(unsigned int i = 0; i < SAMPLES; ) {
+        int size = com.receive(buf, PING);
+        if(size != int(PING)) // a surplus end-of-stream marker
+            continue;
+        com.send(buf, size);
+        i++;
+    }
+
+    return SAMPLES;
+}
+
+void udp_bench()
+{
+    Link<UDP> com(SOURCE, Link<UDP>::Address(ip->address(), UDP::Port(SINK)));
+
+    // The first datagram waits for ARP to learn the node's own address, so it is sent before the clock starts
+    received = 0;
+    done = false;
+    Thread * sink = new Thread(&udp_sink);
+    ready->p();
+    com.send(data, SIZE);
+    TSC::Time_Stamp start = TSC::time_stamp();
+    for(unsigned int i = 1; i < MESSAGES; i++)
+        com.send(data, SIZE);
+
+    // The end-of-stream marker might be dropped too (e.g. if the Loopback's queue is full), so it is repeated until
+    // the sink gets one
+    while(!done) {
+        com.send(data, 1);
+        Thread::yield();
+    }
+    sink->join();
+    throughput("UDP", finish - start, received - 1);
+    delete sink;
+
+    Thread * reflector = new Thread(&udp_reflector);
+    ready->p();
+    for(unsigned int i = 0; i < SAMPLES; i++) {
+        TSC::Time_Stamp t0 = TSC::time_stamp();
+        com.send(data, PING);
+        com.receive(data, PING);
+        samples[i] = TSC::time_stamp() - t0;
+    }
+    latency("UDP");
+    reflector->join();
+    delete reflector;
+}
+
+
+// TCP
+int tcp_sink()
+{
+    Link<TCP> com((TCP::Port(SINK))); // listen
+    char buf[SIZE];
+
+    for(unsigned int i = 0; i < MESSAGES; i++)
+        com.read(buf, SIZE);
+    finish = TSC::time_stamp();
+    ready->v();
+
+    for(unsigned int i = 0; i < SAMPLES; i++) {
+        com.read(buf, PING);
+        com.write(buf, PING);
+    }
+
+    return MESSAGES;
+}
+
+void tcp_bench()
+{
+    Thread * sink = new Thread(&tcp_sink);
+
+    Link<TCP> com(SOURCE, Link<TCP>::Address(ip->address(), TCP::Port(SINK))); // connect
+
+    TSC::Time_Stamp start = TSC::time_stamp();
+    for(unsigned int i = 0; i < MESSAGES; i++)
+        com.write(data, SIZE);
+
+    // The pings only go out once the stream has been consumed, so they do not wait behind it
+    ready->p();
+    for(unsigned int i = 0; i < SAMPLES; i++) {
+        TSC::Time_Stamp t0 = TSC::time_stamp();
+        com.write(data, PING);
+        com.read(data, PING);
+        samples[i] = TSC::time_stamp() - t0;
+    }
+    throughput("TCP", finish - start, MESSAGES);
+    latency("TCP");
+
+    sink->join();
+    delete sink;
+}
+
+
+int main()
+{
+    cout << "Network Benchmark" << endl;
+
+    ip = IP::get_by_nic(0);
+    ready = new Semaphore(0);
+
+    for(unsigned int i = 0; i < SIZE; i++)
+        data[i] = i;
+
+    cout << "  IP: " << ip->address() << endl;
+    cout << "  MAC: " << ip->nic()->address() << endl;
+    cout << "  TSC: " << TSC::frequency() << " Hz" << endl;
+
+    ethernet_bench();
+    udp_bench();
+    tcp_bench();
+
+    NIC::Statistics stat = ip->nic()->statistics();
+    cout << "Statistics\n"
+         << "Tx Packets: " << stat.tx_packets << "\n"
+         << "Tx Bytes:   " << stat.tx_bytes << "\n"
+         << "Rx Packets: " << stat.rx_packets << "\n"
+         << "Rx Bytes:   " << stat.rx_bytes << "\n"
+         << "Overruns:   " << stat.rx_overruns << endl;
+
+    delete ready;
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
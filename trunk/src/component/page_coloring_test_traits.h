@@ -51,11 +51,17 @@ template<> struct Traits<Lists>: public Traits<void>
 template<> struct Traits<Spin>: public Traits<void>
 {
     static const bool debugged = hysterically_debugged;
+
+    // Spin lock algorithm used system-wide (TAS: test-and-test-and-set; TICKET and MCS: FIFO handover)
+    enum {TAS, TICKET, MCS};
+    static const unsigned int ALGORITHM = TAS;
 };
 
 template<> struct Traits<Heaps>: public Traits<void>
 {
     static const bool debugged = hysterically_debugged;
+
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM; // for the kernel heap lock
 };
 
 
@@ -101,6 +107,9 @@ template<> struct Traits<MMU>: public Traits<void>
 {
     static const bool colorful = true;
     static const unsigned int COLORS = 8;
+    static const bool large_pages = true;   // use 4 MB pages for the physical memory map and large Segments (if the CPU has PSE)
+    static const unsigned int LARGE_CHUNK = 16 * 1024 * 1024; // smallest Segment mapped with 4 MB pages
+    static const bool global_pages = true;  // keep the kernel's mappings in the TLB across address space switches (if the CPU has PGE)
 };
 
 template<> struct Traits<FPU>: public Traits<void>
@@ -181,6 +190,11 @@ template<> struct Traits<Timer>: public Traits<Machine_Common>
     // 10000 Hz. The choice must respect the scheduler time-slice, i. e.,
     // it must be higher than the scheduler invocation frequency.
     static const int FREQUENCY = 1000; // Hz
+
+    // In tickless mode, the timer is programmed in one-shot mode for the next
+    // expiration among its channels (e.g. the next Alarm) instead of
+    // interrupting at every tick. It is only available on single-core systems.
+    static const bool tickless = false;
 };
 
 template<> struct Traits<RTC>: public Traits<Machine_Common>
@@ -247,6 +261,9 @@ template<> struct Traits<PCNet32>: public Traits<NIC>
     static const unsigned int RECEIVE_BUFFERS = 256; // per unit
 
     static const bool promiscuous = false;
+
+    static const bool deferred = true; // receive frames in a high-priority thread instead of in the interrupt handler
+    static const unsigned int BUDGET = 64; // frames handled per polling round of the receiving thread
 };
 
 template<> struct Traits<E100>: public Traits<NIC>
@@ -256,6 +273,9 @@ template<> struct Traits<E100>: public Traits<NIC>
     static const unsigned int RECEIVE_BUFFERS = 64; // per unit
 
     static const bool promiscuous = false;
+
+    static const bool deferred = true; // receive frames in a high-priority thread instead of in the interrupt handler
+    static const unsigned int BUDGET = 64; // frames handled per polling round of the receiving thread
 };
 
 template<> struct Traits<C905>: public Traits<NIC>
@@ -267,6 +287,14 @@ template<> struct Traits<C905>: public Traits<NIC>
     static const bool promiscuous = false;
 };
 
+template<> struct Traits<Loopback>: public Traits<NIC>
+{
+    static const unsigned int UNITS = NICS::Count<Loopback>::Result;
+    static const unsigned int BUFFERS = 64; // per unit, shared by sending and receiving
+
+    static const bool promiscuous = false;
+};
+
 template<> struct Traits<FPGA>: public Traits<Machine_Common>
 {
     static const bool enabled = false;
@@ -308,9 +336,11 @@ template<> struct Traits<Task>: public Traits<void>
 template<> struct Traits<Thread>: public Traits<void>
 {
     static const bool smp = Traits<System>::multicore;
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM; // for scheduling queue and synchronizer locks
 
     typedef Scheduling_Criteria::PEDF Criterion;
     static const unsigned int QUANTUM = 10000; // us
+    static const bool indexed_queues = false; // bitmap-indexed (static) or heap-ordered (dynamic) scheduling queues
 
     static const bool trace_idle = hysterically_debugged;
 };
@@ -338,11 +368,25 @@ template<> struct Traits<Segment>: public Traits<void>
 template<> struct Traits<Alarm>: public Traits<void>
 {
     static const bool visible = hysterically_debugged;
+    static const unsigned int SPIN = Traits<Spin>::ALGORITHM;
 };
 
 template<> struct Traits<Synchronizer>: public Traits<void>
 {
     static const bool enabled = Traits<System>::multithread;
+
+    // Contended synchronizers are spun on for up to SPINS iterations (while their owners run on other CPUs)
+    // before blocking the calling thread (SMP only)
+    static const unsigned int SPINS = 1000;
+};
+
+template<> struct Traits<Mutex>: public Traits<Synchronizer>
+{
+    // Real-time locking protocol (to bound priority inversion)
+    // INHERITANCE: the owner inherits the priority of the highest-priority thread waiting for the mutex
+    // CEILING: the owner runs at the mutex's priority ceiling while holding it (immediate priority ceiling)
+    enum {NONE, INHERITANCE, CEILING};
+    static const unsigned int PROTOCOL = NONE;
 };
 
 template<> struct Traits<Network>: public Traits<void>
@@ -390,6 +434,8 @@ template<> struct Traits<IP>: public Traits<Network>
     struct Config: public Default_Config {};
 
     static const unsigned int TTL  = 0x40; // Time-to-live
+
+    static const bool forwarding = false; // forward datagrams addressed to other nodes through the routing table
 };
 
 template<> struct Traits<IP>::Config<0> //: public Traits<IP>::Default_Config
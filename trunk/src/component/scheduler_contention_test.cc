@@ -0,0 +1,68 @@
+// EPOS Scheduler Lock Contention Test Program
+
+// Each CPU runs a worker that repeatedly operates on its own semaphore and yields.
+// Since workers share nothing but the kernel, the rate each CPU sustains depends only
+// on how much the scheduler and synchronizer locks serialize them.
+
+#include <utility/ostream.h>
+#include <machine.h>
+#include <tsc.h>
+#include <thread.h>
+#include <semaphore.h>
+
+using namespace EPOS;
+
+const int iterations = 100000;
+
+OStream cout;
+
+Thread * worker[Traits<Build>::CPUS];
+Semaphore * sem[Traits<Build>::CPUS];
+TSC::Time_Stamp cycles[Traits<Build>::CPUS];
+
+int work(int n)
+{
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+
+    for(int i = 0; i < iterations; i++) {
+        sem[n]->p();
+        sem[n]->v();
+        Thread::yield();
+    }
+
+    cycles[n] = TSC::time_stamp() - t0;
+
+    return iterations;
+}
+
+int main()
+{
+    cout << "Scheduler lock contention test" << endl;
+    cout << "Running " << iterations << " p/v/yield rounds on each of " << Machine::n_cpus() << " CPUs" << endl;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        sem[i] = new Semaphore;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        worker[i] = new Thread(Thread::Configuration(Thread::READY, Thread::Criterion(Thread::NORMAL, i)), &work, int(i));
+
+    unsigned long long total = 0;
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        worker[i]->join();
+
+        unsigned long long rate = static_cast<unsigned long long>(iterations) * TSC::frequency() / cycles[i];
+        total += rate;
+        cout << "CPU " << i << ": " << cycles[i] / iterations << " cycles/round, " << rate << " rounds/s" << endl;
+    }
+
+    cout << "Aggregate: " << total << " rounds/s" << endl;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        delete worker[i];
+        delete sem[i];
+    }
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
@@ -0,0 +1 @@
+scheduler_pip_test.cc
\ No newline at end of file
@@ -0,0 +1,115 @@
+// EPOS Real-time Locking Protocols Test Program
+
+#include <utility/ostream.h>
+#include <periodic_thread.h>
+#include <mutex.h>
+#include <alarm.h>
+#include <chronometer.h>
+
+using namespace EPOS;
+
+const unsigned int iterations = 10;
+const unsigned int period_h = 100; // ms
+const unsigned int period_m = 200; // ms
+const unsigned int period_l = 400; // ms
+const unsigned int offset_h = 10; // ms
+const unsigned int offset_m = 20; // ms
+const unsigned int wcet_h = 5; // ms
+const unsigned int wcet_m = 60; // ms
+const unsigned int critical_l = 40; // ms
+
+int func_h();
+int func_m();
+int func_l();
+
+OStream cout;
+Chronometer chrono;
+Mutex resource(period_h * 1000); // the ceiling is the priority of H (i.e. its period) under RM
+Periodic_Thread * thread_h;
+Periodic_Thread * thread_m;
+Periodic_Thread * thread_l;
+
+Chronometer::Microsecond worst_blocking;
+
+inline void exec(unsigned int time) // in miliseconds
+{
+    // Delay was not used here to prevent scheduling interference due to blocking
+    for(Chronometer::Microsecond end = chrono.read() / 1000 + time; end > chrono.read() / 1000;);
+}
+
+int main()
+{
+    cout << "Real-time Locking Protocols Test" << endl;
+
+    cout << "\nThis test consists in creating three periodic threads, with RM priorities, as follows:" << endl;
+    cout << "- Every " << period_l << "ms, thread L locks a mutex and holds it for " << critical_l << "ms;" << endl;
+    cout << "- Every " << period_m << "ms, thread M sleeps for " << offset_m << "ms and then runs for " << wcet_m << "ms;" << endl;
+    cout << "- Every " << period_h << "ms, thread H sleeps for " << offset_h << "ms and then locks the mutex for " << wcet_h << "ms." << endl;
+    cout << "Without a real-time locking protocol, M preempts L while H is blocked (priority inversion)," << endl;
+    cout << "so H's blocking time is only bounded by L's critical section under INHERITANCE and CEILING." << endl;
+
+    cout << "\nThe mutex protocol is " << ((Traits<Mutex>::PROTOCOL == Traits<Mutex>::INHERITANCE) ? "INHERITANCE" : (Traits<Mutex>::PROTOCOL == Traits<Mutex>::CEILING) ? "CEILING" : "NONE") << "." << endl;
+    cout << "Threads will now be created and I'll wait for them to finish..." << endl;
+
+    chrono.start();
+
+    thread_h = new Periodic_Thread(RTConf(period_h * 1000, iterations * period_l / period_h), &func_h);
+    thread_m = new Periodic_Thread(RTConf(period_m * 1000, iterations * period_l / period_m), &func_m);
+    thread_l = new Periodic_Thread(RTConf(period_l * 1000, iterations), &func_l);
+
+    thread_h->join();
+    thread_m->join();
+    thread_l->join();
+
+    chrono.stop();
+
+    cout << "\n... done!" << endl;
+    cout << "\nThe worst-case blocking time of H was " << worst_blocking / 1000 << " ms (L's critical section takes " << critical_l << " ms)." << endl;
+
+    cout << "I'm also done, bye!" << endl;
+
+    return 0;
+}
+
+int func_h()
+{
+    do {
+        Chronometer::Microsecond release = chrono.read();
+
+        Delay offset(offset_h * 1000);
+
+        resource.lock();
+        Chronometer::Microsecond blocking = chrono.read() - release - offset_h * 1000;
+        exec(wcet_h);
+        resource.unlock();
+
+        if(blocking > worst_blocking)
+            worst_blocking = blocking;
+        cout << "H: blocked for " << blocking / 1000 << " ms [p(H)=" << thread_h->priority()
+             << ", p(M)=" << thread_m->priority() << ", p(L)=" << thread_l->priority() << "]" << endl;
+    } while (Periodic_Thread::wait_next());
+
+    return 'H';
+}
+
+int func_m()
+{
+    do {
+        Delay offset(offset_m * 1000);
+
+        exec(wcet_m);
+    } while (Periodic_Thread::wait_next());
+
+    return 'M';
+}
+
+int func_l()
+{
+    do {
+        resource.lock();
+        exec(critical_l);
+        resource.unlock();
+    } while (Periodic_Thread::wait_next());
+
+    return 'L';
+}
@@ -19,6 +19,13 @@ Segment::Segment(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & fl
 }
 
 
+Segment::Segment(const Segment & seg): Chunk(seg)
+// The copy shares the frames of seg copy-on-write, whenever the MMU supports it
+{
+    db<Segment>(TRC) << "Segment(seg=" << &seg << ") [Chunk::_pt=" << Chunk::pt() << "] => " << this << endl;
+}
+
+
 Segment::~Segment()
 {
     db<Segment>(TRC) << "~Segment() [Chunk::_pt=" << Chunk::pt() << "]" << endl;
@@ -0,0 +1,73 @@
+// EPOS Copy-on-Write and Demand-Zero Segment Benchmark Program
+
+// Compares the cost of copying a segment copy-on-write (see MMU::Chunk(const Chunk &)) with that of copying its
+// contents, and that of creating a demand-zero segment with that of creating a regular one, for a few sizes.
+// Copy-on-write copies and demand-zero segments only cost their page tables, until their pages are touched.
+// It reads the TSC and the MMU directly, so it is built in BUILTIN mode (see fork_test for the exported interface).
+
+#include <utility/ostream.h>
+#include <address_space.h>
+#include <segment.h>
+#include <tsc.h>
+
+using namespace EPOS;
+
+const unsigned int SIZES[] = { 64 * 1024, 256 * 1024, 1024 * 1024 };
+
+OStream cout;
+
+void bench(Address_Space * self, unsigned int bytes)
+{
+    Segment * seg = new Segment(bytes);
+    char * data = self->attach(seg);
+    memset(data, 'x', bytes);
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    Segment * cow = new Segment(*seg);
+    TSC::Time_Stamp t1 = TSC::time_stamp();
+
+    Segment * eager = new Segment(bytes);
+    char * copy = self->attach(eager);
+    TSC::Time_Stamp t2 = TSC::time_stamp();
+    memcpy(copy, data, bytes);
+    TSC::Time_Stamp t3 = TSC::time_stamp();
+
+    // The first write to each page of seg now copies it (cow still shares the original frame)
+    TSC::Time_Stamp t4 = TSC::time_stamp();
+    for(unsigned int i = 0; i < bytes; i += sizeof(MMU::Page))
+        data[i] = 'y';
+    TSC::Time_Stamp t5 = TSC::time_stamp();
+
+    self->detach(eager);
+    delete eager;
+
+    TSC::Time_Stamp t6 = TSC::time_stamp();
+    Segment * dz = new Segment(bytes, WHITE, Segment::Flags::APP | Segment::Flags::DZ);
+    TSC::Time_Stamp t7 = TSC::time_stamp();
+    Segment * regular = new Segment(bytes);
+    TSC::Time_Stamp t8 = TSC::time_stamp();
+
+    cout << "  " << bytes / 1024 << " KB: copy-on-write=" << t1 - t0 << " cycles, memcpy=" << t3 - t2
+         << " cycles, faults=" << (t5 - t4) / (bytes / sizeof(MMU::Page)) << " cycles per page, demand-zero=" << t7 - t6
+         << " cycles, regular=" << t8 - t7 << " cycles" << endl;
+
+    delete regular;
+    delete dz;
+    delete cow;
+    self->detach(seg);
+    delete seg;
+}
+
+int main()
+{
+    cout << "Segment copy and creation benchmark" << endl;
+
+    Address_Space * self = new Address_Space(MMU::current());
+    for(unsigned int i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++)
+        bench(self, SIZES[i]);
+    delete self;
+
+    cout << "I'm done, bye!" << endl;
+
+    return 0;
+}
@@ -20,6 +20,13 @@ void Semaphore::p()
 {
     db<Synchronizer>(TRC) << "Semaphore::p(this=" << this << ",value=" << _value << ")" << endl;
 
+    // Negative values count the threads waiting, so the semaphore can be decremented without
+    // the guard as long as it is positive (the spin gives a thread on another CPU a chance to v())
+    for(unsigned int i = 0; i <= SPINS; i++)
+        for(int value = _value; value > 0; value = _value)
+            if(cas(_value, value, value - 1) == value)
+                return;
+
     begin_atomic();
     if(fdec(_value) < 1)
         sleep(); // implicit end_atomic()
@@ -32,6 +39,11 @@ void Semaphore::v()
 {
     db<Synchronizer>(TRC) << "Semaphore::v(this=" << this << ",value=" << _value << ")" << endl;
 
+    // Likewise, it can be incremented without the guard as long as there is no one to wake up
+    for(int value = _value; value >= 0; value = _value)
+        if(cas(_value, value, value + 1) == value)
+            return;
+
     begin_atomic();
     if(finc(_value) < 0)
         wakeup();  // implicit end_atomic()
@@ -0,0 +1,111 @@
+// EPOS Spin Lock Handover Test Program
+
+// Each CPU runs a worker that repeatedly acquires and releases the same spin lock, holding it for
+// a short critical section. When the lock changes hands, the new owner measures, through the TSC,
+// how long it took since the previous owner released it (the handover latency). The number of
+// acquisitions of each CPU shows how fair each algorithm is.
+
+#include <utility/ostream.h>
+#include <utility/spin.h>
+#include <machine.h>
+#include <tsc.h>
+#include <thread.h>
+
+using namespace EPOS;
+
+const int iterations = 10000;
+const unsigned int CPUS = Traits<Build>::CPUS;
+
+OStream cout;
+
+Thread * worker[CPUS];
+
+volatile bool start;
+volatile bool stop;
+volatile int owner;
+volatile TSC::Time_Stamp released;
+TSC::Time_Stamp handover;
+unsigned int handovers;
+unsigned int acquisitions[CPUS];
+
+template<typename L>
+int work(L * lock, int n)
+{
+    while(!start);
+
+    while(!stop) {
+        CPU::int_disable(); // MCS_Spin uses per-CPU nodes
+        lock->acquire();
+
+        TSC::Time_Stamp now = TSC::time_stamp();
+        if((owner != n) && (owner != -1)) {
+            handover += now - released;
+            handovers++;
+        }
+        owner = n;
+        acquisitions[n]++;
+        if(acquisitions[n] == iterations)
+            stop = true;
+
+        for(volatile int j = 0; j < 10; j++); // critical section
+
+        released = TSC::time_stamp();
+        lock->release();
+        CPU::int_enable();
+    }
+
+    return 0;
+}
+
+template<typename L>
+void test(const char * name)
+{
+    L lock;
+
+    start = false;
+    stop = false;
+    owner = -1;
+    handover = 0;
+    handovers = 0;
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        acquisitions[i] = 0;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        worker[i] = new Thread(Thread::Configuration(Thread::READY, Thread::Criterion(Thread::NORMAL, i)), &work<L>, &lock, int(i));
+
+    start = true;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        worker[i]->join();
+        delete worker[i];
+    }
+
+    unsigned int min = acquisitions[0];
+    unsigned int max = acquisitions[0];
+    for(unsigned int i = 1; i < Machine::n_cpus(); i++) {
+        if(acquisitions[i] < min)
+            min = acquisitions[i];
+        if(acquisitions[i] > max)
+            max = acquisitions[i];
+    }
+
+    cout << name << ": " << (handovers ? handover / handovers : 0) << " cycles/handover (" << handovers << " handovers), "
+         << "acquisitions per CPU in [" << min << ", " << max << "]" << endl;
+}
+
+int main()
+{
+    cout << "Spin lock handover test" << endl;
+    cout << "Running until a CPU acquires each lock " << iterations << " times on " << Machine::n_cpus() << " CPUs" << endl;
+
+    test<Simple_Spin>("TAS");
+    test<Ticket_Spin>("Ticket");
+    test<MCS_Spin>("MCS");
+    test<Spin_Lock<Traits<Spin>::TAS> >("Recursive TAS");
+    test<Spin_Lock<Traits<Spin>::TICKET> >("Recursive Ticket");
+    test<Spin_Lock<Traits<Spin>::MCS> >("Recursive MCS");
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
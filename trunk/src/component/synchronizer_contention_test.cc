@@ -0,0 +1,88 @@
+// EPOS Synchronizer Fast Path Test Program
+
+// Measures, through the TSC, the cost of lock/unlock and p/v pairs on each CPU, first on
+// private synchronizers (uncontended, thus on the atomic fast path) and then on a mutex shared
+// by all CPUs (contended, thus adaptively spinning and eventually blocking).
+
+#include <utility/ostream.h>
+#include <machine.h>
+#include <tsc.h>
+#include <thread.h>
+#include <mutex.h>
+#include <semaphore.h>
+
+using namespace EPOS;
+
+const int iterations = 100000;
+
+OStream cout;
+
+Thread * worker[Traits<Build>::CPUS];
+Mutex * mutex[Traits<Build>::CPUS];
+Semaphore * sem[Traits<Build>::CPUS];
+TSC::Time_Stamp cycles[3][Traits<Build>::CPUS];
+
+Mutex shared;
+volatile unsigned int counter;
+
+int work(int n)
+{
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    for(int i = 0; i < iterations; i++) {
+        mutex[n]->lock();
+        mutex[n]->unlock();
+    }
+    cycles[0][n] = TSC::time_stamp() - t0;
+
+    t0 = TSC::time_stamp();
+    for(int i = 0; i < iterations; i++) {
+        sem[n]->p();
+        sem[n]->v();
+    }
+    cycles[1][n] = TSC::time_stamp() - t0;
+
+    t0 = TSC::time_stamp();
+    for(int i = 0; i < iterations; i++) {
+        shared.lock();
+        counter++;
+        shared.unlock();
+    }
+    cycles[2][n] = TSC::time_stamp() - t0;
+
+    return iterations;
+}
+
+int main()
+{
+    cout << "Synchronizer fast path test" << endl;
+    cout << "Running " << iterations << " rounds of each operation on each of " << Machine::n_cpus() << " CPUs" << endl;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        mutex[i] = new Mutex;
+        sem[i] = new Semaphore;
+    }
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++)
+        worker[i] = new Thread(Thread::Configuration(Thread::READY, Thread::Criterion(Thread::NORMAL, i)), &work, int(i));
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        worker[i]->join();
+
+        cout << "CPU " << i << ": " << cycles[0][i] / iterations << " cycles/uncontended lock+unlock, "
+             << cycles[1][i] / iterations << " cycles/uncontended p+v, "
+             << cycles[2][i] / iterations << " cycles/contended lock+unlock" << endl;
+    }
+
+    if(counter != Machine::n_cpus() * iterations)
+        cout << "Mutual exclusion violated: counter=" << counter << ", expected " << Machine::n_cpus() * iterations << "!" << endl;
+
+    for(unsigned int i = 0; i < Machine::n_cpus(); i++) {
+        delete worker[i];
+        delete mutex[i];
+        delete sem[i];
+    }
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
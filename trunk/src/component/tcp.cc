@@ -8,7 +8,7 @@
 __BEGIN_SYS
 
 // Class attributes
-TCP::Observed TCP::_observed;
+TCP::Demultiplexer TCP::_observed;
 
 TCP::Connection::State_Handler TCP::Connection::_handlers[] = {&TCP::Connection::listening,
                                                                &TCP::Connection::syn_sent,
@@ -38,45 +38,42 @@ void TCP::update(IP::Observed * obs, IP::Protocol prot, NIC::Buffer * pool)
         return;
     }
 
-    unsigned long long id;
-    if(segment->header()->flags() == Header::SYN) // try to notify any eventual listener
-        id = Connection::id(segment->header()->to(), 0, IP::Address::NULL);
-    else
-        id = Connection::id(segment->header()->to(), segment->header()->from(), packet->header()->from());
+    unsigned long long id = Connection::id(segment->header()->to(), segment->header()->from(), packet->header()->from());
 
     db<TCP>(INF) << "TCP::update::condition=" << hex << id << endl;
 
-    if(!_observed.notify(id, pool))
-        pool->nic()->free(pool);
+    if(_observed.notify(id, pool))
+        return;
+
+    if(segment->header()->flags() == Header::SYN) { // no such connection, so try to notify any eventual listener
+        id = Connection::id(segment->header()->to(), 0, IP::Address::NULL);
+        if(_observed.notify(id, pool))
+            return;
+    }
+
+    pool->nic()->free(pool);
 }
 
 void TCP::Segment::sum(const IP::Address & from, const IP::Address & to, const void * data, unsigned int size)
 {
-    _checksum = 0;
-
-    IP::Pseudo_Header pseudo(from, to, IP::TCP, sizeof(Header) + size);
-
-    unsigned long sum = 0;
-    const unsigned char * ptr = reinterpret_cast<const unsigned char *>(&pseudo);
-    for(unsigned int i = 0; i < sizeof(IP::Pseudo_Header); i += 2)
-        sum += (ptr[i] << 8) | ptr[i+1];
+    sum_headers(from, to, data ? CPU::csum(data, size) : 0, size);
+}
 
-    ptr = reinterpret_cast<const unsigned char *>(header());
-    for(unsigned int i = 0; i < sizeof(Header); i += 2)
-        sum += (ptr[i] << 8) | ptr[i+1];
+void TCP::Segment::sum_copy(const IP::Address & from, const IP::Address & to, const void * data, unsigned int size)
+{
+    sum_headers(from, to, CPU::csum_copy(this->data<void>(), data, size), size);
+}
 
-    if(data) {
-        ptr = reinterpret_cast<const unsigned char *>(data);
-        for(unsigned int i = 0; i < size; i += 2)
-            sum += (ptr[i] << 8) | ptr[i+1];
-        if(size & 1)
-            sum += ptr[size - 1];
-    }
+// Completes the checksum with the pseudo header and the header (the sums are kept in the CPU's byte order)
+void TCP::Segment::sum_headers(const IP::Address & from, const IP::Address & to, unsigned long data, unsigned int size)
+{
+    _checksum = 0;
 
-    while(sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
+    IP::Pseudo_Header pseudo(from, to, IP::TCP, sizeof(Header) + size);
+    unsigned long sum = CPU::csum(&pseudo, sizeof(IP::Pseudo_Header), data);
+    sum = CPU::csum(header(), sizeof(Header), sum);
 
-    _checksum = htons(~sum);
+    _checksum = ~sum;
 }
 
 void TCP::Connection::fsend(const Flags & flags)
@@ -86,7 +83,11 @@ void TCP::Connection::fsend(const Flags & flags)
 
     db<TCP>(TRC) << "TCP::Connection::send(flags=" << ((flags & ACK) ? 'A' : '-') << ((flags & RST) ? 'R' : '-') << ((flags & SYN) ? 'S' : '-') << ((flags & FIN) ? 'F' : '-') << "): SND.NXT=" << _next << ",SND.SEQ=" << sequence() << endl;
 
-    Buffer * buf = IP::alloc(peer(), IP::TCP, sizeof(Header), 0);
+    advertise(flags);
+    unsigned int options[OPTIONS / sizeof(unsigned int)];
+    unsigned int length = this->options(options, flags);
+
+    Buffer * buf = IP::alloc(peer(), IP::TCP, sizeof(Header) + length, 0);
     if(!buf) {
         db<TCP>(WRN) << "TCP::send: failed to alloc a NIC buffer to send a TCP control segment!" << endl;
         return;
@@ -96,7 +97,11 @@ void TCP::Connection::fsend(const Flags & flags)
     Packet * packet = buf->frame()->data<Packet>();
     Segment * segment = packet->data<Segment>();
     memcpy(segment, header(), sizeof(Header));
-    segment->sum(packet->from(), packet->to(), 0, 0);
+    if(length) {
+        segment->offset(sizeof(Header) + length);
+        memcpy(segment->options(), options, length);
+    }
+    segment->sum(packet->from(), packet->to(), length ? segment->options() : 0, length);
 
     db<TCP>(INF) << "TCP::Connection::send:conn=" << this << " => " << *this << endl;
 
@@ -116,15 +121,45 @@ int TCP::Connection::send(const void * d, unsigned int size)
 
     db<TCP>(TRC) << "TCP::Connection::send(f=" << from() << ",t=" << peer() << ":" << to() << ",d=" << data << ",s=" << size << ")" << endl;
 
-    unsigned int allowed = WINDOW;
     unsigned int left = size; // bytes that have not been sent at all
     unsigned int acknowledged = 0; // bytes that were sent AND acknowledged
     unsigned int initial_seq = sequence(); // sequence number when stream is started
+    unsigned int last_ack = _unacknowledged;
+    Microsecond expiry = _clock.read() + _rto; // retransmission timer, restarted whenever new data is acknowledged
+
+    _streaming = true;
 
     unsigned int tries = 0;
-    for(; (tries < RETRIES) && (acknowledged != size) && (_state == ESTABLISHED || _state == CLOSE_WAIT);
-        acknowledged = _current->header()->acknowledgment() - initial_seq, allowed = _peer_window - (sequence() - _current->header()->acknowledgment())) {
-        _streaming = true;
+    for(; (tries < RETRIES) && (acknowledged != size) && (_state == ESTABLISHED || _state == CLOSE_WAIT); acknowledged = _unacknowledged - initial_seq) {
+        if(_unacknowledged != last_ack) {
+            last_ack = _unacknowledged;
+            expiry = _clock.read() + _rto;
+            tries = 0;
+        }
+
+        if(_resend) { // fast retransmission (or a partial acknowledgment during fast recovery)
+            db<TCP>(TRC) << "TCP::Connection::send: fast retransmission" << endl;
+
+            _resend = false;
+
+            unsigned int offset = _unacknowledged - initial_seq;
+            unsigned int payload = (size - offset > MSS) ? MSS : size - offset;
+            if(payload) {
+                bool retransmiting = _retransmiting;
+                unsigned int sequence = _sequence;
+                _retransmiting = true;
+                _sequence = htonl(_unacknowledged);
+                dsend(reinterpret_cast<const unsigned char *>(d) + offset, payload);
+                _sequence = sequence;
+                _retransmiting = retransmiting;
+            }
+            continue;
+        }
+
+        // The usable window is limited by both the peer's and the congestion windows
+        unsigned int window = (_peer_window < _cwnd) ? _peer_window : _cwnd;
+        unsigned int outstanding = sequence() - _unacknowledged;
+        unsigned int allowed = (window > outstanding) ? window - outstanding : 0;
         allowed = (allowed > MSS) ? MSS: allowed;
 
         if(allowed && left) {
@@ -142,26 +177,28 @@ int TCP::Connection::send(const void * d, unsigned int size)
         } else { // Either window's full or we've sent all there was to
             db<TCP>(TRC) << "TCP::Connection::send: wait" << endl;
 
-            unsigned int old_ack = _current->header()->acknowledgment();
-
-            Condition_Handler h(&_stream);
-            Alarm a(TIMEOUT, &h);
+            Microsecond now = _clock.read();
+            if(now < expiry) {
+                Condition_Handler h(&_stream);
+                Alarm a(expiry - now, &h);
 
-            _stream.wait();
+                _stream.wait();
+            }
 
-            if(_current->header()->acknowledgment() == old_ack) {
-                // Retransmission
+            if((_unacknowledged == last_ack) && !_resend && (_clock.read() >= expiry)) {
+                // Retransmission timeout: go back to the first unacknowledged byte
                 db<TCP>(TRC) << "TCP::Connection::send: retransmission" << endl;
 
+                timed_out();
+
                 _retransmiting = true;
-                _sequence = htonl(_current->header()->acknowledgment());
-                _unacknowledged = _current->header()->acknowledgment();
-                data = reinterpret_cast<const unsigned char*>(d) + acknowledged;
-                left = size - acknowledged;
+                _sequence = htonl(_unacknowledged);
+                data = reinterpret_cast<const unsigned char*>(d) + (_unacknowledged - initial_seq);
+                left = size - (_unacknowledged - initial_seq);
+                expiry = _clock.read() + _rto;
 
                 tries++;
-            } else
-                tries = 0;
+            }
         }
     }
 
@@ -189,6 +226,7 @@ int TCP::Connection::dsend(const void * d, unsigned int size)
     db<TCP>(TRC) << "TCP::dsend(f=" << from() << ",t=" << peer() << ":" << to() << ",d=" << data << ",s=" << size << ")" << endl;
 
     _flags = ACK;
+    advertise(_flags);
     if(!_retransmiting)
         _sequence = htonl(_next);
 
@@ -208,8 +246,7 @@ int TCP::Connection::dsend(const void * d, unsigned int size)
         if(el == pool->link()) {
             Segment * segment = packet->data<Segment>();
             memcpy(segment, header(), sizeof(Header));
-            segment->sum(packet->from(), packet->to(), data, buf->size() - sizeof(Header) - sizeof(IP::Header));
-            memcpy(segment->data<void>(), data, buf->size() - sizeof(Header) - sizeof(IP::Header));
+            segment->sum_copy(packet->from(), packet->to(), data, buf->size() - sizeof(Header) - sizeof(IP::Header));
             data += buf->size() - sizeof(Header) - sizeof(IP::Header);
 
             db<TCP>(INF) << "TCP::send:msg=" << segment << " => " << *segment << endl;
@@ -221,10 +258,21 @@ int TCP::Connection::dsend(const void * d, unsigned int size)
         headers += sizeof(IP::Header);
     }
 
-    if(!_retransmiting)
+    _statistics.tx_segments++;
+    _statistics.tx_bytes += size;
+
+    if(!_retransmiting) {
+        if(!_timing) {
+            _timing = true;
+            _timed = _next + size;
+            _timed_at = _clock.read();
+        }
         _next += size;
-    else
+    } else {
+        _statistics.retransmissions++;
+        _timing = false;
         _sequence = htonl(header()->sequence() + size);
+    }
 
     return IP::send(pool) - headers; // implicitly releases the pool
 }
@@ -240,21 +288,27 @@ int TCP::Connection::receive(Buffer * pool, void * d, unsigned int s)
     Segment * segment = packet->data<Segment>();
     unsigned int size = 0;
 
-    for(Buffer::Element * el = head; el && (size <= s); el = el->next()) {
+    for(Buffer::Element * el = head; el && (size < s); el = el->next()) {
         Buffer * buf = el->object();
 
         db<TCP>(INF) << "TCP::receive:buf=" << buf << " => " << *buf << endl;
 
         packet = buf->frame()->data<Packet>();
 
+        // Whatever does not fit in data is dropped
         unsigned int len = buf->size() - sizeof(IP::Header);
         if(el == head) {
-            len -= sizeof(Header);
+            len -= segment->offset();
+            if(len > s - size)
+                len = s - size;
             memcpy(data, segment->data<void>(), len);
 
             db<TCP>(INF) << "TCP::receive:msg=" << segment << " => " << *segment << endl;
-        } else
+        } else {
+            if(len > s - size)
+                len = s - size;
             memcpy(data, packet->data<void>(), len);
+        }
 
         db<TCP>(INF) << "TCP::receive:len=" << len << endl;
 
@@ -274,8 +328,14 @@ void TCP::Connection::update(TCP::Observed * obs, unsigned long long socket, NIC
     Packet * packet = pool->frame()->data<Packet>();
 
     _current = packet->data<Segment>(); // FIXME should free the previous buffer
-    _length = pool->size() - sizeof(IP::Header) - sizeof(TCP::Header);
+    _length = length(pool);
+    unsigned int window = _peer_window;
     _peer_window = _current->header()->window();
+    if(!(_current->header()->flags() & SYN))
+        _peer_window <<= _peer_scale;
+
+    _statistics.rx_segments++;
+    _statistics.rx_bytes += _length;
 
     db<TCP>(INF) << "TCP::Connection::update:" <<
         "SEQ.SEQ=" << _current->header()->sequence() <<
@@ -294,8 +354,10 @@ void TCP::Connection::update(TCP::Observed * obs, unsigned long long socket, NIC
 
     if(!((_state == LISTENING) || (_state == SYN_SENT)) && _current->header()->sequence() > acknowledgment()) {
         // SEG.SEQ musn't be > than RCV.NXT, this forces segments to be accepted in order, except when connecting or listening, then one may receive stuff out of the blue
+        // Segments ahead of RCV.NXT carrying data within the window are kept aside until the missing data arrives
         // If SEG.SEQ < RCV.NXT, i.e. delayed or repeated segment, the treatment happens later
-        pool->nic()->free(pool);
+        if(!reorder(pool))
+            pool->nic()->free(pool);
         return;
     }
 
@@ -309,16 +371,21 @@ void TCP::Connection::update(TCP::Observed * obs, unsigned long long socket, NIC
 
     bool relevant = false; // The segment is relevant to the sliding window
     if(_streaming) {
-        if(_current->header()->acknowledgment() <= sequence()) {
+        unsigned int ack = _current->header()->acknowledgment();
+        if(ack <= sequence()) {
             // Regular ack, i.e. SEG.ACK is <= than the last sequence I sent
-            if(_current->header()->acknowledgment() > _unacknowledged)
+            if(ack > _unacknowledged) {
                 relevant = true; // A segment must ack something in order to be relevant
-
-            _unacknowledged = _current->header()->acknowledgment();
-        } else if(_current->header()->acknowledgment() > sequence()) {
+                acknowledged(ack);
+                _unacknowledged = ack;
+            } else if((ack == _unacknowledged) && flight() && !_length && (_peer_window == window)
+                && !(_current->header()->flags() & (SYN | FIN)))
+                relevant = duplicated(); // Duplicate ack, which signals the loss of a segment when repeated (RFC 5681)
+        } else if(ack > sequence()) {
             // Forward ack, i.e. SEG.ACK > SEG.SEQ, but not > than the SND.NXT. This scenario is only possible in this code and in the FSM during retransmission
-            _sequence = htonl(_current->header()->acknowledgment());
-            _unacknowledged = _current->header()->acknowledgment();
+            _sequence = htonl(ack);
+            acknowledged(ack);
+            _unacknowledged = ack;
             relevant = true;
         }
     }
@@ -336,9 +403,13 @@ void TCP::Connection::update(TCP::Observed * obs, unsigned long long socket, NIC
         || (state_at_arrival == SYN_RECEIVED)
         || (state_at_arrival == FIN_WAIT1)
         || (state_at_arrival == FIN_WAIT2))
-        if(_length)
+        if(_length) {
+            unsigned int next = _current->header()->sequence() + _length;
             if(!notify(socket, pool))
                 pool->nic()->free(pool);
+            if(!_out_of_order.empty())
+                reassemble(socket, next);
+        }
 
     if(_streaming && relevant)
         _stream.signal();
@@ -407,6 +478,7 @@ void TCP::Connection::listening()
     if(_current->header()->flags() & SYN) {
         _to = htons(_current->header()->from());
         _acknowledgment = htonl(_current->header()->sequence() + 1);
+        negotiate();
         _transition.signal();
     }
 }
@@ -438,6 +510,7 @@ void TCP::Connection::syn_sent()
                 _acknowledgment = htonl(_current->header()->sequence() + 1);
                 _unacknowledged = _current->header()->acknowledgment();
                 _peer_window = _current->header()->window();
+                negotiate();
 
                 if(_unacknowledged > _initial) {
                     db<TCP>(INF) << "TCP::Connection::syn_sent: connection established!" << endl;
@@ -469,6 +542,7 @@ void TCP::Connection::syn_sent()
 
     if(!(_current->header()->flags() & RST) && (_current->header()->flags() & SYN)) { // Simultaneous SYN
         _acknowledgment = htonl(_current->header()->sequence() + 1);
+        negotiate();
 
         fsend(SYN | ACK);
         state(SYN_RECEIVED);
@@ -517,10 +591,8 @@ void TCP::Connection::syn_received()
             state(ESTABLISHED);
             _tries = 0;
 
-            if(_length) {
-                _acknowledgment = htonl(acknowledgment() + _length);
-                fsend(ACK);
-            }
+            if(_length)
+                acknowledge();
 
             _transition.signal();
         } else if(_current->header()->flags() & FIN) {
@@ -574,10 +646,8 @@ void TCP::Connection::established()
             db<TCP>(TRC) << "TCP::Connection::established: ACK received"
                 << endl;
 
-            if(_length) {
-                _acknowledgment = htonl(acknowledgment() + _length);
-                fsend(ACK);
-            }
+            if(_length)
+                acknowledge();
 
             if(_current->header()->flags() & FIN) {
                 process_fin();
@@ -620,10 +690,8 @@ void TCP::Connection::fin_wait1()
     if(_current->header()->flags() & ACK) {
         db<TCP>(TRC) << "TCP::Connection::fin_wait1: ACK received" << endl;
 
-        if(_length) {
-            _acknowledgment = htonl(acknowledgment() + _length);
-            fsend(ACK);
-        }
+        if(_length)
+            acknowledge();
 
         if(_current->header()->acknowledgment() >= _next) { // our FIN has been acknowledged
             db<TCP>(TRC) << "TCP::Connection::fin_wait1: our FIN has been acknowledged" << endl;
@@ -679,10 +747,8 @@ void TCP::Connection::fin_wait2()
     }
 
     if(_current->header()->flags() & ACK) {
-        if(_length) {
-            _acknowledgment = htonl(acknowledgment() + _length);
-            fsend(ACK);
-        }
+        if(_length)
+            acknowledge();
 
         if(_current->header()->flags() & FIN) {
             process_fin();
@@ -921,9 +987,171 @@ void TCP::Connection::process_fin()
 {
     db<TCP>(TRC) << "TCP::Connection::process_fin(): FIN received" << endl;
 
-    _acknowledgment = htonl(_current->header()->sequence() + 1);
+    _acknowledgment = htonl(_current->header()->sequence() + _length + 1); // FIN comes after the segment's data
+
+    fsend(ACK);
+}
+
+// Keeps a segment that arrived ahead of RCV.NXT (i.e. after a gap) in the out-of-order queue and reports the gap right away
+// with a duplicate acknowledgment, which also carries SACK blocks if the peer permitted them. Returns whether the segment was kept.
+bool TCP::Connection::reorder(Buffer * pool)
+{
+    unsigned int sequence = _current->header()->sequence();
+
+    db<TCP>(TRC) << "TCP::Connection::reorder(buf=" << pool << ",seq=" << sequence << ",len=" << _length << ")" << endl;
+
+    if(!((_state == ESTABLISHED) || (_state == FIN_WAIT1) || (_state == FIN_WAIT2)))
+        return false;
+
+    bool kept = false;
+    if(_length && !(_current->header()->flags() & (SYN | RST | FIN)) && (sequence + _length <= acknowledgment() + WINDOW)) {
+        Buffer::List sorted;
+        while(!_out_of_order.empty() && (segment(_out_of_order.head()->object())->sequence() < sequence))
+            sorted.insert(_out_of_order.remove());
+
+        bool duplicate = !_out_of_order.empty() && (segment(_out_of_order.head()->object())->sequence() == sequence);
+        if(!duplicate && (sorted.size() + _out_of_order.size() < REORDERING)) {
+            sorted.insert(pool->lext());
+            _latest = sequence;
+            kept = true;
+        }
+
+        while(!_out_of_order.empty())
+            sorted.insert(_out_of_order.remove());
+        _out_of_order = sorted;
+    }
 
     fsend(ACK);
+
+    return kept;
+}
+
+// Acknowledges the data in the current (in order) segment along with the queued segments it made contiguous
+void TCP::Connection::acknowledge()
+{
+    unsigned int next = acknowledgment() + _length;
+
+    for(Buffer::Element * el = _out_of_order.head(); el; el = el->next()) {
+        Buffer * pool = el->object();
+        unsigned int sequence = segment(pool)->sequence();
+        unsigned int end = sequence + length(pool);
+
+        if(sequence == next)
+            next = end;
+        else if(end > next) // either a gap or a segment overlapping RCV.NXT (which cannot be trimmed and will be retransmitted)
+            break;
+    }
+
+    _acknowledgment = htonl(next);
+    fsend(ACK);
+}
+
+// Delivers the queued segments acknowledge() has covered, in order, after the one ending at "next"
+void TCP::Connection::reassemble(unsigned long long socket, unsigned int next)
+{
+    db<TCP>(TRC) << "TCP::Connection::reassemble(next=" << next << ",RCV.NXT=" << acknowledgment() << ",queued=" << _out_of_order.size() << ")" << endl;
+
+    while(!_out_of_order.empty()) {
+        Buffer * pool = _out_of_order.head()->object();
+        unsigned int sequence = segment(pool)->sequence();
+        unsigned int end = sequence + length(pool);
+
+        if(sequence >= acknowledgment()) // still ahead of RCV.NXT
+            break;
+
+        _out_of_order.remove();
+
+        if((sequence == next) && (end <= acknowledgment())) {
+            next = end;
+            if(!notify(socket, pool))
+                pool->nic()->free(pool);
+        } else // duplicate or overlapping
+            pool->nic()->free(pool);
+    }
+}
+
+// Picks up the options sent by the peer along with its SYN. Window scaling and SACK are used only if both sides offered them.
+void TCP::Connection::negotiate()
+{
+    bool scaling = false;
+    bool sack = false;
+
+    const unsigned char * option = _current->options();
+    const unsigned char * end = reinterpret_cast<const unsigned char *>(_current) + _current->offset();
+    while((option < end) && (*option != END)) {
+        if(*option == NOP) {
+            option++;
+            continue;
+        }
+
+        if((option + 1 >= end) || (option[1] < 2) || (option + option[1] > end)) // malformed
+            break;
+
+        if((option[0] == WINDOW_SCALE) && (option[1] == 3)) {
+            scaling = true;
+            _peer_scale = (option[2] > 14) ? 14 : option[2];
+        } else if(option[0] == SACK_PERMITTED)
+            sack = true;
+
+        option += option[1];
+    }
+
+    _scaling = _scaling && scaling;
+    if(!_scaling)
+        _scale = _peer_scale = 0;
+    _sack = _sack && sack;
+
+    db<TCP>(INF) << "TCP::Connection::negotiate: scaling=" << _scaling << "(" << _scale << "/" << _peer_scale << "),sack=" << _sack << endl;
+}
+
+// Builds the options for a control segment in "words" (in network byte order), returning their size in bytes.
+// SYNs carry MSS, window scale and SACK permitted, while ACKs report the out-of-order queue in SACK blocks.
+unsigned int TCP::Connection::options(unsigned int * words, const Flags & flags)
+{
+    unsigned int n = 0;
+
+    if(flags & SYN) {
+        words[n++] = htonl((MAXIMUM_SEGMENT_SIZE << 24) | (4 << 16) | MSS);
+        if(_scaling)
+            words[n++] = htonl((NOP << 24) | (WINDOW_SCALE << 16) | (3 << 8) | _scale);
+        if(_sack)
+            words[n++] = htonl((NOP << 24) | (NOP << 16) | (SACK_PERMITTED << 8) | 2);
+    } else if((flags & ACK) && _sack && !_out_of_order.empty()) {
+        // Collapse the queue into contiguous blocks. The first block must contain the latest segment queued,
+        // followed by as many others as fit in the option space.
+        static const unsigned int BLOCKS = (OPTIONS - 4) / 8;
+
+        unsigned int left[REORDERING];
+        unsigned int right[REORDERING];
+        unsigned int blocks = 0;
+        unsigned int latest = 0;
+        for(Buffer::Element * el = _out_of_order.head(); el; el = el->next()) {
+            unsigned int sequence = segment(el->object())->sequence();
+            unsigned int end = sequence + length(el->object());
+            if(blocks && (sequence <= right[blocks - 1])) {
+                if(end > right[blocks - 1])
+                    right[blocks - 1] = end;
+            } else {
+                left[blocks] = sequence;
+                right[blocks] = end;
+                blocks++;
+            }
+            if(sequence == _latest)
+                latest = blocks - 1;
+        }
+
+        unsigned int reported = (blocks > BLOCKS) ? BLOCKS : blocks;
+        words[n++] = htonl((NOP << 24) | (NOP << 16) | (SACK << 8) | (2 + 8 * reported));
+        words[n++] = htonl(left[latest]);
+        words[n++] = htonl(right[latest]);
+        for(unsigned int i = 0; (i < blocks) && (n < 1 + 2 * reported); i++)
+            if(i != latest) {
+                words[n++] = htonl(left[i]);
+                words[n++] = htonl(right[i]);
+            }
+    }
+
+    return n * sizeof(unsigned int);
 }
 
 void TCP::Connection::timeout(Connection* c)
@@ -966,6 +1194,108 @@ void TCP::Connection::timeout(Connection* c)
     }
 }
 
+// Updates the RTT estimators with a new sample, recalculating the retransmission timeout (RFC 6298)
+void TCP::Connection::sample(const Microsecond & rtt)
+{
+    db<TCP>(TRC) << "TCP::Connection::sample(rtt=" << rtt << ")" << endl;
+
+    if(!_statistics.rtt_samples || (rtt < _statistics.rtt_min))
+        _statistics.rtt_min = rtt;
+    if(rtt > _statistics.rtt_max)
+        _statistics.rtt_max = rtt;
+    _statistics.rtt_samples++;
+
+    if(!_srtt) { // first measurement: SRTT = R, RTTVAR = R / 2
+        _srtt = rtt << 3;
+        _rttvar = rtt << 1;
+    } else { // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        Microsecond srtt = _srtt >> 3;
+        Microsecond delta = (rtt > srtt) ? rtt - srtt : srtt - rtt;
+        _rttvar = _rttvar - (_rttvar >> 2) + delta;
+        _srtt = _srtt - srtt + rtt;
+    }
+
+    _rto = (_srtt >> 3) + _rttvar; // SRTT + 4 RTTVAR
+    if(_rto < RTO_MIN)
+        _rto = RTO_MIN;
+    if(_rto > RTO_MAX)
+        _rto = RTO_MAX;
+}
+
+// New data has been acknowledged (_unacknowledged still holds the previous SND.UNA)
+void TCP::Connection::acknowledged(unsigned int ack)
+{
+    unsigned int bytes = ack - _unacknowledged;
+
+    _statistics.acked_bytes += bytes;
+    _duplicates = 0;
+
+    if(_timing && (ack >= _timed)) {
+        _timing = false;
+        sample(_clock.read() - _timed_at);
+    }
+
+    if(_recovering) {
+        if(ack >= _recover) { // full acknowledgment: deflate the window and leave fast recovery
+            _recovering = false;
+            _cwnd = _ssthresh;
+        } else { // partial acknowledgment: the next hole must also be retransmitted (NewReno)
+            _cwnd = ((_cwnd > bytes) ? _cwnd - bytes : 0) + ((bytes >= MSS) ? MSS : 0);
+            _resend = true;
+        }
+    } else if(_cwnd < _ssthresh) // slow start
+        _cwnd += (bytes < MSS) ? bytes : MSS;
+    else { // congestion avoidance
+        unsigned int increment = MSS * MSS / _cwnd;
+        _cwnd += increment ? increment : 1;
+    }
+
+    db<TCP>(INF) << "TCP::Connection::acknowledged(ack=" << ack << "): cwnd=" << _cwnd << ",ssthresh=" << _ssthresh << endl;
+}
+
+// A duplicate acknowledgment arrived. Returns whether the sender must be woken up.
+bool TCP::Connection::duplicated()
+{
+    _duplicates++;
+
+    db<TCP>(INF) << "TCP::Connection::duplicated(ack=" << _unacknowledged << ",dups=" << _duplicates << ")" << endl;
+
+    if(_recovering) { // each further duplicate means another segment has left the network
+        _cwnd += MSS;
+        return true;
+    }
+
+    if((_duplicates == 3) && (_unacknowledged > _recover)) { // fast retransmit and enter fast recovery
+        unsigned int half = flight() / 2;
+        _ssthresh = (half > 2 * MSS) ? half : 2 * MSS;
+        _cwnd = _ssthresh + 3 * MSS;
+        _recover = _next;
+        _recovering = true;
+        _resend = true;
+        _timing = false;
+        _statistics.fast_retransmissions++;
+        return true;
+    }
+
+    return false;
+}
+
+// The retransmission timer expired: back off and restart from a single segment (RFC 5681 and RFC 6298)
+void TCP::Connection::timed_out()
+{
+    db<TCP>(INF) << "TCP::Connection::timed_out(una=" << _unacknowledged << ",rto=" << _rto << ")" << endl;
+
+    unsigned int half = flight() / 2;
+    _ssthresh = (half > 2 * MSS) ? half : 2 * MSS;
+    _cwnd = MSS;
+    _recover = _next;
+    _recovering = false;
+    _duplicates = 0;
+    _timing = false;
+    _rto = (_rto * 2 > RTO_MAX) ? RTO_MAX : _rto * 2;
+    _statistics.timeouts++;
+}
+
 void TCP::Connection::set_timeout(const Alarm::Microsecond & time)
 {
     db<TCP>(TRC) << "TCP::Connection::set_timeout" << endl;
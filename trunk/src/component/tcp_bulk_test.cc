@@ -0,0 +1,95 @@
+// EPOS TCP Bulk Transfer Test Program
+
+// Two nodes (10.0.1.x, with the odd one sending to the even one) move a large stream over a single connection
+// and report the throughput and the connection's statistics on both ends. Run it under QEMU with either
+// PCNet32 or E100 NICs (see Traits<NIC>::NICS) and a lossy or reordering link to exercise SACK and the
+// out-of-order queue. The window in the test's traits exceeds 64 KB, so window scaling is negotiated.
+// Both ends move the stream in chunks of a whole number of MSS-sized segments, since a read consumes
+// whole segments and drops whatever part of the last one does not fit.
+
+#include <utility/ostream.h>
+#include <communicator.h>
+#include <chronometer.h>
+
+using namespace EPOS;
+
+const unsigned int CHUNK = (16 * 1024 / TCP::MSS) * TCP::MSS;
+const unsigned int TOTAL = (16 * 1024 * 1024 / CHUNK) * CHUNK;
+
+OStream cout;
+
+char data[CHUNK];
+
+void report(TCP::Connection * conn, const Chronometer::Microsecond & elapsed, NIC * nic)
+{
+    const TCP::Connection::Statistics & s = conn->statistics();
+    NIC::Statistics stat = nic->statistics();
+
+    cout << "  Time:        " << elapsed / 1000 << " ms" << "\n"
+         << "  Throughput:  " << (elapsed ? static_cast<unsigned long long>(TOTAL) * 1000000 / elapsed / 1024 : 0) << " KB/s" << "\n"
+         << "  Segments:    tx=" << s.tx_segments << ", rx=" << s.rx_segments << "\n"
+         << "  Bytes:       tx=" << s.tx_bytes << ", rx=" << s.rx_bytes << ", acked=" << s.acked_bytes << "\n"
+         << "  Losses:      rtx=" << s.retransmissions << ", fast=" << s.fast_retransmissions << ", timeouts=" << s.timeouts << "\n"
+         << "  RTT:         srtt=" << conn->rtt() << ", min=" << s.rtt_min << ", max=" << s.rtt_max << " us (" << s.rtt_samples << " samples)" << "\n"
+         << "  Window:      cwnd=" << conn->window() << ", rto=" << conn->rto() << " us" << "\n"
+         << "  NIC:         tx=" << stat.tx_packets << "/" << stat.tx_bytes << ", rx=" << stat.rx_packets << "/" << stat.rx_bytes << endl;
+}
+
+int main()
+{
+    cout << "TCP Bulk Transfer Test" << endl;
+
+    IP * ip = IP::get_by_nic(0);
+
+    cout << "  IP: " << ip->address() << endl;
+    cout << "  MAC: " << ip->nic()->address() << endl;
+    cout << "  Window: " << TCP::WINDOW << " bytes, MSS: " << TCP::MSS << " bytes" << endl;
+
+    Link<TCP> * com;
+    Chronometer chrono;
+
+    if(ip->address()[3] % 2) { // sender
+        cout << "Sender:" << endl;
+
+        IP::Address peer_ip = ip->address();
+        peer_ip[3]--;
+
+        for(unsigned int i = 0; i < CHUNK; i++)
+            data[i] = i;
+
+        com = new Link<TCP>(8000, Link<TCP>::Address(peer_ip, TCP::Port(8000))); // connect
+
+        chrono.start();
+        for(unsigned int sent = 0; sent < TOTAL; sent += CHUNK)
+            if(com->write(data, CHUNK) != int(CHUNK)) {
+                cout << "  Stream interrupted after " << sent << " bytes!" << endl;
+                break;
+            }
+        chrono.stop();
+    } else { // receiver
+        cout << "Receiver:" << endl;
+
+        com = new Link<TCP>(TCP::Port(8000)); // listen
+
+        unsigned int errors = 0;
+        chrono.start();
+        for(unsigned int received = 0; received < TOTAL; received += CHUNK) {
+            com->read(data, CHUNK);
+            for(unsigned int i = 0; i < CHUNK; i++)
+                if(data[i] != char(i))
+                    errors++;
+        }
+        chrono.stop();
+
+        if(errors)
+            cout << "  " << errors << " bytes were corrupted or delivered out of order!" << endl;
+    }
+
+    report(com->connection(), chrono.read(), ip->nic());
+
+    delete com;
+
+    cout << "The end!" << endl;
+
+    return 0;
+}
@@ -16,20 +16,22 @@ __BEGIN_SYS
 volatile unsigned int Thread::_thread_count;
 Scheduler_Timer * Thread::_timer;
 Scheduler<Thread> Thread::_scheduler;
-Spin Thread::_lock;
+Thread::Spin Thread::_lock[QUEUES];
 
 // Methods
 void Thread::constructor_prologue(const Color & color, unsigned int stack_size)
 {
-    lock();
+    lock(queue());
 
-    _thread_count++;
+    CPU::finc(_thread_count);
     _scheduler.insert(this);
 
     if(Traits<MMU>::colorful && color != WHITE)
         _stack = new (color) char[stack_size];
     else
         _stack = new (SYSTEM) char[stack_size];
+
+    _fpu = Traits<FPU>::enabled ? new (SYSTEM) FPU::Context : 0;
 }
 
 
@@ -51,15 +53,21 @@ void Thread::constructor_epilogue(const Log_Addr & entry, unsigned int stack_siz
         _scheduler.suspend(this);
 
     if(preemptive && (_state == READY) && (_link.rank() != IDLE))
-        reschedule(_link.rank().queue());
+        reschedule(queue());
     else
-        unlock();
+        unlock(queue());
 }
 
 
 Thread::~Thread()
 {
-    lock();
+    // A waiting thread must leave its synchronizer's queue, whose lock precedes ours
+    Spin * guard = _waiting_lock;
+    CPU::int_disable();
+    if(smp && guard)
+        guard->acquire();
+
+    lock(queue());
 
     db<Thread>(TRC) << "~Thread(this=" << this
                     << ",state=" << _state
@@ -77,18 +85,18 @@ Thread::~Thread()
         break;
     case READY:
         _scheduler.remove(this);
-        _thread_count--;
+        CPU::fdec(_thread_count);
         break;
     case SUSPENDED:
         _scheduler.resume(this);
         _scheduler.remove(this);
-        _thread_count--;
+        CPU::fdec(_thread_count);
         break;
     case WAITING:
         _waiting->remove(this);
         _scheduler.resume(this);
         _scheduler.remove(this);
-        _thread_count--;
+        CPU::fdec(_thread_count);
         break;
     case FINISHING: // Already called exit()
         break;
@@ -99,10 +107,18 @@ Thread::~Thread()
         delete _user_stack;
     }
 
+    if(smp && guard)
+        guard->release();
+
+    unlock(queue());
+
     if(_joining)
         _joining->resume();
 
-    unlock();
+    if(Traits<FPU>::enabled) {
+        FPU::discard(_fpu);
+        delete _fpu;
+    }
 
     delete _stack;
 }
@@ -110,32 +126,127 @@ Thread::~Thread()
 
 void Thread::priority(const Priority & c)
 {
-    lock();
+    unsigned int old_queue = queue();
+
+    lock(old_queue);
 
     db<Thread>(TRC) << "Thread::priority(this=" << this << ",prio=" << c << ")" << endl;
 
-    unsigned int old_cpu = _link.rank().queue();
+    if(_state != RUNNING)
+        _scheduler.remove(this);
+
+    // A priority inherited through a real-time locking protocol prevails until the mutexes get released
+    bool inheriting = !_mutexes.empty() && (int(_link.rank()) < _natural_priority);
+    int inherited = _link.rank();
 
     _link.rank(Criterion(c));
 
-    if(_state != RUNNING) {
-        _scheduler.remove(this);
-        _scheduler.insert(this);
+    if(!_mutexes.empty()) {
+        _natural_priority = _link.rank();
+        if(inheriting && (inherited < _natural_priority))
+            criterion()._priority = inherited;
+    }
+
+    // The thread might have migrated to another queue (it is in none right now, so no nesting is needed)
+    unsigned int new_queue = queue();
+    if(new_queue != old_queue) {
+        release(old_queue);
+        acquire(new_queue);
     }
 
+    if(_state != RUNNING)
+        _scheduler.insert(this);
+
     if(preemptive) {
-        reschedule(old_cpu);
-        if(smp) {
-            lock();
-            reschedule(_link.rank().queue());
+        reschedule(new_queue);
+        if(smp && (new_queue != old_queue)) {
+            lock(old_queue);
+            reschedule(old_queue);
         }
+    } else
+        unlock(new_queue);
+}
+
+
+// Makes "p" the effective priority of this thread, without touching the rest of its criterion, on behalf of a
+// real-time locking protocol (see Mutex). The thread is repositioned in the queue it is in, but in SMP configurations
+// the queue of the synchronizer it might be waiting on is only protected by its guard, so it is left as is.
+void Thread::inherit(int p)
+{
+    // The guard of the synchronizer involved must be held (with interrupts disabled) before entering this method
+    assert(locked());
+
+    if(p == int(_link.rank()))
+        return;
+
+    db<Thread>(TRC) << "Thread::inherit(this=" << this << ",prio=" << p << ")" << endl;
+
+    acquire(queue());
+
+    switch(_state) {
+    case READY:
+        _scheduler.remove(this);
+        criterion()._priority = p;
+        _scheduler.insert(this);
+        if(smp && preemptive && (cpu(queue()) != Machine::cpu_id()))
+            IC::ipi_send(cpu(queue()), IC::INT_RESCHEDULER);
+        break;
+    case WAITING:
+        if(!smp) {
+            _waiting->remove(this);
+            criterion()._priority = p;
+            _waiting->insert(&_link);
+        } else
+            criterion()._priority = p;
+        break;
+    default: // RUNNING threads are not in the scheduling queues and SUSPENDED ones will be inserted with their new priority
+        criterion()._priority = p;
+        break;
     }
+
+    release(queue());
+}
+
+
+// Recomputes the dynamic part of this thread's criterion (e.g. the absolute deadline of EDF-based ones) at the beginning
+// of a new period. Scheduling queues don't support changing the rank of their elements in place (heaps, in particular,
+// would lose their order), so a READY thread is taken out of its queue and put back in, as inherit() does.
+void Thread::update()
+{
+    lock(queue());
+
+    db<Thread>(TRC) << "Thread::update(this=" << this << ",state=" << _state << ")" << endl;
+
+    switch(_state) {
+    case READY:
+        _scheduler.remove(this);
+        criterion().update();
+        _scheduler.insert(this);
+        break;
+    case WAITING:
+        if(!smp) {
+            _waiting->remove(this);
+            criterion().update();
+            _waiting->insert(&_link);
+        } else // the synchronizer's queue is only protected by its guard (see inherit())
+            criterion().update();
+        break;
+    default: // RUNNING threads are not in the scheduling queues and SUSPENDED ones will be inserted with their new rank
+        criterion().update();
+        break;
+    }
+
+    if(preemptive)
+        reschedule(queue());
+    else
+        unlock(queue());
 }
 
 
 int Thread::join()
 {
     lock();
+    acquire(current_queue(), queue());
 
     db<Thread>(TRC) << "Thread::join(this=" << this << ",state=" << _state << ")" << endl;
 
@@ -147,9 +258,12 @@ int Thread::join()
 
     if(_state != FINISHING) {
         _joining = running();
+        release(current_queue(), queue());
         _joining->suspend(true);
-    } else
+    } else {
+        release(current_queue(), queue());
         unlock();
+    }
 
     return *reinterpret_cast<int *>(_stack);
 }
@@ -176,24 +290,30 @@ void Thread::pass()
 void Thread::suspend(bool locked)
 {
     if(!locked)
-        lock();
+        lock(queue());
 
     db<Thread>(TRC) << "Thread::suspend(this=" << this << ")" << endl;
 
     Thread * prev = running();
+    bool was_running = (_state == RUNNING);
 
     _scheduler.suspend(this);
     _state = SUSPENDED;
 
-    Thread * next = running();
+    if(prev == this) {
+        Thread * next = running();
 
-    dispatch(prev, next);
+        dispatch(prev, next);
+    } else if(was_running) // on another CPU, which must choose another thread
+        reschedule(queue());
+    else
+        unlock(queue());
 }
 
 
 void Thread::resume()
 {
-    lock();
+    lock(queue());
 
     db<Thread>(TRC) << "Thread::resume(this=" << this << ")" << endl;
 
@@ -202,11 +322,13 @@ void Thread::resume()
         _scheduler.resume(this);
 
         if(preemptive)
-            reschedule(_link.rank().queue());
+            reschedule(queue());
+        else
+            unlock(queue());
     } else {
         db<Thread>(WRN) << "Resume called for unsuspended object!" << endl;
 
-        unlock();
+        unlock(queue());
     }
 }
 
@@ -236,76 +358,115 @@ void Thread::exit(int status)
     *reinterpret_cast<int *>(prev->_stack) = status;
     prev->_state = FINISHING;
 
-    _thread_count--;
+    CPU::fdec(_thread_count);
 
     if(prev->_joining) {
-        prev->_joining->_state = READY;
-        _scheduler.resume(prev->_joining);
+        Thread * joining = prev->_joining;
+        acquire(current_queue(), joining->queue());
+        joining->_state = READY;
+        _scheduler.resume(joining);
         prev->_joining = 0;
+        release(current_queue(), joining->queue());
+
+        if(smp && preemptive && (cpu(joining->queue()) != Machine::cpu_id()))
+            IC::ipi_send(cpu(joining->queue()), IC::INT_RESCHEDULER);
     }
 
     dispatch(prev, _scheduler.choose());
 }
 
 
-void Thread::sleep(Queue * q)
+void Thread::sleep(Queue * q, Spin * guard)
 {
     db<Thread>(TRC) << "Thread::sleep(running=" << running() << ",q=" << q << ")" << endl;
 
-    // lock() must be called before entering this method
+    // The guard of "q" must be held (with interrupts disabled) before entering this method
     assert(locked());
 
+    acquire(current_queue());
+
     Thread * prev = running();
     _scheduler.suspend(prev);
     prev->_state = WAITING;
     q->insert(&prev->_link);
     prev->_waiting = q;
+    prev->_waiting_lock = guard;
+
+    if(smp)
+        guard->release();
 
     dispatch(prev, _scheduler.chosen());
 }
 
 
-void Thread::wakeup(Queue * q)
+void Thread::wakeup(Queue * q, Spin * guard)
 {
     db<Thread>(TRC) << "Thread::wakeup(running=" << running() << ",q=" << q << ")" << endl;
 
-    // lock() must be called before entering this method
+    // The guard of "q" must be held (with interrupts disabled) before entering this method
     assert(locked());
 
     if(!q->empty()) {
         Thread * t = q->remove()->object();
+        acquire(t->queue());
         t->_state = READY;
         t->_waiting = 0;
+        t->_waiting_lock = 0;
+
+        if(smp)
+            guard->release();
+
         _scheduler.resume(t);
 
         if(preemptive)
-            reschedule(t->_link.rank().queue());
-    } else
-        unlock();
+            reschedule(t->queue());
+        else
+            unlock(t->queue());
+    } else {
+        if(smp)
+            guard->release();
+
+        CPU::int_enable();
+    }
 }
 
 
-void Thread::wakeup_all(Queue * q)
+void Thread::wakeup_all(Queue * q, Spin * guard)
 {
     db<Thread>(TRC) << "Thread::wakeup_all(running=" << running() << ",q=" << q << ")" << endl;
 
-    // lock() must be called before entering this method
+    // The guard of "q" must be held (with interrupts disabled) before entering this method
     assert(locked());
 
-    if(!q->empty())
-        while(!q->empty()) {
-            Thread * t = q->remove()->object();
-            t->_state = READY;
-            t->_waiting = 0;
-            _scheduler.resume(t);
-
-            if(preemptive) {
-                reschedule(t->_link.rank().queue());
-                lock();
-            }
-         }
-    else
-        unlock();
+    // The guard cannot be held across a dispatch, so threads woken up on this CPU's queue
+    // are only rescheduled after all of them have been released
+    bool local = false;
+
+    while(!q->empty()) {
+        Thread * t = q->remove()->object();
+        acquire(t->queue());
+        t->_state = READY;
+        t->_waiting = 0;
+        t->_waiting_lock = 0;
+        _scheduler.resume(t);
+        release(t->queue());
+
+        if(preemptive) {
+            if(!smp || (cpu(t->queue()) == Machine::cpu_id()))
+                local = true;
+            else
+                IC::ipi_send(cpu(t->queue()), IC::INT_RESCHEDULER);
+        }
+    }
+
+    if(smp)
+        guard->release();
+
+    if(local) {
+        acquire(current_queue());
+        reschedule();
+    } else
+        CPU::int_enable();
 }
 
 
@@ -323,14 +484,14 @@ void Thread::reschedule()
 }
 
 
-void Thread::reschedule(unsigned int cpu)
+void Thread::reschedule(unsigned int queue)
 {
-    if(!smp || (cpu == Machine::cpu_id()))
+    if(!smp || (cpu(queue) == Machine::cpu_id()))
         reschedule();
     else {
-        db<Scheduler<Thread> >(TRC) << "Thread::reschedule(cpu=" << cpu << ")" << endl;
-        IC::ipi_send(cpu, IC::INT_RESCHEDULER);
-        unlock();
+        db<Scheduler<Thread> >(TRC) << "Thread::reschedule(queue=" << queue << ",cpu=" << cpu(queue) << ")" << endl;
+        IC::ipi_send(cpu(queue), IC::INT_RESCHEDULER);
+        unlock(queue);
     }
 }
 
@@ -367,16 +528,17 @@ void Thread::dispatch(Thread * prev, Thread * next, bool charge)
         db<Thread>(INF) << "prev={" << prev << ",ctx=" << *prev->_context << "}" << endl;
         db<Thread>(INF) << "next={" << next << ",ctx=" << *next->_context << "}" << endl;
 
-        if(smp)
-            _lock.release();
+        release(current_queue());
 
         if(multitask && (next->_task != prev->_task))
             next->_task->activate();
 
+        if(Traits<FPU>::enabled)
+            FPU::switch_context(next->_fpu);
+
         CPU::switch_context(&prev->_context, next->_context);
     } else
-        if(smp)
-            _lock.release();
+        release(current_queue());
 
     // TODO: could this be moved to right after the switch_context?
     CPU::int_enable();
@@ -417,4 +579,9 @@ unsigned int This_Thread::id()
 {
     return _not_booting ? reinterpret_cast<volatile unsigned int>(Thread::self()) : Machine::cpu_id() + 1;
 }
+
+unsigned int This_Thread::cpu()
+{
+    return Machine::cpu_id();
+}
 __END_UTIL
@@ -23,6 +23,10 @@ void Thread::init()
             IC::int_vector(IC::INT_RESCHEDULER, rescheduler);
         IC::enable(IC::INT_RESCHEDULER);
     }
+
+    // FPU contexts are switched lazily, on the first FPU instruction executed by each dispatched thread
+    if(Traits<FPU>::enabled)
+        FPU::init();
 }
 
 __END_SYS
@@ -8,7 +8,7 @@
 __BEGIN_SYS
 
 // Class attributes
-UDP::Observed UDP::_observed;
+UDP::Demultiplexer UDP::_observed;
 
 // Methods
 int UDP::send(const Port & from, const Address & to, const void * d, unsigned int s)
@@ -18,7 +18,7 @@ int UDP::send(const Port & from, const Address & to, const void * d, unsigned in
 
     db<UDP>(TRC) << "UDP::send(f=" << from << ",t=" << to << ",d=" << data << ",s=" << size << ")" << endl;
 
-    Buffer * pool = IP::alloc(to.ip(), IP::UDP, sizeof(Header), size);
+    Buffer * pool = alloc(from, to, size);
     if(!pool)
         return 0;
 
@@ -32,16 +32,13 @@ int UDP::send(const Port & from, const Address & to, const void * d, unsigned in
 
         if(el == pool->link()) {
             message = packet->data<Message>();
-            new(packet->data<void>()) Header(from, to.port(), size);
             message->sum_header(packet->from(), packet->to());
-            memcpy(message->data<void>(), data, buf->size() - sizeof(Header) - sizeof(IP::Header));
-            message->sum_data(data, buf->size() - sizeof(Header) - sizeof(IP::Header));
+            message->sum_copy(message->data<void>(), data, buf->size() - sizeof(Header) - sizeof(IP::Header));
             data += buf->size() - sizeof(Header) - sizeof(IP::Header);
 
             db<UDP>(INF) << "UDP::send:msg=" << message << " => " << *message << endl;
         } else {
-            memcpy(packet->data<void>(), data, buf->size() - sizeof(IP::Header));
-            message->sum_data(data, buf->size() - sizeof(IP::Header));
+            message->sum_copy(packet->data<void>(), data, buf->size() - sizeof(IP::Header));
             data += buf->size() - sizeof(IP::Header);
         }
 
@@ -54,6 +51,80 @@ int UDP::send(const Port & from, const Address & to, const void * d, unsigned in
 }
 
 
+UDP::Buffer * UDP::alloc(const Port & from, const Address & to, unsigned int size)
+{
+    db<UDP>(TRC) << "UDP::alloc(f=" << from << ",t=" << to << ",s=" << size << ")" << endl;
+
+    if(size > sizeof(Data)) {
+        db<UDP>(WRN) << "UDP::alloc: datagram too large (s=" << size << ")!" << endl;
+        return 0;
+    }
+
+    Buffer * pool = IP::alloc(to.ip(), IP::UDP, sizeof(Header), size);
+    if(pool)
+        new(pool->frame()->data<Packet>()->data<void>()) Header(from, to.port(), size);
+
+    return pool;
+}
+
+
+void * UDP::payload(Buffer * pool, unsigned int offset, unsigned int * contiguous)
+{
+    for(Buffer::Element * el = pool->link(); el; el = el->next()) {
+        Buffer * buf = el->object();
+        Packet * packet = buf->frame()->data<Packet>();
+
+        unsigned char * data = packet->data<unsigned char>();
+        unsigned int size = buf->size() - sizeof(IP::Header);
+        if(el == pool->link()) {
+            data += sizeof(Header);
+            size -= sizeof(Header);
+        }
+
+        if(offset < size) {
+            if(contiguous)
+                *contiguous = size - offset;
+            return data + offset;
+        }
+        offset -= size;
+    }
+
+    if(contiguous)
+        *contiguous = 0;
+    return 0;
+}
+
+
+int UDP::send(Buffer * pool)
+{
+    db<UDP>(TRC) << "UDP::send(buf=" << pool << ")" << endl;
+
+    Packet * packet = pool->frame()->data<Packet>();
+    Message * message = packet->data<Message>();
+    message->sum_header(packet->from(), packet->to());
+
+    // The payload has just been written by the caller, so this pass runs on warm cache lines
+    unsigned int headers = sizeof(Header);
+    for(Buffer::Element * el = pool->link(); el; el = el->next()) {
+        Buffer * buf = el->object();
+        packet = buf->frame()->data<Packet>();
+
+        if(el == pool->link())
+            message->sum_data(message->data<void>(), buf->size() - sizeof(Header) - sizeof(IP::Header));
+        else
+            message->sum_data(packet->data<void>(), buf->size() - sizeof(IP::Header));
+
+        headers += sizeof(IP::Header);
+    }
+
+    message->sum_trailer();
+
+    db<UDP>(INF) << "UDP::send:msg=" << message << " => " << *message << endl;
+
+    return IP::send(pool) - headers; // implicitly releases the pool
+}
+
+
 int UDP::receive(Buffer * pool, void * d, unsigned int s)
 {
     unsigned char * data = reinterpret_cast<unsigned char *>(d);
@@ -117,44 +188,32 @@ void UDP::Message::sum_header(const IP::Address & from, const IP::Address & to)
     _checksum = 0;
     if(Traits<UDP>::checksum) {
         IP::Pseudo_Header pseudo(from, to, IP::UDP, length());
-        unsigned long sum = 0;
-
-        const unsigned char * ptr = reinterpret_cast<const unsigned char *>(&pseudo);
-        for(unsigned int i = 0; i < sizeof(IP::Pseudo_Header); i += 2)
-            sum += (ptr[i] << 8) | ptr[i+1];
-
-        ptr = reinterpret_cast<const unsigned char *>(header());
-        for(unsigned int i = 0; i < sizeof(Header); i += 2)
-            sum += (ptr[i] << 8) | ptr[i+1];
-
-        _checksum = sum;
+        unsigned long sum = CPU::csum(&pseudo, sizeof(IP::Pseudo_Header));
+        _checksum = CPU::csum(header(), sizeof(Header), sum);
     }
 }
 
+// Partial sums are kept in _checksum (in the CPU's byte order) until sum_trailer()
 void UDP::Message::sum_data(const void * data, unsigned int size)
 {
-    if(Traits<UDP>::checksum) {
-        unsigned long sum = _checksum;
-
-        const unsigned char * ptr = reinterpret_cast<const unsigned char *>(data);
-        for(unsigned int i = 0; i < size; i += 2)
-            sum += (ptr[i] << 8) | ptr[i+1];
-        if(size & 1)
-            sum += ptr[size - 1];
+    if(Traits<UDP>::checksum)
+        _checksum = CPU::csum(data, size, _checksum);
+}
 
-        _checksum = sum;
-    }
+void UDP::Message::sum_copy(void * to, const void * data, unsigned int size)
+{
+    if(Traits<UDP>::checksum)
+        _checksum = CPU::csum_copy(to, data, size, _checksum);
+    else
+        memcpy(to, data, size);
 }
 
 void UDP::Message::sum_trailer()
 {
     if(Traits<UDP>::checksum) {
-        unsigned long sum = _checksum;
-
-        while(sum >> 16)
-            sum = (sum & 0xffff) + (sum >> 16);
-
-        _checksum = htons(~sum);
+        _checksum = ~_checksum;
+        if(!_checksum)
+            _checksum = 0xffff; // zero means no checksum (RFC 768)
     }
 }
 
@@ -81,6 +81,9 @@ public:
         // available to user threads
         Machine::smp_barrier();
 
+        if(Traits<FPU>::enabled)
+            FPU::switch_context(first->_fpu);
+
         first->_context->load();
     }
 };
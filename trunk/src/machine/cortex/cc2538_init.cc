@@ -13,8 +13,10 @@ CC2538::CC2538(unsigned int unit): _unit(unit), _rx_cur_consume(0), _rx_cur_prod
     db<CC2538>(TRC) << "CC2538(unit=" << unit << ")" << endl;
 
     // Initialize RX buffer pool
-    for(unsigned int i = 0; i < RX_BUFS; i++)
+    for(unsigned int i = 0; i < RX_BUFS; i++) {
         _rx_bufs[i] = new (SYSTEM) Buffer(0, 0);
+        _rx_bufs[i]->unlock();
+    }
 
     // Set Address
     ffsm(SHORT_ADDR0) = _address[0];
@@ -9,10 +9,39 @@ __BEGIN_SYS
 // Class attributes
 //Timer::Handler* Timer::handlers[4];
 Timer * Timer::_channels[CHANNELS];
+volatile Timer::Tick Timer::_elapsed;
+volatile Timer::Count Timer::_phase;
+volatile Timer::Count Timer::_programmed;
+
+#ifndef __mmod_zynq__
+volatile bool System_Timer_Engine::_expired;
+#endif
 
 // Class methods
 void Timer::int_handler(const Interrupt_Id & i)
 {
+    if(tickless) {
+        // Charge the elapsed ticks to all channels and reprogram the engine before calling any handler,
+        // since handlers might not return for a while (e.g. the scheduler's handler may dispatch another thread)
+        account();
+
+        bool expired[CHANNELS];
+        for(unsigned int c = 0; c < CHANNELS; c++) {
+            Timer * timer = _channels[c];
+            expired[c] = timer && !timer->_current[0];
+            if(expired[c])
+                timer->_current[0] = timer->_retrigger ? timer->_initial : Count(~0);
+        }
+
+        program();
+
+        for(unsigned int c = 0; c < CHANNELS; c++)
+            if(expired[c] && _channels[c])
+                _channels[c]->_handler(i);
+
+        return;
+    }
+
     if(_channels[SCHEDULER] && (--_channels[SCHEDULER]->_current[Machine::cpu_id()] <= 0)) {
         _channels[SCHEDULER]->_current[Machine::cpu_id()] = _channels[SCHEDULER]->_initial;
         _channels[SCHEDULER]->_handler(i);
@@ -24,4 +53,44 @@ void Timer::int_handler(const Interrupt_Id & i)
     }
 }
 
+// Counts elapsed since the engine was last programmed
+Timer::Count Timer::consumed()
+{
+    if(!_programmed)
+        return 0;
+    return Engine::expired() ? _programmed : _programmed - Engine::read();
+}
+
+// Charges the ticks elapsed since the engine was last programmed to all channels,
+// keeping the fraction of the current tick in _phase so time does not drift
+void Timer::account()
+{
+    Count counts = consumed() + _phase;
+    Tick ticks = counts / per_tick();
+    _phase = counts % per_tick();
+    _programmed = 0;
+    _elapsed += ticks;
+
+    for(unsigned int c = 0; c < CHANNELS; c++) {
+        Timer * timer = _channels[c];
+        if(timer)
+            timer->_current[0] = (timer->_current[0] > static_cast<Count>(ticks)) ? timer->_current[0] - ticks : 0;
+    }
+}
+
+// Programs the engine to interrupt at the closest channel expiration (limited by the engine's range)
+void Timer::program()
+{
+    Count next = (Engine::MAX - per_tick()) / per_tick();
+    for(unsigned int c = 0; c < CHANNELS; c++) {
+        Timer * timer = _channels[c];
+        if(timer && (timer->_current[0] < next))
+            next = timer->_current[0] ? timer->_current[0] : 1;
+    }
+
+    Count count = next * per_tick() - _phase;
+    _programmed = count;
+    Engine::one_shot(count);
+}
+
 __END_SYS
@@ -9,10 +9,15 @@ void Timer::init()
 {
     db<Init, Timer>(TRC) << "Timer::init()" << endl;
 
-    Engine::init(FREQUENCY);
+    if(!tickless)
+        Engine::init(FREQUENCY);
     IC::int_vector(IC::INT_TIMER, int_handler);
     IC::enable(IC::INT_TIMER);
-    Engine::enable();
+    if(tickless) {
+        _programmed = per_tick();
+        Engine::one_shot(per_tick());
+    } else
+        Engine::enable();
 }
 
 __END_SYS
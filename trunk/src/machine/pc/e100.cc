@@ -3,6 +3,7 @@
 #include <machine/pc/machine.h>
 #include <machine/pc/e100.h>
 #include <task.h>
+#include <semaphore.h>
 
 __BEGIN_SYS
 
@@ -72,6 +73,8 @@ E100::E100(unsigned int unit, const Log_Addr & io_mem, const IO_Irq & irq, DMA_B
     _io_mem = io_mem;
     _irq = irq;
     _csr = static_cast<CSR_Desc *>(io_mem);
+    _receiver = 0;
+    _rx_ready = 0;
     _dma_buffer = dma_buf;
 
     // Distribute the DMA_Buffer allocated by init()
@@ -141,7 +144,8 @@ E100::E100(unsigned int unit, const Log_Addr & io_mem, const IO_Irq & irq, DMA_B
         phy += align128(sizeof(Buffer));
     }
 
-    // Tx Buffer
+    // Tx Buffer (frames are copied into the TxCBs when sent, so the buffers are not bound to them)
+    _tx_hint = 0;
     for(i = 0; i < TX_BUFS; i++) {
         _tx_buffer[i] = new (log) Buffer(&_tx_ring[i]);
 
@@ -149,8 +153,6 @@ E100::E100(unsigned int unit, const Log_Addr & io_mem, const IO_Irq & irq, DMA_B
         phy += align128(sizeof(Buffer));
     }
 
-    _tx_buffer_prev = _tx_buffer[_tx_prev];
-
     // reset
     reset();
 }
@@ -218,50 +220,14 @@ void E100::reset()
 
 int E100::send(const Address & dst, const Protocol & prot, const void * data, unsigned int size)
 {
-    // wait for a free TxCB
-    while(!(_tx_ring[_tx_cur].status & cb_complete)) {
-        if (_tx_cuc_suspended) {
-            //_int_lock.acquire();
-            _tx_cuc_suspended = 0;
-            while(exec_command(cuc_resume, 0));
-            //_int_lock.release();
-        }
-    }
-
-    _tx_ring[_tx_cur].status = Tx_CB_IN_USE;
-    _tx_ring[_tx_cur].tcb_byte_count = (size + HEADER_SIZE);
-
-    // put the ethernet frame into de TxCB
-    // new (_tx_ring[_tx_cur].frame) Frame(_address, dst, htons(prot), data, size); // original
-    /* New implementation, double copy: parameters to buffer and buffer to Tx_Desc.frame.
-     * Making Tx_Desc.frame a pointer does not work (I believe E100 demands for
-     * a contiguous allocated memory for Tx ring descriptors).
-     */
-    Buffer * buf = _tx_buffer[_tx_cur];
-    Frame * frame = buf->frame();
-    new (frame) Frame(_address, dst, htons(prot), data, size);
-    new (_tx_ring[_tx_cur].frame()) Frame(_address, frame->dst(), htons(frame->prot()), frame->data<void>(), size);
-    // ----
-    // TODO: the above doesn't make sense!
-
-    db<E100>(TRC) << "E100::send(dst=" << dst << ", prot=" << prot << ", data=" << (char *) data << ", size=" << size << ")";
-    db<E100>(INF) << "E100::send:frame={dst=" << frame->dst() << ", prot=" << frame->prot() << ", data=" << (char *) frame->data<void>() << ", size=" << buf->size() << "}" << endl;
-
-    _tx_ring[_tx_cur].command = cb_s; // suspend bit
-    _tx_ring[_tx_cur].command |= (cb_tx | cb_cid); // transmit command
-
-    _tx_ring[_tx_prev].command &= ~cb_s; // remove suspend bit
-    ++_tx_prev %= TX_BUFS;
-
-    // we have no guarantee that this command will be accepted by the adapter
-    exec_command(cuc_resume, 0);
+    db<E100>(TRC) << "E100::send(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",d=" << data << ",s=" << size << ")" << endl;
 
-    ++_tx_cur %= TX_BUFS;
+    Buffer * buf = seize();
 
-    _statistics.tx_packets++;
-    _statistics.tx_bytes += size;
+    // Assemble the Ethernet frame
+    new (buf) Buffer(0, size, _address, dst, prot, data, size);
 
-    return size;
+    return send(buf);
 }
 
 bool E100::verifyPendingInterrupts(void)
@@ -333,9 +299,6 @@ int E100::receive(Address * src, Protocol * prot, void * data, unsigned int size
     return size;
 }
 
-/*! NOTE: this method is not thread-safe as _tx_cur is shared by all threads
- * that use this object and the access to _tx_cur is not atomic. */
-// TODO: solve this!
 E100::Buffer * E100::alloc(NIC * nic, const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload)
 {
     db<E100>(TRC) << "E100::alloc(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",on=" << once << ",al=" << always << ",ld=" << payload << ")" << endl;
@@ -351,20 +314,12 @@ E100::Buffer * E100::alloc(NIC * nic, const Address & dst, const Protocol & prot
 
     // Calculate how many frames are needed to hold the transport PDU and allocate enough buffers
     for(int size = once + payload; size > 0; size -= max_data) {
-        // Wait for the next buffer to become free and seize it
-        for(bool locked = false; !locked; ) {
-            for(; !(_tx_ring[_tx_cur].status & cb_complete); ++_tx_cur %= TX_BUFS);
-            locked = _tx_buffer[_tx_cur]->lock();
-        }
-        Tx_Desc * desc = &_tx_ring[_tx_cur];
-        Buffer * buf = _tx_buffer[_tx_cur];
+        Buffer * buf = seize();
 
         // Initialize the buffer and assemble the Ethernet Frame Header
         new (buf) Buffer(nic, (size > max_data) ? MTU : size + always, _address, dst, prot);
 
-        db<E100>(INF) << "E100::alloc:desc[" << _tx_cur << "]=" << desc << " => " << *desc << endl;
-
-        ++_tx_cur %= TX_BUFS;
+        db<E100>(INF) << "E100::alloc:buf=" << buf << " => " << *buf << endl;
 
         pool.insert(buf->link());
     }
@@ -395,37 +350,44 @@ void E100::free(Buffer * buf)
     }
 }
 
-/*! NOTE: this method is not thread-safe because _tx_buffer_prev is shared by
- * all threads that use this object. */
+// Copies all the frames in the pool into the TxCBs following the last one handed over to the CU and resumes the CU once for
+// the whole batch, which only suspends after its last frame. TxCBs are reclaimed lazily: each one is only checked for
+// completion when the ring wraps around to it, so sending never waits for the frames to leave. Since the frames are
+// copied, the buffers are released right away.
 int E100::send(Buffer * buf)
 {
-    db<E100>(TRC) << "E100::send new api" << endl;
-    /// assumes: buf->is_locked();
-
     unsigned int size = 0;
 
-    for(Ethernet::Buffer::Element * el = buf->link(); el; el = el->next()) {
+    Spin_Guard<> guard(_tx_lock);
+
+    int last = _tx_prev; // last TxCB filled, but not necessarily handed over yet
+    for(Buffer::Element * el = buf->link(), * next; el; el = next) {
+        next = el->next();
         buf = el->object();
-        Tx_Desc * desc = reinterpret_cast<Tx_Desc *>(buf->back());
-        Ethernet::Frame * frame = buf->frame();
+        Tx_Desc * desc = &_tx_ring[_tx_cur];
+        Frame * frame = buf->frame();
 
         db<E100>(TRC) << "E100::send(buf=" << buf << ")" << endl;
 
-        desc->tcb_byte_count = buf->size() + sizeof(Ethernet::Header);
+        // The ring is full: hand over the TxCBs filled so far, so the CU can complete them
+        if((last != _tx_prev) && (!(desc->status & cb_complete) || (_tx_cur == _tx_prev)))
+            kick(last);
 
-        db<E100>(TRC) << "E100::send-zc:\n" << "(dst=" << frame->dst() << ", prot=" << frame->prot() << ", data=" << (char *) frame->data<void>() << ", size=" << buf->size() << ")" << endl;
+        // Wait for the CU to complete the TxCB (handed over TX_BUFS frames ago)
+        while(!(desc->status & cb_complete));
 
-        new (desc->frame()) Ethernet::Frame(_address, frame->dst(), frame->prot(), frame->data<void>(), buf->size()); // TODO: FIXME. That is creating a copy on a Zero-copy implementation. :P
+        db<E100>(INF) << "E100::send:frame={s=" << frame->src() << ",d=" << frame->dst() << ",p=" << hex << frame->prot() << dec << ",s=" << buf->size() << "}" << endl;
 
-        // Status must be set last, since it can trigger a send
+        new (desc->frame()) Frame(_address, frame->dst(), frame->prot(), frame->data<void>(), buf->size());
+        desc->tcb_byte_count = buf->size() + sizeof(Header);
         desc->status = Tx_CB_IN_USE;
+        desc->command = cb_s | cb_tx | cb_cid; // suspend after this frame, unless more are chained to it
 
-        // Trigger an immediate send poll
-        desc->command = cb_s; // suspend bit
-        desc->command |= (cb_tx | cb_cid); // transmit command
-        reinterpret_cast<Tx_Desc *>(_tx_buffer_prev->back())->command &= ~cb_s; // remove suspend bit of the previous frame
-
-        while(exec_command(cuc_resume, 0));
+        // The CU has not been resumed past _tx_prev, so the TxCBs filled after it can be chained freely
+        if(last != _tx_prev)
+            _tx_ring[last].command &= ~cb_s;
+        last = _tx_cur;
+        ++_tx_cur %= TX_BUFS;
 
         size += buf->size();
 
@@ -434,27 +396,37 @@ int E100::send(Buffer * buf)
 
         db<E100>(INF) << "E100::send:desc=" << desc << " => " << *desc << endl;
 
-        // Wait for packet to be sent and unlock the respective buffer
-        while(! (desc->status & cb_complete)) {
-            if (_tx_cuc_suspended) {
-                _tx_cuc_suspended = 0;
-                exec_command(cuc_resume, 0);
-            }
-        }
-
-        db<E100>(TRC) << "E100::send will unlock" << endl;
-
-        _tx_buffer_prev = buf;
         buf->unlock();
-
-        db<E100>(TRC) << "E100::send unlocked" << endl;
     }
 
-    db<E100>(TRC) << "E100::send size=" << size << endl;
+    if(last != _tx_prev)
+        kick(last);
+
+    guard.release();
 
     return size;
 }
 
+// Waits for a transmit buffer to become free and seizes it
+E100::Buffer * E100::seize()
+{
+    unsigned int i = _tx_hint;
+    for(; !_tx_buffer[i]->lock(); ++i %= TX_BUFS);
+    _tx_hint = (i + 1) % TX_BUFS; // _tx_hint is a simple accelerator to avoid scanning the buffers from the beginning
+
+    return _tx_buffer[i];
+}
+
+// Chains the TxCBs filled up to "last" to the ones already handed over to the CU and resumes it (a single doorbell)
+void E100::kick(int last)
+{
+    _tx_ring[_tx_prev].command &= ~cb_s; // remove the suspend bit of the previous batch
+    _tx_prev = last;
+
+    // we have no guarantee that this command will be accepted by the adapter
+    while(exec_command(cuc_resume, 0));
+}
+
 unsigned short E100::eeprom_read(unsigned short *addr_len, unsigned short addr) {
 
     unsigned long cmd_addr_data;
@@ -538,66 +510,11 @@ void E100::handle_int() {
             _rx_ruc_no_more_resources++;
         }
 
-        for(int count = RX_BUFS; count && (_rx_ring[_rx_cur].status & cb_complete); count--, ++_rx_cur %= RX_BUFS) {
-            db<E100>(TRC) << "@ count = " << count << ", _rx_cur = " << _rx_cur << endl;
-
-            // NIC received a frame in _rx_buffer[_rx_cur], let's check if it has already been handled
-            if(_rx_buffer[_rx_cur]->lock()) { // if it wasn't, let's handle it
-                Buffer * buf = _rx_buffer[_rx_cur];
-                Rx_Desc * desc = &_rx_ring[_rx_cur];
-                Frame * frame = buf->frame();
-
-                Frame * desc_frame = reinterpret_cast<Frame *>(desc->frame);
-
-                // For the upper layers, size will represent the size of frame->data<T>()
-                unsigned int size = 0;
-                if (_rx_ring[_rx_cur].actual_count & (RFD_EOF_MASK | RFD_F_MASK)) {
-                    size = _rx_ring[_rx_cur].actual_count & RFD_ACTUAL_COUNT_MASK;
-                }
-                else if (_rx_ring[_rx_cur].actual_count & RFD_F_MASK) {
-                    db<E100>(WRN) << "HDS size" << endl;
-                }
-                else if (! (_rx_ring[_rx_cur].actual_count & RFD_F_MASK)) {
-                    db<E100>(WRN) << "Invalid RFD" << endl;
-                    // Workaround if QEMU patch not applied
-                    // http://patchwork.ozlabs.org/patch/662355/
-                    db<E100>(WRN) << "Assuming size to be 1500" << endl;
-                    size = 1500;
-                    // ----
-                }
-                buf->size(size);
-
-                if (! (_rx_ring[_rx_cur].status & RFD_OK_MASK))
-                    db<E100>(WRN) << "Error on frame reception" << endl;
-
-                db<E100>(INF) << "E100::int:receive desc_frame(s=" << desc_frame->src() << ",d=" << desc_frame->dst() << ",p=" << hex << desc_frame->prot() << dec << ",t=" << (char *) desc_frame->data<void>() << ",s=" << buf->size() << ")" << endl;
-
-                new (frame) Frame(desc_frame->src(), desc_frame->dst(), desc_frame->prot(), desc_frame->data<void>(), buf->size()); // TODO: FIXME. That is creating a copy on a Zero-copy implementation. :P
-
-                db<E100>(INF) << "E100::int:receive(s=" << frame->src() << ",d=" << frame->dst() << ",p=" << hex << frame->header()->prot() << dec << ",t=" << (char *) frame->data<void>() << ",s=" << buf->size() << ")" << endl;
-
-                db<E100>(INF) << "E100::handle_int:desc[" << _rx_cur << "]=" << desc << " => " << *desc << endl;
-
-                _rx_ring[_rx_cur].command = cb_el;
-                _rx_ring[_rx_cur].status = Rx_RFD_NOT_FILLED;
-
-                // try to avoid ruc stop interrupts by "walking" the el bit
-                _rx_ring[_rx_last_el].command &= ~cb_el; // remove previous el bit
-                _rx_last_el = _rx_cur;
-
-                _statistics.rx_packets++;
-                _statistics.rx_bytes += size;
-
-                db<E100>(TRC) << "Will notify!" << endl;
-                if(!notify(frame->header()->prot(), buf)) { // No one was waiting for this frame, so let it free for receive()
-                    free(buf);
-                    db<E100>(TRC) << "Not notified!" << endl;
-                }
-                else {
-                    db<E100>(TRC) << "Notified!" << endl;
-                }
-            }
-        }
+        if(_receiver) { // deferred: mask the NIC's interrupt and leave the frames to the receiver thread
+            IC::disable(IC::irq2int(_irq));
+            _rx_ready->v();
+        } else
+            handle_rx(RX_BUFS);
     }
 
     db<E100>(TRC) << "<" << endl;
@@ -606,6 +523,107 @@ void E100::handle_int() {
     // IC::enable(IC::irq2int(_irq));
 }
 
+// Handles up to "budget" received frames, returning how many were found
+unsigned int E100::handle_rx(unsigned int budget)
+{
+    unsigned int count = 0;
+    for(; (count < budget) && (_rx_ring[_rx_cur].status & cb_complete); count++, ++_rx_cur %= RX_BUFS) {
+        db<E100>(TRC) << "@ count = " << count << ", _rx_cur = " << _rx_cur << endl;
+
+        // NIC received a frame in _rx_buffer[_rx_cur], let's check if it has already been handled
+        if(_rx_buffer[_rx_cur]->lock()) { // if it wasn't, let's handle it
+            Buffer * buf = _rx_buffer[_rx_cur];
+            Rx_Desc * desc = &_rx_ring[_rx_cur];
+            Frame * frame = buf->frame();
+
+            Frame * desc_frame = reinterpret_cast<Frame *>(desc->frame);
+
+            // For the upper layers, size will represent the size of frame->data<T>()
+            unsigned int size = 0;
+            if (_rx_ring[_rx_cur].actual_count & (RFD_EOF_MASK | RFD_F_MASK)) {
+                size = _rx_ring[_rx_cur].actual_count & RFD_ACTUAL_COUNT_MASK;
+            }
+            else if (_rx_ring[_rx_cur].actual_count & RFD_F_MASK) {
+                db<E100>(WRN) << "HDS size" << endl;
+            }
+            else if (! (_rx_ring[_rx_cur].actual_count & RFD_F_MASK)) {
+                db<E100>(WRN) << "Invalid RFD" << endl;
+                // Workaround if QEMU patch not applied
+                // http://patchwork.ozlabs.org/patch/662355/
+                db<E100>(WRN) << "Assuming size to be 1500" << endl;
+                size = 1500;
+                // ----
+            }
+            buf->size(size);
+
+            if (! (_rx_ring[_rx_cur].status & RFD_OK_MASK))
+                db<E100>(WRN) << "Error on frame reception" << endl;
+
+            db<E100>(INF) << "E100::int:receive desc_frame(s=" << desc_frame->src() << ",d=" << desc_frame->dst() << ",p=" << hex << desc_frame->prot() << dec << ",t=" << (char *) desc_frame->data<void>() << ",s=" << buf->size() << ")" << endl;
+
+            new (frame) Frame(desc_frame->src(), desc_frame->dst(), desc_frame->prot(), desc_frame->data<void>(), buf->size()); // TODO: FIXME. That is creating a copy on a Zero-copy implementation. :P
+
+            db<E100>(INF) << "E100::int:receive(s=" << frame->src() << ",d=" << frame->dst() << ",p=" << hex << frame->header()->prot() << dec << ",t=" << (char *) frame->data<void>() << ",s=" << buf->size() << ")" << endl;
+
+            db<E100>(INF) << "E100::handle_int:desc[" << _rx_cur << "]=" << desc << " => " << *desc << endl;
+
+            _rx_ring[_rx_cur].command = cb_el;
+            _rx_ring[_rx_cur].status = Rx_RFD_NOT_FILLED;
+
+            // try to avoid ruc stop interrupts by "walking" the el bit
+            _rx_ring[_rx_last_el].command &= ~cb_el; // remove previous el bit
+            _rx_last_el = _rx_cur;
+
+            _statistics.rx_packets++;
+            _statistics.rx_bytes += size;
+
+            db<E100>(TRC) << "Will notify!" << endl;
+            if(!notify(frame->header()->prot(), buf)) { // No one was waiting for this frame, so let it free for receive()
+                free(buf);
+                db<E100>(TRC) << "Not notified!" << endl;
+            }
+            else {
+                db<E100>(TRC) << "Notified!" << endl;
+            }
+        }
+    }
+
+    return count;
+}
+
+// Starts deferred reception (see PCNet32::defer())
+void E100::defer()
+{
+    if(!deferred || _receiver)
+        return;
+
+    db<E100>(TRC) << "E100::defer(unit=" << _unit << ")" << endl;
+
+    _rx_ready = new (SYSTEM) Semaphore(0);
+    _receiver = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::HIGH), &receiver, this);
+}
+
+int E100::receiver(E100 * dev)
+{
+    while(true) {
+        dev->_rx_ready->p();
+
+        for(bool polling = true; polling; ) {
+            while(dev->handle_rx(BUDGET) == BUDGET)
+                Thread::yield();
+
+            IC::enable(IC::irq2int(dev->_irq));
+
+            // Frames that arrived after the last poll might not raise a new interrupt
+            polling = dev->rx_pending();
+            if(polling)
+                IC::disable(IC::irq2int(dev->_irq));
+        }
+    }
+
+    return 0;
+}
+
 void E100::i82559_configure(void)
 {
     configCB->command = cb_config;
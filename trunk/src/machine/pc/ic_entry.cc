@@ -790,6 +790,35 @@ void IC::entry()
         "        iret                   \n" : : "m"(id), "c"(dispatch));
 };
 
+// Page faults that can be resolved (see fault_handler()) resume the faulting instruction, so the
+// registers and the error code pushed by the CPU are popped before the iret
+void IC::entry_pf()
+{
+    ASM("        pushal                 \n");
+
+    ASM("        pushl  %%esp           \n"
+        "        call   *%0             \n"
+        "        popl   %%eax           \n"
+        "        popal                  \n"
+        "        addl   $4, %%esp       \n"
+        "        iret                   \n" : : "c"(page_fault));
+}
+
+void IC::page_fault(Fault_Frame * frame)
+{
+    Reg32 address = CPU::cr2();
+
+    if(address == reinterpret_cast<CPU::Reg32>(&__exit)) {
+        db<IC,Machine>(INF) << "IC::page_fault[address=" << reinterpret_cast<void *>(address) << "]: final return!" << endl;
+        _exit(frame->eax);
+    }
+
+    if(_fault_handler && _fault_handler(address, frame->error))
+        return;
+
+    exc_pf(frame->eip, frame->cs, frame->eflags, frame->error);
+}
+
 // Default logical handler
 void IC::int_not(const Interrupt_Id & i)
 {
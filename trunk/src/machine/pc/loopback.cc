@@ -0,0 +1,263 @@
+// EPOS PC Loopback (In-Memory) Ethernet NIC Mediator Implementation
+
+#include <machine/pc/machine.h>
+#include <machine/pc/loopback.h>
+#include <utility/malloc.h>
+#include <semaphore.h>
+#include <thread.h>
+
+__BEGIN_SYS
+
+// Class attributes
+Loopback * Loopback::_devices[UNITS];
+
+
+// Methods
+Loopback::~Loopback()
+{
+    db<Loopback>(TRC) << "~Loopback(unit=" << _unit << ")" << endl;
+
+    _devices[_unit] = 0;
+}
+
+
+int Loopback::send(const Address & dst, const Protocol & prot, const void * data, unsigned int size)
+{
+    db<Loopback>(TRC) << "Loopback::send(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",d=" << data << ",s=" << size << ")" << endl;
+
+    if(size > MTU)
+        size = MTU;
+
+    Buffer * buf = seize();
+
+    // Assemble the Ethernet frame
+    new (buf) Buffer(0, size, _address, dst, prot, data, size);
+
+    transmit(buf);
+
+    return size;
+}
+
+
+int Loopback::receive(Address * src, Protocol * prot, void * data, unsigned int size)
+{
+    db<Loopback>(TRC) << "Loopback::receive(s=" << *src << ",p=" << hex << *prot << dec << ",d=" << data << ",s=" << size << ") => " << endl;
+
+    // Wait for a frame
+    _rx_ready->p();
+    Buffer * buf = retrieve();
+
+    // Disassemble the Ethernet frame
+    Frame * frame = buf->frame();
+    *src = frame->src();
+    *prot = frame->prot();
+
+    // Copy the data
+    memcpy(data, frame->data<void>(), (buf->size() > size) ? size : buf->size());
+
+    int tmp = buf->size();
+
+    buf->unlock();
+
+    return tmp;
+}
+
+
+Loopback::Buffer * Loopback::alloc(NIC * nic, const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload)
+{
+    db<Loopback>(TRC) << "Loopback::alloc(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",on=" << once << ",al=" << always << ",ld=" << payload << ")" << endl;
+
+    int max_data = MTU - always;
+
+    if((payload + once) / max_data > QUEUE) {
+        db<Loopback>(WRN) << "Loopback::alloc: sizeof(Network::Packet::Data) > sizeof(NIC::Frame::Data) * QUEUE!" << endl;
+        return 0;
+    }
+
+    Buffer::List pool;
+
+    // Calculate how many frames are needed to hold the transport PDU and allocate enough buffers
+    for(int size = once + payload; size > 0; size -= max_data) {
+        Buffer * buf = seize();
+
+        // Initialize the buffer and assemble the Ethernet Frame Header
+        new (buf) Buffer(nic, (size > max_data) ? MTU : size + always, _address, dst, prot);
+
+        db<Loopback>(INF) << "Loopback::alloc:buf=" << buf << " => " << *buf << endl;
+
+        pool.insert(buf->link());
+    }
+
+    return pool.head()->object();
+}
+
+
+int Loopback::send(Buffer * buf)
+{
+    unsigned int size = 0;
+
+    for(Buffer::Element * el = buf->link(), * next; el; el = next) {
+        buf = el->object();
+
+        db<Loopback>(TRC) << "Loopback::send(buf=" << buf << ")" << endl;
+
+        db<Loopback>(INF) << "Loopback::send:buf=" << buf << " => " << *buf << endl;
+
+        // Each frame is received on its own, so it must leave the pool before being handed over
+        next = el->next();
+        el->next(0);
+
+        size += buf->size();
+
+        transmit(buf);
+    }
+
+    return size;
+}
+
+
+void Loopback::free(Buffer * buf)
+{
+    db<Loopback>(TRC) << "Loopback::free(buf=" << buf << ")" << endl;
+
+    db<Loopback>(INF) << "Loopback::free:buf=" << buf << " => " << *buf << endl;
+
+    for(Buffer::Element * el = buf->link(), * next; el; el = next) {
+        next = el->next();
+
+        // Release the buffer to the unit it came from (not necessarily this one)
+        el->object()->unlock();
+    }
+}
+
+
+void Loopback::reset()
+{
+    db<Loopback>(TRC) << "Loopback::reset()" << endl;
+
+    // Locally administered address, with the unit (plus one) in the last byte, as expected by IP's MAC configuration
+    _address[0] = 0x02;
+    _address[1] = 0x00;
+    _address[2] = 0x00;
+    _address[3] = 0x00;
+    _address[4] = 0x00;
+    _address[5] = _unit + 1;
+    db<Loopback>(INF) << "Loopback::reset: MAC=" << _address << endl;
+
+    // Reset statistics
+    new (&_statistics) Statistics;
+}
+
+
+// Waits for a buffer of this unit to become free and seizes it
+Loopback::Buffer * Loopback::seize()
+{
+    unsigned int i = _cur;
+    for(unsigned int n = 1; !_buffer[i]->lock(); n++, ++i %= BUFS)
+        if(!(n % BUFS)) // a whole round without a free buffer: let the receivers release some
+            Thread::yield();
+    _cur = (i + 1) % BUFS; // _cur is a simple accelerator to avoid scanning the buffers from the beginning
+
+    return _buffer[i];
+}
+
+
+// Hands a frame over to the units it is addressed to
+void Loopback::transmit(Buffer * buf)
+{
+    Frame * frame = buf->frame();
+    const Address & dst = frame->dst();
+
+    _statistics.tx_packets++;
+    _statistics.tx_bytes += buf->size();
+
+    // The frame itself goes to the last unit reached, so it is not released while still being copied to the others
+    Loopback * last = 0;
+    for(unsigned int i = 0; i < UNITS; i++) {
+        Loopback * dev = _devices[i];
+        if(!dev || ((dst != dev->_address) && (dst != broadcast()) && !promiscuous))
+            continue;
+
+        if(last) {
+            Buffer * copy = last->seize();
+            new (copy) Buffer(buf->nic(), buf->size());
+            memcpy(copy->frame(), frame, sizeof(Header) + buf->size());
+            last->deliver(copy);
+        }
+        last = dev;
+    }
+
+    if(last)
+        last->deliver(buf);
+    else // no one on the wire with that address
+        buf->unlock();
+}
+
+
+// Queues a frame for reception by this unit, dropping it if too many are waiting already
+void Loopback::deliver(Buffer * buf)
+{
+    db<Loopback>(TRC) << "Loopback::deliver(unit=" << _unit << ",buf=" << buf << ")" << endl;
+
+    Spin_Guard<> guard(_lock);
+    bool full = (_received.size() >= QUEUE);
+    if(full)
+        _statistics.rx_overruns++;
+    else {
+        _received.insert(buf->lext());
+        _statistics.rx_packets++;
+        _statistics.rx_bytes += buf->size();
+    }
+    guard.release();
+
+    if(full)
+        buf->unlock();
+    else
+        _rx_ready->v();
+}
+
+
+// Takes the next frame waiting for reception (callers must have acquired _rx_ready)
+Loopback::Buffer * Loopback::retrieve()
+{
+    Spin_Guard<> guard(_lock);
+    Buffer * buf = _received.remove()->object();
+    guard.release();
+
+    return buf;
+}
+
+
+// Starts the receiver thread, which hands the frames over to the observers. Delivering them straight from
+// transmit() would nest the receiving protocol's processing (e.g. a TCP acknowledgment and the data it
+// releases) inside the sender's, without bound.
+void Loopback::defer()
+{
+    if(_receiver)
+        return;
+
+    db<Loopback>(TRC) << "Loopback::defer(unit=" << _unit << ")" << endl;
+
+    _receiver = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::HIGH), &receiver, this);
+}
+
+
+int Loopback::receiver(Loopback * dev)
+{
+    while(true) {
+        dev->_rx_ready->p();
+
+        Buffer * buf = dev->retrieve();
+        Frame * frame = buf->frame();
+
+        db<Loopback>(TRC) << "Loopback::receiver:receive(s=" << frame->src() << ",p=" << hex << frame->header()->prot() << dec
+                          << ",d=" << frame->data<void>() << ",s=" << buf->size() << ")" << endl;
+
+        if(!dev->notify(frame->header()->prot(), buf)) // No one was waiting for this frame
+            dev->free(buf);
+    }
+
+    return 0;
+}
+
+__END_SYS
@@ -0,0 +1,38 @@
+// EPOS PC Loopback (In-Memory) Ethernet NIC Mediator Initialization
+
+#include <system.h>
+#include <machine/pc/machine.h>
+#include <machine/pc/loopback.h>
+#include <semaphore.h>
+
+__BEGIN_SYS
+
+Loopback::Loopback(unsigned int unit)
+{
+    db<Loopback>(TRC) << "Loopback(unit=" << unit << ")" << endl;
+
+    _unit = unit;
+    _cur = 0;
+    _receiver = 0;
+    _rx_ready = new (SYSTEM) Semaphore(0);
+
+    // There are no rings to shadow: a buffer is free while unlocked and travels to the receiving units as is
+    for(unsigned int i = 0; i < BUFS; i++)
+        _buffer[i] = new (SYSTEM) Buffer(static_cast<void *>(0));
+
+    reset();
+}
+
+
+void Loopback::init(unsigned int unit)
+{
+    db<Init, Loopback>(TRC) << "Loopback::init(unit=" << unit << ")" << endl;
+
+    // Initialize the device
+    Loopback * dev = new (SYSTEM) Loopback(unit);
+
+    // Register the device
+    _devices[unit] = dev;
+}
+
+__END_SYS
@@ -4,6 +4,7 @@
 #include <machine/pc/pcnet32.h>
 #include <utility/malloc.h>
 #include <alarm.h>
+#include <semaphore.h>
 
 __BEGIN_SYS
 
@@ -20,41 +21,14 @@ PCNet32::~PCNet32()
 
 int PCNet32::send(const Address & dst, const Protocol & prot, const void * data, unsigned int size)
 {
-    // Wait for a buffer to become free and seize it
-    unsigned int i = _tx_cur;
-    for(bool locked = false; !locked; ) {
-        for(; _tx_ring[i].status & Tx_Desc::OWN; ++i %= TX_BUFS);
-        locked = _tx_buffer[i]->lock();
-    }
-    _tx_cur = (i + 1) % TX_BUFS; // _tx_cur and _rx_cur are simple accelerators to avoid scanning the ring buffer from the beginning.
-                                 // Losing a write in a race condition is assumed to be harmless. The FINC + CAS alternative seems too expensive.
-    Tx_Desc * desc = &_tx_ring[i];
-    Buffer * buf = _tx_buffer[i];
-
     db<PCNet32>(TRC) << "PCNet32::send(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",d=" << data << ",s=" << size << ")" << endl;
 
-    // Assemble the Ethernet frame
-    new (buf->frame()) Frame(_address, dst, prot, data, size);
-
-    desc->size = -(size + sizeof(Header)); // 2's comp.
-
-    // Status must be set last, since it can trigger a send
-    desc->status = Tx_Desc::OWN | Tx_Desc::STP | Tx_Desc::ENP;
-
-    // Trigger an immediate send poll
-    csr(0, csr(0) | CSR0_TDMD);
-
-    _statistics.tx_packets++;
-    _statistics.tx_bytes += size;
+    Buffer * buf = seize();
 
-    // Wait for packet to be sent
-    // while(desc->status & Tx_Desc::OWN);
-
-    db<PCNet32>(INF) << "PCNet32::send:desc[" << i << "]=" << desc << " => " << *desc << endl;
-
-    buf->unlock();
+    // Assemble the Ethernet frame
+    new (buf) Buffer(0, size, _address, dst, prot, data, size);
 
-    return size;
+    return send(buf);
 }
 
 
@@ -99,7 +73,6 @@ int PCNet32::receive(Address * src, Protocol * prot, void * data, unsigned int s
 }
 
 
-// Allocated buffers must be sent or release IN ORDER as assumed by the PCNet32
 PCNet32::Buffer * PCNet32::alloc(NIC * nic, const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload)
 {
     db<PCNet32>(TRC) << "PCNet32::alloc(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",on=" << once << ",al=" << always << ",ld=" << payload << ")" << endl;
@@ -115,20 +88,11 @@ PCNet32::Buffer * PCNet32::alloc(NIC * nic, const Address & dst, const Protocol
 
     // Calculate how many frames are needed to hold the transport PDU and allocate enough buffers
     for(int size = once + payload; size > 0; size -= max_data) {
-        // Wait for the next buffer to become free and seize it
-        unsigned int i = _tx_cur;
-        for(bool locked = false; !locked; ) {
-            for(; _tx_ring[i].status & Tx_Desc::OWN; ++i %= TX_BUFS);
-            locked = _tx_buffer[i]->lock();
-        }
-        _tx_cur = (i + 1) % TX_BUFS;
-        Tx_Desc * desc = &_tx_ring[i];
-        Buffer * buf = _tx_buffer[i];
+        Buffer * buf = seize();
 
         // Initialize the buffer and assemble the Ethernet Frame Header
         new (buf) Buffer(nic, (size > max_data) ? MTU : size + always, _address, dst, prot);
 
-        db<PCNet32>(INF) << "PCNet32::alloc:desc[" << i << "]=" << desc << " => " << *desc << endl;
         db<PCNet32>(INF) << "PCNet32::alloc:buf=" << buf << " => " << *buf << endl;
 
         pool.insert(buf->link());
@@ -138,25 +102,35 @@ PCNet32::Buffer * PCNet32::alloc(NIC * nic, const Address & dst, const Protocol
 }
 
 
+// Hands all the frames in the pool over to the NIC at once, with a single poll demand. Descriptors are bound to the buffers
+// only now, in the order the pools are sent, so pools allocated but not sent yet (e.g. waiting for ARP) do not hold up the
+// ring. The buffers stay locked until reclaim() finds their frames sent.
 int PCNet32::send(Buffer * buf)
 {
     unsigned int size = 0;
 
+    Spin_Guard<> guard(_tx_lock);
+
     for(Buffer::Element * el = buf->link(); el; el = el->next()) {
         buf = el->object();
-        Tx_Desc * desc = reinterpret_cast<Tx_Desc *>(buf->back());
+
+        // There is always a free descriptor, since every pending one holds a buffer other than those being sent
+        Tx_Desc * desc = &_tx_ring[_tx_cur];
 
         db<PCNet32>(TRC) << "PCNet32::send(buf=" << buf << ")" << endl;
 
         db<PCNet32>(INF) << "PCNet32::send:buf=" << buf << " => " << *buf << endl;
 
+        desc->phy_addr = phy(buf);
         desc->size = -(buf->size() + sizeof(Header)); // 2's comp.
+        desc->misc = 0;
+        _tx_sent[_tx_cur] = buf;
 
         // Status must be set last, since it can trigger a send
         desc->status = Tx_Desc::OWN | Tx_Desc::STP | Tx_Desc::ENP;
 
-        // Trigger an immediate send poll
-        csr(0, csr(0) | CSR0_TDMD);
+        ++_tx_cur %= TX_BUFS;
+        _tx_pending++;
 
         size += buf->size();
 
@@ -164,12 +138,13 @@ int PCNet32::send(Buffer * buf)
         _statistics.tx_bytes += buf->size();
 
         db<PCNet32>(INF) << "PCNet32::send:desc=" << desc << " => " << *desc << endl;
-
-        // Wait for packet to be sent and unlock the respective buffer
-        while(desc->status & Tx_Desc::OWN);
-        buf->unlock();
     }
 
+    // Trigger an immediate send poll (with interrupts disabled, so the handler cannot switch CSRs in between)
+    csr(0, csr(0) | CSR0_TDMD);
+
+    guard.release();
+
     return size;
 }
 
@@ -199,6 +174,36 @@ void PCNet32::free(Buffer * buf)
 }
 
 
+// Waits for a transmit buffer to become free and seizes it
+PCNet32::Buffer * PCNet32::seize()
+{
+    unsigned int i = _tx_hint;
+    for(unsigned int n = 1; !_tx_buffer[i]->lock(); n++, ++i %= TX_BUFS)
+        if(!(n % TX_BUFS)) // a whole round without a free buffer: release the ones whose frames were sent meanwhile
+            reclaim();
+    _tx_hint = (i + 1) % TX_BUFS; // _tx_hint is a simple accelerator to avoid scanning the buffers from the beginning
+
+    return _tx_buffer[i];
+}
+
+
+// Releases, in a single pass, the buffers of all the frames the NIC has finished sending. It only runs when seize()
+// runs out of buffers, instead of having each send wait for its frames to leave.
+void PCNet32::reclaim()
+{
+    Spin_Guard<> guard(_tx_lock);
+
+    for(; _tx_pending && !(_tx_ring[_tx_done].status & Tx_Desc::OWN); _tx_pending--, ++_tx_done %= TX_BUFS) {
+        Tx_Desc * desc = &_tx_ring[_tx_done];
+
+        db<PCNet32>(INF) << "PCNet32::reclaim:desc[" << _tx_done << "]=" << desc << " => " << *desc << endl;
+
+        desc->status = 0;
+        _tx_sent[_tx_done]->unlock();
+    }
+}
+
+
 void PCNet32::reset()
 {
     db<PCNet32>(TRC) << "PCNet32::reset()" << endl;
@@ -243,6 +248,13 @@ void PCNet32::reset()
     // Set transmit start point to full frame
     csr(80, csr(80) | 0x0c00); // XMTSP = 11
 
+    // The NIC restarts the transmit ring from its first descriptor, so the frames it has not sent yet are lost
+    for(; _tx_pending; _tx_pending--, ++_tx_done %= TX_BUFS) {
+        _tx_ring[_tx_done].status = 0;
+        _tx_sent[_tx_done]->unlock();
+    }
+    _tx_cur = _tx_done = 0;
+
     // Setup a init block
     _iblock->mode = 0x0000;
     _iblock->rlen = log2(RX_BUFS) << 4;
@@ -306,34 +318,13 @@ void PCNet32::handle_int()
             reset();
         }
 
-        if(csr0 & CSR0_RINT) { // Frame received (possibly multiple, let's handle a whole round on the ring buffer)
-
-            // Note that ISRs in EPOS are reentrant, that's why locking was carefully made atomic
-            // Therefore, several instances of this code can compete to handle received buffers
-
-            for(unsigned int count = RX_BUFS, i = _rx_cur; count && !(_rx_ring[i].status & Rx_Desc::OWN); count--, ++i %= RX_BUFS, _rx_cur = i) {
-                // NIC received a frame in _rx_buffer[_rx_cur], let's check if it has already been handled
-                if(_rx_buffer[i]->lock()) { // if it wasn't, let's handle it
-                    Buffer * buf = _rx_buffer[i];
-                    Rx_Desc * desc = &_rx_ring[i];
-                    Frame * frame = buf->frame();
-
-                    // For the upper layers, size will represent the size of frame->data<T>()
-                    buf->size((desc->misc & 0x00000fff) - sizeof(Header) - sizeof(CRC));
-
-                    db<PCNet32>(TRC) << "PCNet32::int:receive(s=" << frame->src() << ",p=" << hex << frame->header()->prot() << dec
-                                     << ",d=" << frame->data<void>() << ",s=" << buf->size() << ")" << endl;
-
-                    db<PCNet32>(INF) << "PCNet32::handle_int:desc[" << i << "]=" << desc << " => " << *desc << endl;
-
-                    IC::disable(IC::irq2int(_irq));
-                    if(!notify(frame->header()->prot(), buf)) // No one was waiting for this frame, so let it free for receive()
-                        free(buf);
-                    // TODO: this serialization is much too restrictive. It was done this way for students to play with
-                    IC::enable(IC::irq2int(_irq));
-                }
-            }
- 	}
+        if(csr0 & CSR0_RINT) { // Frame received (possibly multiple)
+            if(_receiver) { // deferred: mask the NIC's interrupt and leave the frames to the receiver thread
+                IC::disable(IC::irq2int(_irq));
+                _rx_ready->v();
+            } else
+                handle_rx(RX_BUFS); // let's handle a whole round on the ring buffer
+        }
 
         if(csr0 & CSR0_ERR) { // Error
             db<PCNet32>(WRN) << "PCNet32::int:error =>";
@@ -363,6 +354,84 @@ void PCNet32::handle_int()
 }
 
 
+// Handles up to "budget" received frames, returning how many were found
+unsigned int PCNet32::handle_rx(unsigned int budget)
+{
+    // Note that ISRs in EPOS are reentrant, that's why locking was carefully made atomic
+    // Therefore, several instances of this code can compete to handle received buffers
+
+    unsigned int count = 0;
+    for(unsigned int i = _rx_cur; (count < budget) && !(_rx_ring[i].status & Rx_Desc::OWN); count++, ++i %= RX_BUFS, _rx_cur = i) {
+        // NIC received a frame in _rx_buffer[_rx_cur], let's check if it has already been handled
+        if(_rx_buffer[i]->lock()) { // if it wasn't, let's handle it
+            Buffer * buf = _rx_buffer[i];
+            Rx_Desc * desc = &_rx_ring[i];
+            Frame * frame = buf->frame();
+
+            // For the upper layers, size will represent the size of frame->data<T>()
+            buf->size((desc->misc & 0x00000fff) - sizeof(Header) - sizeof(CRC));
+
+            db<PCNet32>(TRC) << "PCNet32::int:receive(s=" << frame->src() << ",p=" << hex << frame->header()->prot() << dec
+                             << ",d=" << frame->data<void>() << ",s=" << buf->size() << ")" << endl;
+
+            db<PCNet32>(INF) << "PCNet32::handle_rx:desc[" << i << "]=" << desc << " => " << *desc << endl;
+
+            if(_receiver) {
+                if(!notify(frame->header()->prot(), buf)) // No one was waiting for this frame, so let it free for receive()
+                    free(buf);
+            } else {
+                IC::disable(IC::irq2int(_irq));
+                if(!notify(frame->header()->prot(), buf)) // No one was waiting for this frame, so let it free for receive()
+                    free(buf);
+                // TODO: this serialization is much too restrictive. It was done this way for students to play with
+                IC::enable(IC::irq2int(_irq));
+            }
+        }
+    }
+
+    return count;
+}
+
+
+// Starts deferred reception (a la NAPI): from now on, the interrupt handler only masks the NIC's interrupt and
+// wakes up a high-priority thread, which polls the receive ring in batches of BUDGET frames (yielding the CPU
+// between them) and unmasks the interrupt once the ring is empty. Protocol processing thus no longer runs with
+// the NIC's interrupt disabled, nor holds up the scheduler's tick and other devices' interrupts.
+void PCNet32::defer()
+{
+    if(!deferred || _receiver)
+        return;
+
+    db<PCNet32>(TRC) << "PCNet32::defer(unit=" << _unit << ")" << endl;
+
+    _rx_ready = new (SYSTEM) Semaphore(0);
+    _receiver = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::HIGH), &receiver, this);
+}
+
+
+int PCNet32::receiver(PCNet32 * dev)
+{
+    while(true) {
+        dev->_rx_ready->p();
+
+        for(bool polling = true; polling; ) {
+            while(dev->handle_rx(BUDGET) == BUDGET)
+                Thread::yield();
+
+            IC::enable(IC::irq2int(dev->_irq));
+
+            // A frame that arrived after the last poll but before the interrupt got unmasked might not raise
+            // a new interrupt, so check once more (the handler may have masked it again meanwhile, which is harmless)
+            polling = dev->rx_pending();
+            if(polling)
+                IC::disable(IC::irq2int(dev->_irq));
+        }
+    }
+
+    return 0;
+}
+
+
 void PCNet32::int_handler(const IC::Interrupt_Id & interrupt)
 {
     PCNet32 * dev = get_by_interrupt(interrupt);
@@ -14,6 +14,8 @@ PCNet32::PCNet32(unsigned int unit, IO_Port io_port, IO_Irq irq, DMA_Buffer * dm
     _io_port = io_port;
     _irq = irq;
     _dma_buf = dma_buf;
+    _receiver = 0;
+    _rx_ready = 0;
 
     // Distribute the DMA_Buffer allocated by init()
     Log_Addr log = _dma_buf->log_address();
@@ -34,6 +36,8 @@ PCNet32::PCNet32(unsigned int unit, IO_Port io_port, IO_Irq irq, DMA_Buffer * dm
 
     // Tx_Desc Ring
     _tx_cur = 0;
+    _tx_done = 0;
+    _tx_pending = 0;
     _tx_ring = log;
     _tx_ring_phy = phy;
     log += TX_BUFS * align128(sizeof(Tx_Desc));
@@ -51,7 +55,8 @@ PCNet32::PCNet32(unsigned int unit, IO_Port io_port, IO_Irq irq, DMA_Buffer * dm
         phy += align128(sizeof(Buffer));
     }
 
-    // Tx_Buffer Ring
+    // Tx_Buffer Ring (descriptors are bound to buffers only when frames are sent, so the initial binding is just a default)
+    _tx_hint = 0;
     for(unsigned int i = 0; i < TX_BUFS; i++) {
         _tx_buffer[i] = new (log) Buffer(&_tx_ring[i]);
         _tx_ring[i].phy_addr = phy;
@@ -11,7 +11,11 @@ void Timer::init()
 
     CPU::int_disable();
 
-    Engine::config(0, Engine::clock() / FREQUENCY);
+    if(tickless) {
+        _programmed = per_tick();
+        Engine::config(0, per_tick(), true, false);
+    } else
+        Engine::config(0, Engine::clock() / FREQUENCY);
 
     IC::int_vector(IC::INT_TIMER, int_handler);
     IC::enable(IC::INT_TIMER);
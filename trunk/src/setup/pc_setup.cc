@@ -66,6 +66,8 @@ volatile bool Stacks_Ready = false;
 
 // PC_Setup Synchronization Globals
 volatile bool Paging_Ready = false;
+volatile bool Large_Pages = false;
+volatile bool Global_Pages = false;
 
 //========================================================================
 // PC_Setup
@@ -131,8 +133,10 @@ private:
 
     void setup_idt();
     void setup_gdt();
+    void get_paging_features();
     void setup_sys_pt();
     void setup_sys_pd();
+    PT_Entry phy_mem_pde(unsigned int dir);
     void enable_paging();
     void setup_tss();
 
@@ -196,6 +200,7 @@ PC_Setup::PC_Setup(char * boot_image)
         // Configure the memory model defined above
         setup_idt();
         setup_gdt();
+        get_paging_features();
         setup_sys_pt();
         setup_sys_pd();
 
@@ -572,10 +577,15 @@ void PC_Setup::enable_paging()
     // Set CR3 (PDBR) register
     CPU::cr3(si->pmm.sys_pd);
 
+    // Enable 4 MB pages, which the physical memory map might use (see setup_sys_pd())
+    if(Large_Pages)
+        CPU::cr4(CPU::cr4() | CPU::CR4_PSE);
+
     // Enable paging
     Reg32 aux = CPU::cr0();
     aux &= CPU::CR0_CLEAR;
     aux |= CPU::CR0_SET;
+    aux |= CPU::CR0_WP; // the kernel must fault on copy-on-write pages as well (see MMU::page_fault())
     CPU::cr0(aux);
 
     // The following relative jump is to break the IA32 prefetch queue
@@ -595,6 +605,10 @@ void PC_Setup::enable_paging()
     // Set stack pointer to its logical address
     ASM("orl %0, %%esp" : : "i" (PHY_MEM));
 
+    // Enable global pages, which the kernel mappings might use (see setup_sys_pt())
+    if(Global_Pages)
+        CPU::cr4(CPU::cr4() | CPU::CR4_PGE);
+
     // Flush TLB to ensure we've got the right memory organization
     MMU::flush_tlb();
 }
@@ -651,6 +665,21 @@ void PC_Setup::setup_gdt()
         db<Setup>(INF) << "GDT[TSS" << i << "=" << CPU::GDT_TSS0  + i << "]=" << gdt[CPU::GDT_TSS0 + i] << endl;
 }
 
+//========================================================================
+void PC_Setup::get_paging_features()
+{
+    Reg32 eax, ebx, ecx = 0, edx;
+    CPU::cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    // 4 MB pages for the physical memory map and large Segments
+    Large_Pages = Traits<MMU>::large_pages && (edx & CPU::CPUID_PSE);
+
+    // Global pages for the mappings shared by all address spaces
+    Global_Pages = Traits<MMU>::global_pages && (edx & CPU::CPUID_PGE);
+
+    db<Setup>(INF) << "paging features={large=" << Large_Pages << ",global=" << Global_Pages << "}" << endl;
+}
+
 //========================================================================
 void PC_Setup::setup_sys_pt()
 {
@@ -683,39 +712,42 @@ void PC_Setup::setup_sys_pt()
     // Clear the System Page Table
     memset(sys_pt, 0, sizeof(Page));
 
+    // All address spaces share the system's mappings, so they are global (if the CPU supports it)
+    Reg32 flags = Flags::SYS | (Global_Pages ? Flags::GLB : 0);
+
     // IDT
-    sys_pt[MMU::page(IDT)] = si->pmm.idt | Flags::SYS;
+    sys_pt[MMU::page(IDT)] = si->pmm.idt | flags;
 
     // GDT
-    sys_pt[MMU::page(GDT)] = si->pmm.gdt | Flags::SYS;
+    sys_pt[MMU::page(GDT)] = si->pmm.gdt | flags;
 
     // TSSs
     for(unsigned int i = 0; i < Traits<Machine>::CPUS; i++)
-        sys_pt[MMU::page(TSS0) + i] = (si->pmm.tss + i * sizeof(Page)) | Flags::SYS;
+        sys_pt[MMU::page(TSS0) + i] = (si->pmm.tss + i * sizeof(Page)) | flags;
 
     // Set an entry to this page table, so the system can access it later
-    sys_pt[MMU::page(SYS_PT)] = si->pmm.sys_pt | Flags::SYS;
+    sys_pt[MMU::page(SYS_PT)] = si->pmm.sys_pt | flags;
 
     // System Page Directory
-    sys_pt[MMU::page(SYS_PD)] = si->pmm.sys_pd | Flags::SYS;
+    sys_pt[MMU::page(SYS_PD)] = si->pmm.sys_pd | flags;
 
     // System Info
-    sys_pt[MMU::page(SYS_INFO)] = si->pmm.sys_info | Flags::SYS;
+    sys_pt[MMU::page(SYS_INFO)] = si->pmm.sys_info | flags;
 
     unsigned int i;
     PT_Entry aux;
 
     // SYSTEM code
     for(i = 0, aux = si->pmm.sys_code; i < MMU::pages(si->lm.sys_code_size); i++, aux = aux + sizeof(Page))
-        sys_pt[MMU::page(SYS_CODE) + i] = aux | Flags::SYS;
+        sys_pt[MMU::page(SYS_CODE) + i] = aux | flags;
 
     // SYSTEM data
     for(i = 0, aux = si->pmm.sys_data; i < MMU::pages(si->lm.sys_data_size); i++, aux = aux + sizeof(Page))
-        sys_pt[MMU::page(SYS_DATA) + i] = aux | Flags::SYS;
+        sys_pt[MMU::page(SYS_DATA) + i] = aux | flags;
 
     // SYSTEM stack (used only during init and for the ukernel model)
     for(i = 0, aux = si->pmm.sys_stack; i < MMU::pages(si->lm.sys_stack_size); i++, aux = aux + sizeof(Page))
-        sys_pt[MMU::page(SYS_STACK) + i] = aux | Flags::SYS;
+        sys_pt[MMU::page(SYS_STACK) + i] = aux | flags;
 
     db<Setup>(INF) << "SPT=" << *reinterpret_cast<Page_Table *>(sys_pt) << endl;
 }
@@ -740,6 +772,10 @@ void PC_Setup::setup_sys_pd()
     unsigned int mem_size = MMU::pages(si->bm.mem_top - si->bm.mem_base);
     int n_pts = (mem_size + MMU::PT_ENTRIES - 1) / MMU::PT_ENTRIES;
 
+    // The PHY_MEM and IO windows are shared by all address spaces, so their mappings are global (if the CPU supports
+    // it). MEM_BASE's are not, since the page tables of the physical memory map are shared by both windows.
+    Reg32 glb = Global_Pages ? Flags::GLB : 0;
+
     // Map all physical memory into the page tables pointed by phy_mem_pts
     // These will be attached at both PHY_MEM and MEM_BASE thus flags
     // must consider application access
@@ -749,11 +785,11 @@ void PC_Setup::setup_sys_pd()
 
     // Attach all physical memory starting at PHY_MEM
     for(int i = 0; i < n_pts; i++)
-        sys_pd[MMU::directory(PHY_MEM) + i] = (si->pmm.phy_mem_pts + i * sizeof(Page)) | Flags::SYS;
+        sys_pd[MMU::directory(PHY_MEM) + i] = phy_mem_pde(i) | Flags::SYS | glb;
 
     // Attach memory starting at MEM_BASE
     for(unsigned int i = MMU::directory(MMU::align_directory(si->pmm.mem_base)); i < MMU::directory(MMU::align_directory(si->pmm.mem_top)); i++)
-        sys_pd[i] = (si->pmm.phy_mem_pts + i * sizeof(Page)) | Flags::APP;
+        sys_pd[i] = phy_mem_pde(i) | Flags::APP;
 
     // Calculate the number of page tables needed to map the IO address space
     unsigned int io_size = MMU::pages(si->pmm.io_top - si->pmm.io_base);
@@ -765,13 +801,13 @@ void PC_Setup::setup_sys_pd()
     pts = reinterpret_cast<PT_Entry *>((void *)si->pmm.io_pts);
     unsigned int i = 0;
     for(; i < (APIC_SIZE / sizeof(Page)); i++)
-        pts[i] = (APIC_PHY + i * sizeof(Page)) | Flags::APIC;
+        pts[i] = (APIC_PHY + i * sizeof(Page)) | Flags::APIC | glb;
     for(unsigned int j = 0; i < ((APIC_SIZE / sizeof(Page)) + (IO_APIC_SIZE / sizeof(Page))); i++, j++)
-        pts[i] = (IO_APIC_PHY + j * sizeof(Page)) | Flags::APIC;
+        pts[i] = (IO_APIC_PHY + j * sizeof(Page)) | Flags::APIC | glb;
     for(unsigned int j = 0; i < ((APIC_SIZE / sizeof(Page)) + (IO_APIC_SIZE / sizeof(Page)) + (VGA_SIZE / sizeof(Page))); i++, j++)
-        pts[i] = (VGA_PHY + j * sizeof(Page)) | Flags::VGA;
+        pts[i] = (VGA_PHY + j * sizeof(Page)) | Flags::VGA | glb;
     for(unsigned int j = 0; i < io_size; i++, j++)
-        pts[i] = (si->pmm.io_base + j * sizeof(Page)) | Flags::PCI;
+        pts[i] = (si->pmm.io_base + j * sizeof(Page)) | Flags::PCI | glb;
 
     // Attach devices' memory at Memory_Map::IO
     for(int i = 0; i < n_pts; i++)
@@ -783,6 +819,19 @@ void PC_Setup::setup_sys_pd()
     db<Setup>(INF) << "SPD=" << *reinterpret_cast<Page_Table *>(sys_pd) << endl;
 }
 
+//========================================================================
+PC_Setup::PT_Entry PC_Setup::phy_mem_pde(unsigned int dir)
+{
+    // Directories fully backed by memory are mapped with a single 4 MB page, except for the first one, whose
+    // legacy areas (e.g. the VGA frame buffer) have memory types that differ from the rest of its 4 MB
+    unsigned int mem_size = MMU::pages(si->bm.mem_top - si->bm.mem_base);
+    if(Large_Pages && dir && ((dir + 1) * MMU::PT_ENTRIES <= mem_size))
+        return (dir * MMU::PT_ENTRIES * sizeof(Page)) | Flags::PS;
+
+    // Otherwise, the directory points to its page table in phy_mem_pts
+    return si->pmm.phy_mem_pts + dir * sizeof(Page);
+}
+
 //========================================================================
 void PC_Setup::setup_tss()
 {
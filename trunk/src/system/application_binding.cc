@@ -28,6 +28,8 @@ extern "C" {
     static _UTIL::Simple_Spin _heap_spin;
     void _heap_lock() { _heap_spin.acquire(); }
     void _heap_unlock() { _heap_spin.release();}
+    int _heap_pin() { return -1; } // threads can migrate at any time, so there are no per-CPU caches
+    void _heap_unpin() {}
 }
 
 __USING_SYS;
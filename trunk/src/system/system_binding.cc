@@ -43,13 +43,18 @@ extern "C" {
     }
 
     // Heap
-    static Spin _heap_spin;
+    static Spin_Lock<Traits<Heaps>::SPIN> _heap_spin;
     void _heap_lock() {
-        _heap_spin.acquire();
         CPU::int_disable();
+        _heap_spin.acquire();
     }
     void _heap_unlock() {
         _heap_spin.release();
         CPU::int_enable();
     }
+    int _heap_pin() {
+        CPU::int_disable();
+        return Machine::cpu_id();
+    }
+    void _heap_unpin() { CPU::int_enable(); }
 }
@@ -0,0 +1,93 @@
+// EPOS Buddy System Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/random.h>
+#include <utility/buddy.h>
+
+using namespace EPOS;
+
+const unsigned int UNITS = 4000;        // not a power of two, so the last blocks are partial
+const unsigned int ROUNDS = 10000;
+const unsigned int LIVE = 64;
+
+OStream cout;
+
+Buddy<UNITS> buddy;
+bool used[UNITS];
+
+struct Block {
+    int unit;
+    unsigned int n;
+} live[LIVE];
+
+unsigned int errors = 0;
+
+void take(Block * b, unsigned int n)
+{
+    b->unit = buddy.alloc(n);
+    b->n = n;
+    if(b->unit < 0)
+        return;
+    for(unsigned int i = b->unit; i < b->unit + n; i++) {
+        if(used[i])
+            errors++;
+        used[i] = true;
+    }
+}
+
+void give(Block * b)
+{
+    if(b->unit < 0)
+        return;
+    buddy.free(b->unit, b->n);
+    for(unsigned int i = b->unit; i < b->unit + b->n; i++)
+        used[i] = false;
+    b->unit = -1;
+}
+
+int main()
+{
+    cout << "Buddy System Utility Test" << endl;
+
+    // Everything but the first few units is free, as after an OS has loaded itself
+    for(unsigned int i = 0; i < 3; i++)
+        used[i] = true;
+    buddy.free(3, UNITS - 3);
+    cout << "\nFreeing units [3, " << UNITS << ") => available=" << buddy.available() << ", allocable=" << buddy.allocable() << endl;
+
+    for(unsigned int i = 0; i < LIVE; i++)
+        live[i].unit = -1;
+
+    // Single units (like page tables) are the most common requests, with a few larger ones mixed in
+    for(unsigned int r = 0; r < ROUNDS; r++) {
+        Block * b = &live[Random::random() % LIVE];
+        give(b);
+        take(b, (Random::random() % 4) ? 1 : 1 + Random::random() % 300);
+    }
+
+    unsigned int free = 0;
+    for(unsigned int i = 0; i < UNITS; i++)
+        if(!used[i])
+            free++;
+    if(free != buddy.available())
+        errors++;
+    cout << "After " << ROUNDS << " random allocations and releases => " << errors << " errors" << endl;
+
+    for(unsigned int i = 0; i < LIVE; i++)
+        give(&live[i]);
+    if(buddy.available() != UNITS - 3)
+        errors++;
+    cout << "Releasing everything => available=" << buddy.available() << ", allocable=" << buddy.allocable() << endl;
+
+    // Released blocks must have merged back into the largest aligned blocks
+    Block big;
+    take(&big, buddy.allocable());
+    cout << "Allocating the largest block => " << big.unit << " (" << big.n << " units)" << endl;
+    if(big.unit != 1024) // [1024, 2048) is the first 1024-unit block within [3, 4000)
+        errors++;
+    give(&big);
+
+    cout << "\n" << (errors ? "Failed!" : "Passed!") << endl;
+
+    return 0;
+}
@@ -15,6 +15,8 @@ void test_relative_list();
 void test_grouping_list();
 void test_simple_grouping_list();
 void test_scheduling_list();
+void test_bitmap_scheduling_list();
+void test_heap_scheduling_list();
 
 OStream cout;
 
@@ -29,6 +31,8 @@ int main()
     test_relative_list();
     test_grouping_list();
     test_scheduling_list();
+    test_bitmap_scheduling_list();
+    test_heap_scheduling_list();
 
     cout << "\nDone!" << endl;
 
@@ -471,3 +475,79 @@ void test_scheduling_list ()
     for(int i = 0; i < N; i++)
         delete e[i];
 }
+
+void test_bitmap_scheduling_list ()
+{
+    cout << "\nThis is a bitmap-indexed priority scheduling list of integers:" << endl;
+    Bitmap_Scheduling_List<int, Scheduling_Criteria::Priority> l;
+    int o[N];
+    Bitmap_Scheduling_List<int, Scheduling_Criteria::Priority>::Element * e[N];
+    cout << "Inserting the following integers into the list ";
+    for(int i = 0; i < N; i++) {
+        o[i] = i;
+        e[i] = new Bitmap_Scheduling_List<int, Scheduling_Criteria::Priority>::Element(&o[i], (N - i - 1) * 100);
+        l.insert(e[i]);
+        cout << i << "(" << (N - i - 1) * 100 << ")";
+        if(i != N - 1)
+            cout << ", ";
+    }
+    cout << endl;
+    cout << "The list has now " << l.size() + 1 << " elements" << endl;
+    cout << "They are: " << *l.chosen()->object();
+    for(Bitmap_Scheduling_List<int, Scheduling_Criteria::Priority>::Iterator i = l.begin(); i != l.end(); i++)
+        cout << ", " << *i->object();
+    cout << endl;
+    cout << "Scheduling the list => " << *l.choose()->object() << endl;
+    cout << "Forcing scheduling of antorher element => " <<
+        *l.choose_another()->object() << endl;
+    cout << "Forcing scheduling of element whose value is " << o[N/2] << " => "
+         << *l.choose(e[N/2])->object() << endl;
+    cout << "Removing the element whose value is " << o[N/4] << " => "
+         << *l.remove(e[N/4])->object() << endl;
+    cout << "Removing all remaining elements => ";
+    while(l.chosen()) {
+        cout << *l.remove(l.chosen())->object();
+        if(l.chosen())
+            cout << ", ";
+    }
+    cout << endl;
+    cout << "The list has now " << l.size() << " elements" << endl;
+    for(int i = 0; i < N; i++)
+        delete e[i];
+}
+
+void test_heap_scheduling_list ()
+{
+    cout << "\nThis is a heap-ordered priority scheduling list of integers:" << endl;
+    Heap_Scheduling_List<int, Scheduling_Criteria::Priority> l;
+    int o[N];
+    Heap_Scheduling_List<int, Scheduling_Criteria::Priority>::Element * e[N];
+    cout << "Inserting the following integers into the list ";
+    for(int i = 0; i < N; i++) {
+        o[i] = i;
+        e[i] = new Heap_Scheduling_List<int, Scheduling_Criteria::Priority>::Element(&o[i], (i * 7) % N);
+        l.insert(e[i]);
+        cout << i << "(" << (i * 7) % N << ")";
+        if(i != N - 1)
+            cout << ", ";
+    }
+    cout << endl;
+    cout << "The list has now " << l.size() + 1 << " elements" << endl;
+    cout << "Scheduling the list => " << *l.choose()->object() << endl;
+    cout << "Forcing scheduling of antorher element => " <<
+        *l.choose_another()->object() << endl;
+    cout << "Forcing scheduling of element whose value is " << o[N/2] << " => "
+         << *l.choose(e[N/2])->object() << endl;
+    cout << "Removing the element whose value is " << o[N/4] << " => "
+         << *l.remove(e[N/4])->object() << endl;
+    cout << "Removing all remaining elements => ";
+    while(l.chosen()) {
+        cout << *l.remove(l.chosen())->object();
+        if(l.chosen())
+            cout << ", ";
+    }
+    cout << endl;
+    cout << "The list has now " << l.size() << " elements" << endl;
+    for(int i = 0; i < N; i++)
+        delete e[i];
+}
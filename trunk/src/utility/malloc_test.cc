@@ -38,6 +38,29 @@ int main()
     strcpy(sp, "string");
     cout << "new char[1024]\t\t=> {p=" << (void *)sp << ",v=" << sp << "}" << endl;
 
+    cout << "deleting everything again!" << endl;
+    delete cp;
+    delete ip;
+    delete lp;
+    delete sp;
+
+    cout << "allocating and freeing objects of all size classes (freed blocks must be reused)!" << endl;
+    const unsigned int objs = 64;
+    char * p[objs];
+    for(unsigned int i = 0; i < objs; i++)
+        p[i] = new char[1 << (i % 12)];
+    char * first = p[0];
+    for(unsigned int i = 0; i < objs; i++)
+        delete p[i];
+    for(unsigned int i = 0; i < objs; i++)
+        p[i] = new char[1 << (i % 12)];
+    bool reused = false;
+    for(unsigned int i = 0; i < objs; i++) {
+        if(p[i] == first)
+            reused = true;
+        delete p[i];
+    }
+    cout << "first block " << (reused ? "was" : "was NOT") << " reused" << endl;
 
     return 0;
 }
@@ -0,0 +1,74 @@
+// EPOS Observer Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/observer.h>
+
+using namespace EPOS;
+
+const int N = 100;
+
+typedef unsigned long long Socket;
+
+OStream cout;
+
+class Data {};
+
+class Sink: public Data_Observer<Data, Socket>
+{
+public:
+    Sink(): _updates(0) {}
+
+    void update(Data_Observed<Data, Socket> * o, Socket c, Data * d) { _updates++; }
+
+    unsigned int updates() const { return _updates; }
+
+private:
+    unsigned int _updates;
+};
+
+// Sockets in the style of TCP::Connection::id(): peer address, peer port and local port
+Socket socket(unsigned int i) { return (static_cast<unsigned long long>(0x0a000100 + i % 7) << 32) | ((1024 + i) << 16) | 80; }
+
+int main()
+{
+    cout << "Observer Utility Test" << endl;
+
+    cout << "\nThis is a hashed data observed with " << N << " observers sharing the same local port:" << endl;
+
+    Hashed_Data_Observed<Data, Socket, 16> observed;
+    Sink sink[N];
+    Data data;
+
+    for(int i = 0; i < N; i++)
+        observed.attach(&sink[i], socket(i));
+
+    unsigned int errors = 0;
+    for(int i = 0; i < N; i++)
+        if(!observed.notify(socket(i), &data) || (observed.observer(socket(i)) != &sink[i]))
+            errors++;
+    for(int i = 0; i < N; i++)
+        if(sink[i].updates() != 1)
+            errors++;
+    cout << "Notifying each observer once => " << errors << " errors" << endl;
+
+    cout << "Notifying an unknown socket => " << observed.notify(socket(N), &data) << endl;
+
+    for(int i = 0; i < N; i += 2)
+        observed.detach(&sink[i], socket(i));
+
+    errors = 0;
+    for(int i = 0; i < N; i++)
+        if(observed.notify(socket(i), &data) != (i % 2))
+            errors++;
+    for(int i = 0; i < N; i++)
+        if(sink[i].updates() != ((i % 2) ? 2U : 1U))
+            errors++;
+    cout << "Detaching every other observer and notifying all again => " << errors << " errors" << endl;
+
+    for(int i = 1; i < N; i += 2)
+        observed.detach(&sink[i], socket(i));
+
+    cout << "\nDone!" << endl;
+
+    return 0;
+}